@@ -0,0 +1,29 @@
+#include <iostream>
+#include <new>
+
+#include "arena.h"
+
+Arena::~Arena() {
+    ::operator delete(memory, std::align_val_t(ALIGNMENT));
+}
+
+void Arena::reserve(size_t bytes) {
+    used = 0;
+    if (bytes <= capacity) {
+        return;
+    }
+    ::operator delete(memory, std::align_val_t(ALIGNMENT));
+    capacity = getAllocationSize(bytes);
+    memory = static_cast<std::byte*>(::operator new(capacity, std::align_val_t(ALIGNMENT)));
+}
+
+void* Arena::allocate(size_t bytes) {
+    const size_t size = getAllocationSize(bytes);
+    if (used + size > capacity) {
+        std::cerr << "Arena of " << capacity << " bytes has no room for " << bytes << " more bytes." << std::endl;
+        return nullptr;
+    }
+    void* buffer = memory + used;
+    used += size;
+    return buffer;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+
+/**
+    Linear allocator over one aligned block. Buffers are carved out in order, each aligned to a cache line, and are all
+    released together by reserve or reset. A set of work buffers whose sizes only change with the settings then costs
+    one allocation when the settings change and none per frame.
+*/
+class Arena {
+public:
+	static const size_t ALIGNMENT = 64;
+
+private:
+	std::byte* memory = nullptr;
+	size_t capacity = 0;
+	size_t used = 0;
+
+public:
+	Arena() = default;
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+	~Arena();
+	// Releases every buffer and makes room for at least the given number of bytes
+	void reserve(size_t bytes);
+	void reset() { used = 0; }
+	// Returns nullptr when the arena is out of room
+	void* allocate(size_t bytes);
+	template <typename T>
+	T* allocate(size_t count) { return static_cast<T*>(allocate(count * sizeof(T))); }
+	// Bytes needed to allocate a buffer of this size, including its alignment
+	static size_t getAllocationSize(size_t bytes) { return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+	size_t getCapacity() const { return capacity; }
+	size_t getUsed() const { return used; }
+};
@@ -0,0 +1,2109 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "benchmark.h"
+#include "glCommon.h"
+#include "loader.h"
+#include "meshCache.h"
+#include "vertexCache.h"
+#include "vertexFormat.h"
+#include "object.h"
+#include "shader.h"
+#include "uniformBuffers.h"
+#include "glState.h"
+#include "offscreenContext.h"
+#include "frameGraph.h"
+#include "water.h"
+#include "fft.h"
+#include "threadPool.h"
+#include "waveQueryService.h"
+
+extern std::string executableDirectory;
+
+typedef struct {
+    const char* flag;
+    std::function<void()> function;
+} BenchmarkEntry;
+
+static const BenchmarkEntry BENCHMARKS[] = {
+    { "--benchmark-waves", Benchmark::waveSampling },
+    { "--benchmark-wave-queries", Benchmark::waveQueryScaling },
+    { "--benchmark-wave-solver", Benchmark::waveSolver },
+    { "--benchmark-wave-table", Benchmark::waveTable },
+    { "--benchmark-height-field", Benchmark::heightFieldCache },
+    { "--benchmark-instances", Benchmark::instancedObjects },
+    { "--benchmark-obj", Benchmark::objParsing },
+    { "--benchmark-mesh-cache", Benchmark::meshCache },
+    { "--benchmark-vertex-cache", Benchmark::vertexCacheOptimization },
+    { "--benchmark-vertex-format", Benchmark::vertexFormat },
+    { "--benchmark-uniforms", Benchmark::uniformOverhead },
+    { "--benchmark-frame-graph", Benchmark::frameGraph },
+    { "--benchmark-water-culling", Benchmark::waterCulling },
+    { "--benchmark-water-grid", Benchmark::waterGrid },
+    { "--benchmark-water-tessellation", Benchmark::waterTessellation },
+    { "--benchmark-water-bake", Benchmark::waterBake },
+    { "--benchmark-wave-count", Benchmark::waveCount },
+    { "--benchmark-ocean-spectrum", Benchmark::oceanSpectrum },
+    { "--benchmark-ocean-threads", Benchmark::oceanSolverScaling },
+    { "--benchmark-ocean-cascades", Benchmark::oceanCascades },
+};
+
+// Cleared by check when a correctness check of a benchmark fails, see Benchmark::run
+static bool checksPassed = true;
+
+// Records the outcome of a correctness check and returns it, the caller prints what was checked
+static bool check(bool passed) {
+    checksPassed = checksPassed && passed;
+    return passed;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::vector<glm::vec2> randomLocations(int count, float extent) {
+    std::mt19937 generator(100);
+    std::uniform_real_distribution<float> distribution(-extent, extent);
+    std::vector<glm::vec2> locations(count);
+    for (auto& location : locations) {
+        location = glm::vec2(distribution(generator), distribution(generator));
+    }
+    return locations;
+}
+
+/**
+    The waves in the layout Water kept before the precomputed wave table, four floats per wave: the direction, the
+    steepness and the wavelength. Rebuilt from the table for the reference and the baseline below, which derive
+    everything else from these for every wave at every evaluation.
+*/
+static std::vector<float> legacyWaveParameters(const Water& water) {
+    const float PI = 3.1415926535897932384626433832795;
+    const WaveSampler::WaveConstants* waveTable = water.getWaveTable();
+    std::vector<float> waveParameters(4 * water.getWaveCount());
+    for (int wave = 0; wave < water.getWaveCount(); wave++) {
+        waveParameters[wave * 4 + 0] = waveTable[wave].directionX;
+        waveParameters[wave * 4 + 1] = waveTable[wave].directionZ;
+        waveParameters[wave * 4 + 2] = waveTable[wave].steepness;
+        waveParameters[wave * 4 + 3] = 2 * PI / waveTable[wave].k;
+    }
+    return waveParameters;
+}
+
+/**
+    Brute force reference for the inverse displacement: the plain fixed point step in double precision, run until the
+    residual is far below anything the float solvers can reach. Returns false where the iteration does not settle, which
+    happens where steep waves fold the surface over and there is no single answer to compare against.
+*/
+static bool referenceWaveHeight(const float* waveParameters, int waveCount, glm::vec2 desired, float time, double& height) {
+    const double PI = 3.1415926535897932384626433832795;
+    const double speed = 3;
+    double locationX = desired.x;
+    double locationZ = desired.y;
+
+    for (int iteration = 0; iteration < 1000; iteration++) {
+        double positionX = locationX;
+        double positionZ = locationZ;
+        height = 0;
+        for (int wave = 0; wave < waveCount; wave++) {
+            glm::dvec2 direction = glm::normalize(glm::dvec2(waveParameters[wave * 4], waveParameters[wave * 4 + 1]));
+            double k = 2 * PI / waveParameters[wave * 4 + 3];
+            double c = std::sqrt(9.81 / k);
+            double a = waveParameters[wave * 4 + 2] / k;
+            double f = k * (direction.x * locationX + direction.y * locationZ - c * time * speed);
+            positionX += direction.x * a * std::cos(f);
+            positionZ += direction.y * a * std::cos(f);
+            height += a * std::sin(f);
+        }
+
+        double offsetX = positionX - desired.x;
+        double offsetZ = positionZ - desired.y;
+        if (offsetX * offsetX + offsetZ * offsetZ < 1e-16) {
+            return true;
+        }
+        locationX -= offsetX;
+        locationZ -= offsetZ;
+    }
+    return false;
+}
+
+/**
+    The Gerstner wave evaluation as it was before the precomputed wave table, deriving the normalized direction, k, c and
+    amplitude from the raw wave parameters for every wave at every evaluation. Kept as the baseline for waveTable().
+*/
+static glm::vec3 legacyWaveGeometry(const float* waveParameters, int waveCount, glm::vec3 location, float time, glm::vec3& tangent, glm::vec3& binormal) {
+    const float PI = 3.1415926535897932384626433832795;
+    const float speed = 3;
+    glm::vec3 position = glm::vec3(location.x, 0, location.z);
+    tangent = glm::vec3(1.0, 0.0, 0.0);
+    binormal = glm::vec3(0.0, 0.0, 1.0);
+
+    for (int i = 0; i < waveCount * 4; i += 4) {
+        glm::vec2 direction = glm::normalize(glm::vec2(waveParameters[i], waveParameters[i + 1]));
+        float steepness = waveParameters[i + 2];
+        float k = 2 * PI / waveParameters[i + 3];
+        float c = sqrt(9.81 / k);
+        float f = k * (glm::dot(direction, glm::vec2(location.x, location.z)) - c * time * speed);
+        float a = steepness / k;
+
+        tangent += glm::vec3(-direction.x * direction.x * steepness * sin(f), direction.x * steepness * cos(f), -direction.x * direction.y * steepness * sin(f));
+        binormal += glm::vec3(-direction.x * direction.y * steepness * sin(f), direction.y * steepness * cos(f), -direction.y * direction.y * steepness * sin(f));
+        position += glm::vec3(direction.x * (a * cos(f)), a * sin(f), direction.y * (a * cos(f)));
+    }
+    return position;
+}
+
+/**
+    The OBJ parser as it was before it moved to memory mapping and std::from_chars, kept as the baseline for
+    Benchmark::objParsing. It builds a std::string for every line and item and converts them with std::stof and std::stoi.
+    Like the new parser it ignores a last line without a line break. Two guards were added so the edge cases can be
+    compared: blank lines are skipped instead of throwing from lineItems.at(0), and faces with more than four points
+    are skipped instead of writing past Face::points.
+*/
+static void legacyParseOBJ(const std::filesystem::path& path, OBJ::File& objFile) {
+    std::ifstream inputStream(path, std::ios::binary);
+    inputStream.seekg(0, inputStream.end);
+    std::streampos size = inputStream.tellg();
+    inputStream.seekg(0, inputStream.beg);
+    std::vector<char> buffer(size);
+    inputStream.read(buffer.data(), size);
+    objFile.filename = path.string();
+
+    std::string currentObjectName = "default";
+    std::string currentMaterialFile;
+    std::string currentMaterialName;
+    int lineStart = 0;
+    std::vector<std::string> lineItems;
+    for (int i = 0; i < size; i++) {
+        if (buffer[i] != 0xA) {
+            continue;
+        }
+
+        std::string line = std::string(buffer.begin() + lineStart, buffer.begin() + i);
+        lineStart = i + 1;
+        if (line.empty() || line.starts_with("#")) {
+            continue;
+        }
+
+        lineItems.clear();
+        int itemStart = 0;
+        while (itemStart < line.length()) {
+            int endIndex = line.find_first_of(" ", itemStart);
+            if (endIndex == -1) {
+                endIndex = line.length();
+            }
+            lineItems.push_back(line.substr(itemStart, endIndex - itemStart));
+            itemStart = endIndex + 1;
+        }
+
+        auto& first = lineItems.at(0);
+        if (first == "v" && lineItems.size() >= 4) {
+            glm::vec4 vertex = glm::vec4(std::stof(lineItems.at(1)), std::stof(lineItems.at(2)), std::stof(lineItems.at(3)), 1.0f);
+            if (lineItems.size() == 5) {
+                vertex.w = std::stof(lineItems.at(4));
+            }
+            objFile.vertices.push_back(vertex);
+        } else if (first == "vt" && lineItems.size() >= 3) {
+            glm::vec3 textureCoordinate = glm::vec3(std::stof(lineItems.at(1)), std::stof(lineItems.at(2)), 0.0f);
+            if (lineItems.size() == 4) {
+                textureCoordinate.z = std::stof(lineItems.at(3));
+            }
+            objFile.textureCoordinates.push_back(textureCoordinate);
+        } else if (first == "vn" && lineItems.size() == 4) {
+            objFile.normals.push_back(glm::vec3(std::stof(lineItems.at(1)), std::stof(lineItems.at(2)), std::stof(lineItems.at(3))));
+        } else if (first == "f" && lineItems.size() <= 5) {
+            OBJ::Face face;
+            face.materialFile = currentMaterialFile;
+            face.material = currentMaterialName;
+            for (auto& point : face.points) {
+                point = { -1, -1, -1 };
+            }
+            for (int item = 1; item < lineItems.size(); item++) {
+                std::string& text = lineItems.at(item);
+                int valueStart = 0;
+                int valueIndex = 0;
+                while (valueStart < text.length()) {
+                    int valueEnd = text.find("/", valueStart);
+                    if (valueEnd == -1) {
+                        valueEnd = text.length();
+                    }
+                    int index = std::stoi(text.substr(valueStart, valueEnd - valueStart));
+                    if (valueIndex == 0) {
+                        face.points[item - 1].vertexIndex = index;
+                    } else if (valueIndex == 1) {
+                        face.points[item - 1].textureIndex = index;
+                    } else if (valueIndex == 2) {
+                        face.points[item - 1].normalIndex = index;
+                    }
+                    valueStart = valueEnd + 1;
+                    valueIndex++;
+                }
+            }
+            if (objFile.objects.find(currentObjectName) == objFile.objects.end()) {
+                objFile.objects.emplace(currentObjectName, OBJ::Object{});
+            }
+            objFile.objects.at(currentObjectName).faces.push_back(face);
+        } else if (first == "o") {
+            currentObjectName = lineItems.at(1);
+        } else if (first == "mtllib") {
+            currentMaterialFile = lineItems.at(1);
+        } else if (first == "usemtl") {
+            currentMaterialName = lineItems.at(1);
+        }
+    }
+}
+
+static bool sameOBJ(const OBJ::File& a, const OBJ::File& b) {
+    if (a.vertices != b.vertices || a.textureCoordinates != b.textureCoordinates || a.normals != b.normals ||
+        a.objects.size() != b.objects.size()) {
+        return false;
+    }
+
+    for (auto& [name, object] : a.objects) {
+        auto other = b.objects.find(name);
+        if (other == b.objects.end() || other->second.faces.size() != object.faces.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < object.faces.size(); i++) {
+            const OBJ::Face& face = object.faces[i];
+            const OBJ::Face& otherFace = other->second.faces[i];
+            if (face.material != otherFace.material || face.materialFile != otherFace.materialFile) {
+                return false;
+            }
+            for (int point = 0; point < face.points.size(); point++) {
+                if (face.points[point].vertexIndex != otherFace.points[point].vertexIndex ||
+                    face.points[point].textureIndex != otherFace.points[point].textureIndex ||
+                    face.points[point].normalIndex != otherFace.points[point].normalIndex) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/**
+    Writes a tessellated height field in the layout Blender exports, a v, vt and vn line for every grid node and a quad
+    per cell. The mesh is split into a few objects and materials so those paths are exercised as well.
+*/
+static void writeBenchmarkOBJ(const std::filesystem::path& path, int resolution) {
+    std::mt19937 generator(100);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    std::string text = "# ocean-gl benchmark mesh\nmtllib benchmark.mtl\n";
+    char line[128];
+    for (int z = 0; z < resolution; z++) {
+        for (int x = 0; x < resolution; x++) {
+            glm::vec3 normal = glm::normalize(glm::vec3(distribution(generator), 4.0f, distribution(generator)));
+            snprintf(line, sizeof(line), "v %f %f %f\nvt %f %f\nvn %f %f %f\n", x * 0.25f, distribution(generator) * 3.0f, z * 0.25f,
+                x / (resolution - 1.0f), z / (resolution - 1.0f), normal.x, normal.y, normal.z);
+            text.append(line);
+        }
+    }
+
+    const int objectRows = resolution / 4 + 1;
+    for (int z = 0; z < resolution - 1; z++) {
+        if (z % objectRows == 0) {
+            snprintf(line, sizeof(line), "o Hull.%03d\nusemtl Paint.%03d\ns off\n", z / objectRows, z / objectRows % 2);
+            text.append(line);
+        }
+        for (int x = 0; x < resolution - 1; x++) {
+            int a = z * resolution + x + 1;
+            int b = a + resolution;
+            snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, a + 1, a + 1, a + 1, b + 1, b + 1, b + 1, b, b, b);
+            text.append(line);
+        }
+    }
+
+    std::ofstream outputStream(path, std::ios::binary);
+    outputStream.write(text.data(), text.size());
+}
+
+/**
+    Creates the offscreen OpenGL 4.1 core context the benchmarks that draw render in, and prints the renderer. There is
+    no default framebuffer to draw to, the benchmarks render into one from createRenderTarget. A host without any GL
+    context fails the run instead of skipping the benchmark, so it is not mistaken for a pass.
+*/
+static bool createContext() {
+    if (!check(OffscreenContext::create())) {
+        std::cerr << "No OpenGL context could be created, the benchmark did not run" << std::endl;
+        return false;
+    }
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+    return true;
+}
+
+/**
+    Creates and binds a framebuffer with a color and a depth renderbuffer of the given size, and sets the viewport to it.
+    The renderbuffers are returned through the array, for deleting them afterwards.
+*/
+static GLuint createRenderTarget(glm::ivec2 size, GLuint renderbuffers[2]) {
+    glGenRenderbuffers(2, renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.x, size.y);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size.x, size.y);
+    GLuint framebuffer;
+    glGenFramebuffers(1, &framebuffer);
+    GLState::bindFramebuffer(framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    glViewport(0, 0, size.x, size.y);
+    return framebuffer;
+}
+
+bool Benchmark::run(int argc, char** argv, bool& passed) {
+    checksPassed = true;
+    bool ranBenchmark = false;
+    for (int i = 1; i < argc; i++) {
+        for (auto& benchmark : BENCHMARKS) {
+            if (std::string(argv[i]) == benchmark.flag) {
+                benchmark.function();
+                ranBenchmark = true;
+            }
+        }
+    }
+    passed = checksPassed;
+    return ranBenchmark;
+}
+
+/**
+    Compares the per point Water::approximateWaveGeometry path against the batched WaveSampler kernels for each
+    instruction set this CPU supports. Reports nanoseconds per query and the largest height difference from the per
+    point path, which should stay in the order of float rounding.
+*/
+void Benchmark::waveSampling() {
+    const int queryCount = 100000;
+    const float time = 12.5f;
+
+    Water water;
+    water.setWaveParameters();
+    std::vector<glm::vec2> locations = randomLocations(queryCount, 2000.0f);
+
+    std::vector<float> referenceHeights(queryCount);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < queryCount; i++) {
+        glm::vec3 wavePosition;
+        glm::vec3 waveNormal;
+        water.approximateWaveGeometry(glm::vec3(locations[i].x, 0, locations[i].y), time, wavePosition, waveNormal);
+        referenceHeights[i] = wavePosition.y;
+    }
+    double referenceSeconds = secondsSince(start);
+    std::cout << std::format("Per point:     {0:8.1f} ns/query", referenceSeconds * 1e9 / queryCount) << std::endl;
+
+    std::vector<float> heights(queryCount);
+    std::vector<glm::vec3> normals(queryCount);
+    std::vector<WaveSampler::InstructionSet> instructionSets = { WaveSampler::INSTRUCTION_SET_SCALAR };
+    if (WaveSampler::getInstructionSet() >= WaveSampler::INSTRUCTION_SET_SSE2) {
+        instructionSets.push_back(WaveSampler::INSTRUCTION_SET_SSE2);
+    }
+    if (WaveSampler::getInstructionSet() >= WaveSampler::INSTRUCTION_SET_AVX2) {
+        instructionSets.push_back(WaveSampler::INSTRUCTION_SET_AVX2);
+    }
+
+    // Drives the kernels directly so that each instruction set can be measured, the conversion to and from the
+    // structure of arrays layout is measured separately through Water::approximateWaveGeometryBatch.
+    WaveSampler::Batch batch;
+    WaveSampler::resize(batch, queryCount);
+    for (int i = 0; i < queryCount; i++) {
+        batch.x[i] = locations[i].x;
+        batch.z[i] = locations[i].y;
+    }
+    WaveSampler::Waves waves;
+    WaveSampler::prepareWaves(water.getWaveTable(), water.getWaveCount(), time, waves);
+
+    for (auto instructionSet : instructionSets) {
+        start = std::chrono::steady_clock::now();
+        WaveSampler::sample(waves, water.getSolverSettings(), batch, 0, batch.x.size(), instructionSet);
+        double seconds = secondsSince(start);
+
+        float maxError = 0;
+        for (int i = 0; i < queryCount; i++) {
+            maxError = std::max(maxError, std::abs(batch.height[i] - referenceHeights[i]));
+        }
+        std::cout << std::format("Batch {0:<7} {1:8.1f} ns/query, {2:5.1f}x speedup, max height error {3:.2e} m",
+            WaveSampler::getInstructionSetName(instructionSet), seconds * 1e9 / queryCount, referenceSeconds / seconds, maxError) << std::endl;
+    }
+
+    start = std::chrono::steady_clock::now();
+    water.approximateWaveGeometryBatch(locations, time, heights, normals);
+    double batchSeconds = secondsSince(start);
+    std::cout << std::format("Water batch:   {0:8.1f} ns/query, {1:5.1f}x speedup",
+        batchSeconds * 1e9 / queryCount, referenceSeconds / batchSeconds) << std::endl;
+}
+
+/**
+    Measures WaveQueryService throughput in queries per second for increasing thread counts, doubling up to the number
+    of hardware threads. Each configuration runs a few warm up frames before the timed frames so the pool is awake.
+*/
+void Benchmark::waveQueryScaling() {
+    const int queryCounts[] = { 1000, 10000, 100000 };
+    const int warmupFrames = 3;
+    const int timedFrames = 20;
+    const int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    Water water;
+    water.setWaveParameters();
+
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < hardwareThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hardwareThreads);
+
+    std::cout << std::format("{0:>8} {1:>8} {2:>14} {3:>10}", "queries", "threads", "queries/sec", "scaling") << std::endl;
+    for (int queryCount : queryCounts) {
+        std::vector<glm::vec2> locations = randomLocations(queryCount, 2000.0f);
+        double singleThreadRate = 0;
+
+        for (int threads : threadCounts) {
+            ThreadPool threadPool;
+            threadPool.init(threads);
+            WaveQueryService service;
+            service.init(&water, &threadPool);
+
+            double seconds = 0;
+            for (int frame = 0; frame < warmupFrames + timedFrames; frame++) {
+                auto start = std::chrono::steady_clock::now();
+                service.clear();
+                for (auto& location : locations) {
+                    service.submit(glm::vec3(location.x, 0, location.y));
+                }
+                service.execute(frame / 60.0f);
+                if (frame >= warmupFrames) {
+                    seconds += secondsSince(start);
+                }
+            }
+
+            double rate = queryCount * timedFrames / seconds;
+            if (threads == 1) {
+                singleThreadRate = rate;
+            }
+            std::cout << std::format("{0:>8} {1:>8} {2:>14.0f} {3:>9.2f}x", queryCount, threads, rate, rate / singleThreadRate) << std::endl;
+        }
+    }
+}
+
+/**
+    Compares solver configurations against the brute force reference: the original fixed 10 plain iterations, the plain
+    step with early exit, and Newton steps with early exit. Reports the mean iteration count, the cost per query on the
+    batched path, and the height error. The default settings are expected to stay within 5 mm of the reference.
+*/
+void Benchmark::waveSolver() {
+    const int queryCount = 100000;
+    const float time = 12.5f;
+    const float heightErrorBound = 0.005f;
+
+    typedef struct {
+        const char* name;
+        WaveSampler::SolverSettings settings;
+    } SolverConfiguration;
+    const SolverConfiguration configurations[] = {
+        { "fixed 10 iterations", { .tolerance = 0.0f, .maxIterations = 10, .newton = false } },
+        { "plain, 1 mm", { .tolerance = 0.001f, .maxIterations = 10, .newton = false } },
+        { "newton, 1 mm", { .tolerance = 0.001f, .maxIterations = 10, .newton = true } },
+        { "newton, 1 cm", { .tolerance = 0.01f, .maxIterations = 10, .newton = true } },
+    };
+
+    Water water;
+    water.setWaveParameters();
+    const WaveSampler::SolverSettings defaultSettings = water.getSolverSettings();
+    std::vector<glm::vec2> locations = randomLocations(queryCount, 2000.0f);
+
+    const std::vector<float> waveParameters = legacyWaveParameters(water);
+    std::vector<double> referenceHeights(queryCount);
+    std::vector<bool> hasReference(queryCount);
+    int referenceCount = 0;
+    for (int i = 0; i < queryCount; i++) {
+        hasReference[i] = referenceWaveHeight(waveParameters.data(), water.getWaveCount(), locations[i], time, referenceHeights[i]);
+        referenceCount += hasReference[i];
+    }
+    std::cout << std::format("{0} of {1} queries have a converged reference", referenceCount, queryCount) << std::endl;
+
+    std::vector<float> heights(queryCount);
+    std::vector<glm::vec3> normals(queryCount);
+    std::cout << std::format("{0:<20} {1:>10} {2:>12} {3:>14} {4:>14}", "solver", "iterations", "ns/query", "mean error", "max error") << std::endl;
+
+    for (auto& configuration : configurations) {
+        water.setSolverSettings(configuration.settings);
+
+        long long totalIterations = 0;
+        for (int i = 0; i < queryCount; i++) {
+            glm::vec3 wavePosition;
+            glm::vec3 waveNormal;
+            WaveSampler::SolverStats stats;
+            water.approximateWaveGeometry(glm::vec3(locations[i].x, 0, locations[i].y), time, wavePosition, waveNormal, &stats);
+            totalIterations += stats.iterations;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        water.approximateWaveGeometryBatch(locations, time, heights, normals);
+        double seconds = secondsSince(start);
+
+        double meanError = 0;
+        double maxError = 0;
+        for (int i = 0; i < queryCount; i++) {
+            if (hasReference[i]) {
+                double error = std::abs(heights[i] - referenceHeights[i]);
+                meanError += error / referenceCount;
+                maxError = std::max(maxError, error);
+            }
+        }
+
+        std::cout << std::format("{0:<20} {1:>10.2f} {2:>12.1f} {3:>12.2e} m {4:>12.2e} m", configuration.name,
+            totalIterations / (double)queryCount, seconds * 1e9 / queryCount, meanError, maxError) << std::endl;
+
+        if (configuration.settings.tolerance == defaultSettings.tolerance && configuration.settings.newton == defaultSettings.newton) {
+            std::cout << std::format("Default settings {0} the {1:.0f} mm height error bound",
+                check(maxError <= heightErrorBound) ? "meet" : "DO NOT meet", heightErrorBound * 1000) << std::endl;
+        }
+    }
+    water.setSolverSettings(defaultSettings);
+}
+
+/**
+    Measures the savings from the precomputed wave table. The per vertex case is the forward evaluation done for every
+    tessellated vertex in water_tess_eval.glsl, run here on the CPU with the same arithmetic as the shader. The per query
+    case is Water::approximateWaveGeometry with the original fixed 10 plain iterations.
+*/
+void Benchmark::waveTable() {
+    const int vertexCount = 200000;
+    const int queryCount = 20000;
+    const float time = 12.5f;
+
+    Water water;
+    water.setWaveParameters();
+    std::vector<glm::vec2> locations = randomLocations(vertexCount, 2000.0f);
+    const std::vector<float> legacyParameters = legacyWaveParameters(water);
+    const float* waveParameters = legacyParameters.data();
+    const WaveSampler::WaveConstants* waveTable = water.getWaveTable();
+    const int waveCount = water.getWaveCount();
+
+    // Accumulated so the compiler cannot drop the evaluations
+    float checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto& location : locations) {
+        glm::vec3 tangent, binormal;
+        checksum += legacyWaveGeometry(waveParameters, waveCount, glm::vec3(location.x, 0, location.y), time, tangent, binormal).y;
+    }
+    double legacyVertexSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (auto& location : locations) {
+        glm::vec3 position = glm::vec3(location.x, 0, location.y);
+        glm::vec3 tangent = glm::vec3(1, 0, 0);
+        glm::vec3 binormal = glm::vec3(0, 0, 1);
+        for (int i = 0; i < waveCount; i++) {
+            const WaveSampler::WaveConstants& wave = waveTable[i];
+            float f = wave.k * (wave.directionX * location.x + wave.directionZ * location.y) - wave.angularSpeed * time;
+            float sinF = sin(f);
+            float cosF = cos(f);
+            tangent += glm::vec3(-wave.directionX * wave.directionX * wave.steepness * sinF, wave.directionX * wave.steepness * cosF, -wave.directionX * wave.directionZ * wave.steepness * sinF);
+            binormal += glm::vec3(-wave.directionX * wave.directionZ * wave.steepness * sinF, wave.directionZ * wave.steepness * cosF, -wave.directionZ * wave.directionZ * wave.steepness * sinF);
+            position += glm::vec3(wave.directionX * wave.amplitude * cosF, wave.amplitude * sinF, wave.directionZ * wave.amplitude * cosF);
+        }
+        checksum += position.y;
+    }
+    double tableVertexSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < queryCount; i++) {
+        const glm::vec3 desired = glm::vec3(locations[i].x, 0, locations[i].y);
+        glm::vec3 location = desired;
+        glm::vec3 position, tangent, binormal;
+        for (int iteration = 0; iteration < 10; iteration++) {
+            position = legacyWaveGeometry(waveParameters, waveCount, location, time, tangent, binormal);
+            location -= position - desired;
+        }
+        checksum += position.y;
+    }
+    double legacyQuerySeconds = secondsSince(start);
+
+    const WaveSampler::SolverSettings defaultSettings = water.getSolverSettings();
+    water.setSolverSettings({ .tolerance = 0.0f, .maxIterations = 10, .newton = false });
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < queryCount; i++) {
+        glm::vec3 wavePosition, waveNormal;
+        water.approximateWaveGeometry(glm::vec3(locations[i].x, 0, locations[i].y), time, wavePosition, waveNormal);
+        checksum += wavePosition.y;
+    }
+    double tableQuerySeconds = secondsSince(start);
+    water.setSolverSettings(defaultSettings);
+
+    std::cout << std::format("Per vertex: {0:8.1f} ns recomputed, {1:8.1f} ns with table, {2:.2f}x",
+        legacyVertexSeconds * 1e9 / vertexCount, tableVertexSeconds * 1e9 / vertexCount, legacyVertexSeconds / tableVertexSeconds) << std::endl;
+    std::cout << std::format("Per query:  {0:8.1f} ns recomputed, {1:8.1f} ns with table, {2:.2f}x",
+        legacyQuerySeconds * 1e9 / queryCount, tableQuerySeconds * 1e9 / queryCount, legacyQuerySeconds / tableQuerySeconds) << std::endl;
+    std::cout << std::format("(checksum {0})", checksum) << std::endl;
+}
+
+/**
+    Memory, accuracy and speed of the height field cache for several grid configurations. Accuracy is the height and
+    normal difference from the analytic solver for queries spread over the inner 90% of the grid. Cached query cost is
+    reported both without and with the per frame build amortized over the queries, for 1k, 10k and 100k queries per
+    frame, next to the batched analytic kernel that answers batched queries instead of the cache.
+*/
+void Benchmark::heightFieldCache() {
+    const float time = 12.5f;
+    const glm::vec3 center = glm::vec3(130.0f, 0.0f, -40.0f);
+    const int queryCounts[] = { 1000, 10000, 100000 };
+
+    typedef struct {
+        int resolution;
+        float extent;
+        HeightFieldInterpolation interpolation;
+    } CacheConfiguration;
+    const CacheConfiguration configurations[] = {
+        { 128, 512.0f, HEIGHT_FIELD_BILINEAR },
+        { 256, 512.0f, HEIGHT_FIELD_BILINEAR },
+        { 256, 512.0f, HEIGHT_FIELD_BICUBIC },
+        { 512, 512.0f, HEIGHT_FIELD_BILINEAR },
+        { 512, 1024.0f, HEIGHT_FIELD_BICUBIC },
+    };
+
+    Water water;
+    water.setWaveParameters();
+
+    for (auto& configuration : configurations) {
+        std::vector<glm::vec2> locations = randomLocations(queryCounts[2], configuration.extent * 0.45f);
+        for (auto& location : locations) {
+            location += glm::vec2(center.x, center.z);
+        }
+
+        water.getHeightFieldCache().setSettings({ .enabled = false });
+        std::vector<glm::vec3> referencePositions(locations.size());
+        std::vector<glm::vec3> referenceNormals(locations.size());
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < locations.size(); i++) {
+            water.approximateWaveGeometry(glm::vec3(locations[i].x, 0, locations[i].y), time, referencePositions[i], referenceNormals[i]);
+        }
+        double analyticPointSeconds = secondsSince(start);
+
+        water.getHeightFieldCache().setSettings({
+            .enabled = true,
+            .resolution = configuration.resolution,
+            .extent = configuration.extent,
+            .interpolation = configuration.interpolation
+        });
+        start = std::chrono::steady_clock::now();
+        water.updateHeightFieldCache(center, time);
+        double buildSeconds = secondsSince(start);
+
+        double meanHeightError = 0;
+        float maxHeightError = 0;
+        float maxNormalError = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < locations.size(); i++) {
+            glm::vec3 wavePosition, waveNormal;
+            water.approximateWaveGeometry(glm::vec3(locations[i].x, 0, locations[i].y), time, wavePosition, waveNormal);
+            float heightError = std::abs(wavePosition.y - referencePositions[i].y);
+            meanHeightError += heightError / locations.size();
+            maxHeightError = std::max(maxHeightError, heightError);
+            maxNormalError = std::max(maxNormalError, glm::length(waveNormal - referenceNormals[i]));
+        }
+        double cachedPointSeconds = secondsSince(start);
+
+        std::cout << std::format("{0}x{0} nodes over {1:.0f} m ({2:.2f} m spacing), {3}", configuration.resolution, configuration.extent,
+            configuration.extent / (configuration.resolution - 1), configuration.interpolation == HEIGHT_FIELD_BICUBIC ? "bicubic" : "bilinear") << std::endl;
+        std::cout << std::format("    memory {0:.2f} MB, build {1:.2f} ms", water.getHeightFieldCache().getMemoryUsage() / (1024.0 * 1024.0), buildSeconds * 1000) << std::endl;
+        std::cout << std::format("    height error mean {0:.2e} m, max {1:.2e} m, max normal error {2:.2e}", meanHeightError, maxHeightError, maxNormalError) << std::endl;
+        std::cout << std::format("    per point: analytic {0:7.1f} ns/query, cached {1:7.1f} ns/query",
+            analyticPointSeconds * 1e9 / locations.size(), cachedPointSeconds * 1e9 / locations.size()) << std::endl;
+
+        for (int queryCount : queryCounts) {
+            std::span<const glm::vec2> queries(locations.data(), queryCount);
+            std::vector<float> heights(queryCount);
+            std::vector<glm::vec3> normals(queryCount);
+
+            // Batched queries do not use the cache, this is the path it competes with
+            start = std::chrono::steady_clock::now();
+            water.approximateWaveGeometryBatch(queries, time, heights, normals);
+            double batchedSeconds = secondsSince(start);
+
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < queryCount; i++) {
+                glm::vec3 wavePosition, waveNormal;
+                water.approximateWaveGeometry(glm::vec3(queries[i].x, 0, queries[i].y), time, wavePosition, waveNormal);
+            }
+            double cachedSeconds = secondsSince(start);
+
+            std::cout << std::format("    {0:>6} queries: batched analytic {1:7.1f} ns/query, cached {2:7.1f} ns/query, cached + build {3:9.1f} ns/query",
+                queryCount, batchedSeconds * 1e9 / queryCount, cachedSeconds * 1e9 / queryCount, (cachedSeconds + buildSeconds) * 1e9 / queryCount) << std::endl;
+        }
+    }
+    water.getHeightFieldCache().setSettings({ .enabled = false });
+}
+
+/**
+    Compares frame times for drawing N floating cubes as separate Objects, one draw call and program each, against a
+    single ObjectInstanceSet. Each frame runs the wave queries for every cube, draws them into a framebuffer object and
+    waits with glFinish, so the times include both the CPU submission cost and the GPU work. It runs in the offscreen
+    context, so on a host without a GPU or display it runs on Mesa's llvmpipe software rasterizer; the renderer in use
+    is printed first. The binding calls GLState issued and skipped in the last frame of separate objects are also
+    reported.
+*/
+void Benchmark::instancedObjects() {
+    const int instanceCounts[] = { 100, 1000, 10000 };
+    const int maxSeparateObjects = 1000;
+    const int warmupFrames = 5;
+    const int timedFrames = 100;
+    const glm::ivec2 size = glm::ivec2(1280, 720);
+
+    if (!createContext()) {
+        return;
+    }
+
+    GLuint renderbuffers[2];
+    GLuint framebuffer = createRenderTarget(size, renderbuffers);
+    glEnable(GL_DEPTH_TEST);
+    const glm::mat4 view = glm::lookAt(glm::vec3(0, 60, -40), glm::vec3(0, 0, 150), glm::vec3(0, 1, 0));
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), static_cast<float>(size.x) / size.y, 0.1f, 2000.0f);
+
+    Water water;
+    water.setWaveParameters();
+    WaveQueryService waveQueries;
+    waveQueries.init(&water);
+    UniformBuffers uniformBuffers;
+    uniformBuffers.init();
+
+    // Runs one frame per call to draw and returns the average and 95th percentile frame time in milliseconds
+    auto measure = [&](const std::function<void()>& queue, const std::function<void(float)>& draw) {
+        std::vector<double> frameTimes;
+        for (int frame = 0; frame < warmupFrames + timedFrames; frame++) {
+            const float time = frame / 60.0f;
+            auto start = std::chrono::steady_clock::now();
+            waveQueries.clear();
+            queue();
+            waveQueries.execute(time);
+            uniformBuffers.updateFrame({ .view = view, .projection = projection, .cameraPosition = glm::vec3(0, 60, -40), .time = time });
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            draw(1 / 60.0f);
+            GLState::endFrame();
+            glFinish();
+            if (frame >= warmupFrames) {
+                frameTimes.push_back(secondsSince(start) * 1000);
+            }
+        }
+        double average = 0;
+        for (double frameTime : frameTimes) {
+            average += frameTime / frameTimes.size();
+        }
+        std::sort(frameTimes.begin(), frameTimes.end());
+        return glm::dvec2(average, frameTimes[frameTimes.size() * 95 / 100]);
+    };
+
+    std::cout << std::format("{0:>8} {1:>22} {2:>22} {3:>26}", "objects", "separate avg/p95 ms", "instanced avg/p95 ms",
+        "separate GL issued/skipped") << std::endl;
+    for (int instanceCount : instanceCounts) {
+        const int rows = static_cast<int>(std::ceil(std::sqrt(instanceCount)));
+        std::vector<glm::vec3> positions;
+        for (int i = 0; i < instanceCount; i++) {
+            positions.push_back(glm::vec3((i % rows - rows / 2) * 4.0f, 0, (i / rows) * 4.0f));
+        }
+
+        std::string separateResult = "skipped";
+        std::string separateStateChanges = "";
+        if (instanceCount <= maxSeparateObjects) {
+            std::vector<Object> objects;
+            objects.reserve(instanceCount);
+            for (auto& position : positions) {
+                objects.emplace_back(&waveQueries);
+                objects.back().position = position;
+                objects.back().loadOBJ("cube/cube");
+            }
+            glm::dvec2 separate = measure(
+                [&]() { for (auto& object : objects) object.queueWaveQuery(); },
+                [&](float elapsedTime) { for (auto& object : objects) object.render(elapsedTime); });
+            separateResult = std::format("{0:.2f} / {1:.2f}", separate.x, separate.y);
+            const GLState::Counters& counters = GLState::getFrameCounters();
+            separateStateChanges = std::format("{0} / {1}", counters.issued, counters.skipped);
+        }
+
+        ObjectInstanceSet instances(&waveQueries);
+        for (auto& position : positions) {
+            instances.addInstance(position);
+        }
+        instances.loadOBJ("cube/cube");
+        glm::dvec2 instanced = measure(
+            [&]() { instances.queueWaveQueries(); },
+            [&](float elapsedTime) { instances.render(elapsedTime); });
+
+        std::cout << std::format("{0:>8} {1:>22} {2:>22} {3:>26}", instanceCount, separateResult,
+            std::format("{0:.2f} / {1:.2f}", instanced.x, instanced.y), separateStateChanges) << std::endl;
+    }
+
+    GLState::bindFramebuffer(0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(2, renderbuffers);
+    OffscreenContext::destroy();
+}
+
+/**
+    Parses a generated mesh of over 100 MB with the previous OBJ parser and the current one at increasing thread counts,
+    reporting the throughput of each in MB/s. The file is parsed once before timing so every run reads it from the page
+    cache. Results are compared against the previous parser, including several copies of the file loaded at once from
+    different threads to check that parsing is reentrant.
+*/
+void Benchmark::objParsing() {
+    const int resolution = 900;
+    const int runs = 3;
+    const int concurrentLoads = 4;
+    const int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "ocean-gl-benchmark.obj";
+    writeBenchmarkOBJ(path, resolution);
+    const double megabytes = std::filesystem::file_size(path) / (1024.0 * 1024.0);
+    std::cout << std::format("{0:.1f} MB, {1} vertices, {2} faces", megabytes, resolution * resolution, (resolution - 1) * (resolution - 1)) << std::endl;
+
+    OBJ::File legacyFile;
+    legacyParseOBJ(path, legacyFile);
+    double legacySeconds = 1e30;
+    for (int run = 0; run < runs; run++) {
+        OBJ::File objFile;
+        auto start = std::chrono::steady_clock::now();
+        legacyParseOBJ(path, objFile);
+        legacySeconds = std::min(legacySeconds, secondsSince(start));
+    }
+    std::cout << std::format("Previous parser:       {0:7.1f} MB/s ({1:.2f} s)", megabytes / legacySeconds, legacySeconds) << std::endl;
+
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < hardwareThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hardwareThreads);
+
+    double singleThreadSeconds = 0;
+    for (int threads : threadCounts) {
+        double seconds = 1e30;
+        bool matches = true;
+        for (int run = 0; run < runs; run++) {
+            OBJ::File objFile;
+            auto start = std::chrono::steady_clock::now();
+            OBJ::parseOBJFile(path, objFile, threads);
+            seconds = std::min(seconds, secondsSince(start));
+            matches = matches && sameOBJ(legacyFile, objFile);
+        }
+        if (threads == 1) {
+            singleThreadSeconds = seconds;
+        }
+        std::cout << std::format("Mapped, {0:>2} threads:   {1:7.1f} MB/s ({2:.2f} s), {3:5.1f}x previous, {4:5.2f}x scaling, output {5}",
+            threads, megabytes / seconds, seconds, legacySeconds / seconds, singleThreadSeconds / seconds, check(matches) ? "matches" : "DIFFERS") << std::endl;
+    }
+
+    std::vector<OBJ::File> objFiles(concurrentLoads);
+    std::vector<std::thread> loaders;
+    for (auto& objFile : objFiles) {
+        loaders.emplace_back([&]() { OBJ::parseOBJFile(path, objFile); });
+    }
+    bool matches = true;
+    for (int i = 0; i < concurrentLoads; i++) {
+        loaders[i].join();
+        matches = matches && sameOBJ(legacyFile, objFiles[i]);
+    }
+    std::cout << std::format("{0} concurrent loads: output {1}", concurrentLoads, check(matches) ? "matches" : "DIFFERS") << std::endl;
+    std::filesystem::remove(path);
+
+    // Inputs the parsers used to disagree on, the new parser reports the ignored lines on std::cerr
+    const std::pair<const char*, const char*> edgeCases[] = {
+        { "No line break at the end", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3" },
+        { "Blank lines", "v 0 0 0\n\nv 1 0 0\n   \nv 0 1 0\n\t\n\nf 1 2 3\n" },
+        { "Face with five points", "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv -1 1 0\nf 1 2 3 4 5\nf 1 2 3\n" },
+    };
+    std::filesystem::path edgeCasePath = std::filesystem::temp_directory_path() / "ocean-gl-benchmark-edge-case.obj";
+    for (auto& [name, text] : edgeCases) {
+        {
+            std::ofstream outputStream(edgeCasePath, std::ios::binary);
+            outputStream << text;
+        }
+        OBJ::File legacyEdgeCase;
+        OBJ::File edgeCase;
+        legacyParseOBJ(edgeCasePath, legacyEdgeCase);
+        OBJ::parseOBJFile(edgeCasePath, edgeCase);
+        std::cout << std::format("{0:<25} output {1}", std::string(name) + ":", check(sameOBJ(legacyEdgeCase, edgeCase)) ? "matches" : "DIFFERS") << std::endl;
+    }
+    std::filesystem::remove(edgeCasePath);
+}
+
+/**
+    Compares a cold model load, which parses the OBJ, expands the faces and writes the cache file, against a warm load
+    that maps the cache file. Also checks the two ways a cache is invalidated: touching the source only costs a content
+    hash, while changing it rebuilds the mesh.
+*/
+void Benchmark::meshCache() {
+    const int resolution = 600;
+    const int runs = 3;
+    std::filesystem::path sourcePath = std::filesystem::temp_directory_path() / "ocean-gl-mesh-cache.obj";
+    std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path() / "ocean-gl-mesh-cache";
+    writeBenchmarkOBJ(sourcePath, resolution);
+    std::cout << std::format("{0:.1f} MB source", std::filesystem::file_size(sourcePath) / (1024.0 * 1024.0)) << std::endl;
+
+    std::vector<float> reference;
+    std::vector<uint32_t> referenceIndices;
+    int referenceVertexCount;
+    MeshCache::buildMesh(sourcePath, reference, referenceIndices, referenceVertexCount, true);
+
+    double coldSeconds = 1e30;
+    double warmSeconds = 1e30;
+    bool matches = true;
+    for (int run = 0; run < runs; run++) {
+        std::filesystem::remove_all(cacheDirectory);
+        {
+            MeshCache::Mesh mesh;
+            auto start = std::chrono::steady_clock::now();
+            MeshCache::loadFile(sourcePath, cacheDirectory, mesh);
+            coldSeconds = std::min(coldSeconds, secondsSince(start));
+        }
+
+        MeshCache::Mesh mesh;
+        auto start = std::chrono::steady_clock::now();
+        MeshCache::loadFile(sourcePath, cacheDirectory, mesh);
+        // Read every vertex, as the upload to the vertex buffer would, so the mapped pages are counted
+        volatile float sum = 0;
+        for (float value : mesh.vertices) {
+            sum = sum + value;
+        }
+        warmSeconds = std::min(warmSeconds, secondsSince(start));
+        matches = matches && mesh.vertices.size() == reference.size() && std::equal(mesh.vertices.begin(), mesh.vertices.end(), reference.begin()) &&
+            mesh.indices.size() == referenceIndices.size() && std::equal(mesh.indices.begin(), mesh.indices.end(), referenceIndices.begin());
+    }
+    std::cout << std::format("Cold load: {0:8.2f} ms", coldSeconds * 1000) << std::endl;
+    std::cout << std::format("Warm load: {0:8.2f} ms, {1:.0f}x faster, vertices {2}", warmSeconds * 1000, coldSeconds / warmSeconds,
+        check(matches) ? "match" : "DIFFER") << std::endl;
+
+    std::filesystem::last_write_time(sourcePath, std::filesystem::last_write_time(sourcePath) + std::chrono::seconds(10));
+    {
+        MeshCache::Mesh mesh;
+        auto start = std::chrono::steady_clock::now();
+        MeshCache::loadFile(sourcePath, cacheDirectory, mesh);
+        std::cout << std::format("Touched source: {0:8.2f} ms, {1} indices", secondsSince(start) * 1000, mesh.indices.size()) << std::endl;
+    }
+
+    std::ofstream(sourcePath, std::ios::app) << "f 1/1/1 2/2/2 3/3/3\n";
+    {
+        MeshCache::Mesh mesh;
+        auto start = std::chrono::steady_clock::now();
+        MeshCache::loadFile(sourcePath, cacheDirectory, mesh);
+        std::cout << std::format("Changed source: {0:8.2f} ms, {1} indices, {2}", secondsSince(start) * 1000, mesh.indices.size(),
+            check(mesh.indices.size() == referenceIndices.size() + 3) ? "rebuilt" : "STALE") << std::endl;
+    }
+
+    std::filesystem::remove_all(cacheDirectory);
+    std::filesystem::remove(sourcePath);
+}
+
+/**
+    Reports, for the bundled models and a large generated mesh, the vertex buffer memory and the average cache miss
+    ratio of the unindexed triangle list that used to be drawn, of the welded index buffer in file order, and of the
+    welded index buffer after reordering for the vertex cache.
+*/
+void Benchmark::vertexCacheOptimization() {
+    std::filesystem::path syntheticPath = std::filesystem::temp_directory_path() / "ocean-gl-vertex-cache.obj";
+    writeBenchmarkOBJ(syntheticPath, 400);
+    std::vector<std::filesystem::path> paths = {
+        std::filesystem::path(executableDirectory) / "res" / "model" / "cube" / "cube.obj",
+        std::filesystem::path(executableDirectory) / "res" / "model" / "test" / "untitled.obj",
+        syntheticPath
+    };
+
+    std::cout << std::format("{0:<24} {1:>10} {2:>10} {3:>10} {4:>8} {5:>14} {6:>12} {7:>10}", "model", "triangles", "unindexed", "indexed",
+        "saving", "ACMR unindexed", "ACMR welded", "ACMR tipsify") << std::endl;
+    for (auto& path : paths) {
+        std::vector<float> vertexData;
+        std::vector<uint32_t> indices;
+        int vertexCount;
+        if (!MeshCache::buildMesh(path, vertexData, indices, vertexCount, false)) {
+            continue;
+        }
+
+        const size_t vertexSize = MeshCache::VERTEX_STRIDE * sizeof(float);
+        const size_t unindexedBytes = indices.size() * vertexSize;
+        const size_t indexedBytes = vertexCount * vertexSize + indices.size() * sizeof(uint32_t);
+        const float weldedRatio = VertexCache::averageCacheMissRatio(indices, vertexCount);
+
+        auto start = std::chrono::steady_clock::now();
+        VertexCache::optimize(indices, vertexCount);
+        double optimizeSeconds = secondsSince(start);
+        const float optimizedRatio = VertexCache::averageCacheMissRatio(indices, vertexCount);
+
+        std::cout << std::format("{0:<24} {1:>10} {2:>8.1f}KB {3:>8.1f}KB {4:>7.0f}% {5:>14.3f} {6:>12.3f} {7:>12.3f}  ({8:.1f} ms)",
+            path.filename().string(), indices.size() / 3, unindexedBytes / 1024.0, indexedBytes / 1024.0, 100.0 * (1.0 - indexedBytes / (double)unindexedBytes),
+            3.0f, weldedRatio, optimizedRatio, optimizeSeconds * 1000) << std::endl;
+    }
+    std::filesystem::remove(syntheticPath);
+}
+
+/**
+    Compares the float and quantized vertex formats for the bundled models and a large generated mesh. Reports the
+    vertex buffer size and the vertex bytes fetched per draw, estimated from the vertex cache miss ratio, and checks the
+    decoded quantized vertices against the float ones. The bounds are half a quantization step of the mesh bounds for
+    positions, the rounding of a half float for texture coordinates, and 0.01 degrees for normals.
+*/
+void Benchmark::vertexFormat() {
+    const double maxNormalAngle = glm::radians(0.01);
+    std::filesystem::path syntheticPath = std::filesystem::temp_directory_path() / "ocean-gl-vertex-format.obj";
+    writeBenchmarkOBJ(syntheticPath, 400);
+    std::vector<std::filesystem::path> paths = {
+        std::filesystem::path(executableDirectory) / "res" / "model" / "cube" / "cube.obj",
+        std::filesystem::path(executableDirectory) / "res" / "model" / "test" / "untitled.obj",
+        syntheticPath
+    };
+
+    const size_t floatSize = VertexFormat::getVertexSize(VertexFormat::FORMAT_FLOAT);
+    const size_t quantizedSize = VertexFormat::getVertexSize(VertexFormat::FORMAT_QUANTIZED);
+    std::cout << std::format("Vertex size: float {0} bytes, quantized {1} bytes", floatSize, quantizedSize) << std::endl;
+    for (auto& path : paths) {
+        std::vector<float> vertexData;
+        std::vector<uint32_t> indices;
+        int vertexCount;
+        if (!MeshCache::buildMesh(path, vertexData, indices, vertexCount, true)) {
+            continue;
+        }
+
+        VertexFormat::QuantizedMesh quantized;
+        VertexFormat::quantize(vertexData, quantized);
+        const glm::vec3 positionBound = quantized.positionScale / (2.0f * 65535.0f) + 1e-6f * glm::max(glm::abs(quantized.positionOffset), glm::vec3(1));
+        float positionRatio = 0;
+        float textureCoordinateRatio = 0;
+        double normalAngle = 0;
+        for (int i = 0; i < vertexCount; i++) {
+            const float* vertex = &vertexData[i * MeshCache::VERTEX_STRIDE];
+            glm::vec3 position;
+            glm::vec2 textureCoordinate;
+            glm::vec3 normal;
+            VertexFormat::dequantize(quantized.vertices[i], quantized, position, textureCoordinate, normal);
+
+            glm::vec3 positionError = glm::abs(position - glm::vec3(vertex[0], vertex[1], vertex[2])) / positionBound;
+            positionRatio = std::max({ positionRatio, positionError.x, positionError.y, positionError.z });
+            for (int component = 0; component < 2; component++) {
+                // Half floats keep 11 significant bits, so rounding is off by at most 2^-11 of the value
+                float bound = std::max(std::abs(vertex[3 + component]), 6.1e-5f) * std::ldexp(1.0f, -11);
+                textureCoordinateRatio = std::max(textureCoordinateRatio, std::abs(textureCoordinate[component] - vertex[3 + component]) / bound);
+            }
+            glm::dvec3 reference = glm::normalize(glm::dvec3(vertex[5], vertex[6], vertex[7]));
+            // atan2 rather than acos, which loses most of its precision for nearly parallel vectors
+            normalAngle = std::max(normalAngle, std::atan2(glm::length(glm::cross(reference, glm::dvec3(normal))), glm::dot(reference, glm::dvec3(normal))));
+        }
+
+        const double acmr = VertexCache::averageCacheMissRatio(indices, vertexCount);
+        const double fetchedVertices = acmr * indices.size() / 3;
+        std::cout << path.filename().string() << std::endl;
+        std::cout << std::format("    vertex buffer {0:9.1f} KB -> {1:9.1f} KB, fetched per draw {2:9.1f} KB -> {3:9.1f} KB",
+            vertexCount * floatSize / 1024.0, vertexCount * quantizedSize / 1024.0, fetchedVertices * floatSize / 1024.0, fetchedVertices * quantizedSize / 1024.0) << std::endl;
+        std::cout << std::format("    position error {0:.2f} of bound, texture coordinate error {1:.2f} of bound, normal error {2:.5f} degrees, {3}",
+            positionRatio, textureCoordinateRatio, glm::degrees(normalAngle),
+            check(positionRatio <= 1.0f && textureCoordinateRatio <= 1.0f && normalAngle <= maxNormalAngle) ? "within bounds" : "EXCEEDS BOUNDS") << std::endl;
+    }
+    std::filesystem::remove(syntheticPath);
+}
+
+/**
+    Measures the CPU cost of setting the four uniforms of the object program (model and the vertex decoding uniforms):
+    through the std::map<std::string, GLint> cache the shaders used before, by name through the reflected uniform table,
+    and through handles looked up once after linking. No draws are made, so the times are the lookup plus the driver's
+    glUniform call. The camera and time are not included, they are shared by every program through UniformBuffers.
+*/
+void Benchmark::uniformOverhead() {
+    const int draws = 200000;
+    if (!createContext()) {
+        return;
+    }
+
+    GLuint program = glCreateProgram();
+    Shader vertexShader;
+    Shader fragmentShader;
+    vertexShader.compileAndAttach(program, GL_VERTEX_SHADER, "object_passthrough_vertex.glsl");
+    fragmentShader.compileAndAttach(program, GL_FRAGMENT_SHADER, "object_passthrough_fragment.glsl");
+    glLinkProgram(program);
+    glUseProgram(program);
+
+    const glm::vec3 positionOffset = glm::vec3(-1);
+    const glm::vec3 positionScale = glm::vec3(2.0f / 65535);
+    glm::mat4 model = glm::mat4(1);
+
+    std::map<std::string, GLint> locations;
+    auto legacyLocation = [&](const std::string& name) {
+        if (!locations.contains(name)) {
+            locations.emplace(name, glGetUniformLocation(program, name.c_str()));
+        }
+        return locations.at(name);
+    };
+    auto start = std::chrono::steady_clock::now();
+    for (int draw = 0; draw < draws; draw++) {
+        model[3].x = static_cast<float>(draw);
+        glUniformMatrix4fv(legacyLocation("model"), 1, GL_FALSE, &model[0][0]);
+        glUniform3f(legacyLocation("positionOffset"), positionOffset.x, positionOffset.y, positionOffset.z);
+        glUniform3f(legacyLocation("positionScale"), positionScale.x, positionScale.y, positionScale.z);
+        glUniform1i(legacyLocation("octahedralNormals"), 1);
+    }
+    double legacySeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int draw = 0; draw < draws; draw++) {
+        model[3].x = static_cast<float>(draw);
+        vertexShader.setUniformMat4("model", model);
+        vertexShader.setUniformVec3("positionOffset", positionOffset);
+        vertexShader.setUniformVec3("positionScale", positionScale);
+        vertexShader.setUniformInt("octahedralNormals", 1);
+    }
+    double nameSeconds = secondsSince(start);
+
+    const Shader::UniformHandle modelUniform = vertexShader.getUniform("model");
+    const Shader::UniformHandle positionOffsetUniform = vertexShader.getUniform("positionOffset");
+    const Shader::UniformHandle positionScaleUniform = vertexShader.getUniform("positionScale");
+    const Shader::UniformHandle octahedralNormalsUniform = vertexShader.getUniform("octahedralNormals");
+    start = std::chrono::steady_clock::now();
+    for (int draw = 0; draw < draws; draw++) {
+        model[3].x = static_cast<float>(draw);
+        vertexShader.setUniformMat4(modelUniform, model);
+        vertexShader.setUniformVec3(positionOffsetUniform, positionOffset);
+        vertexShader.setUniformVec3(positionScaleUniform, positionScale);
+        vertexShader.setUniformInt(octahedralNormalsUniform, 1);
+    }
+    double handleSeconds = secondsSince(start);
+
+    std::cout << std::format("std::map cache:  {0:7.1f} ns/draw", legacySeconds * 1e9 / draws) << std::endl;
+    std::cout << std::format("By name:         {0:7.1f} ns/draw", nameSeconds * 1e9 / draws) << std::endl;
+    std::cout << std::format("Handles:         {0:7.1f} ns/draw, {1:.1f}x faster than std::map", handleSeconds * 1e9 / draws, legacySeconds / handleSeconds) << std::endl;
+
+    glDeleteProgram(program);
+    OffscreenContext::destroy();
+}
+
+/**
+    Builds the frame the renderer is expected to grow into: shadow, reflection and refraction passes feeding the scene,
+    followed by a bloom chain and a post pass to the backbuffer, plus a debug pass whose output nothing reads. Passes
+    are declared out of order to exercise the scheduler. Passes only clear their targets, so the frame times are the
+    cost of the graph itself. Reports the scheduled order and the render target memory with and without aliasing.
+    The aliased run is profiled and traced, printing the GPU time of each pass and writing frame_graph_trace.json next
+    to the executable. Finally checks that a clear of a target nothing has drawn to since it was cleared is skipped.
+*/
+void Benchmark::frameGraph() {
+    const int frames = 200;
+    const glm::ivec2 size = glm::ivec2(1920, 1080);
+    if (!createContext()) {
+        return;
+    }
+    GLuint renderbuffers[2];
+    GLuint backbuffer = createRenderTarget(size, renderbuffers);
+
+    for (bool aliasing : { false, true }) {
+        FrameGraph graph;
+        Profiler profiler;
+        graph.setBackbufferSize(size);
+        graph.setBackbuffer(backbuffer);
+        graph.setAliasing(aliasing);
+        if (aliasing) {
+            graph.setProfiler(&profiler);
+            profiler.startTrace();
+        }
+        auto full = [](GLenum format) { return FrameGraph::TextureDescription{ .format = format, .width = 0, .height = 0, .scale = 1.0f }; };
+        auto half = [](GLenum format) { return FrameGraph::TextureDescription{ .format = format, .width = 0, .height = 0, .scale = 0.5f }; };
+        FrameGraph::ResourceHandle shadowDepth = graph.createTexture("shadow depth",
+            { .format = GL_DEPTH_COMPONENT24, .width = 2048, .height = 2048, .scale = 0.0f });
+        FrameGraph::ResourceHandle reflectionColor = graph.createTexture("reflection color", half(GL_RGBA16F));
+        FrameGraph::ResourceHandle reflectionDepth = graph.createTexture("reflection depth", half(GL_DEPTH_COMPONENT24));
+        FrameGraph::ResourceHandle refractionColor = graph.createTexture("refraction color", full(GL_RGBA16F));
+        FrameGraph::ResourceHandle refractionDepth = graph.createTexture("refraction depth", full(GL_DEPTH_COMPONENT24));
+        FrameGraph::ResourceHandle sceneColor = graph.createTexture("scene color", full(GL_RGBA16F));
+        FrameGraph::ResourceHandle sceneDepth = graph.createTexture("scene depth", full(GL_DEPTH_COMPONENT24));
+        FrameGraph::ResourceHandle bloomA = graph.createTexture("bloom A", half(GL_RGBA16F));
+        FrameGraph::ResourceHandle bloomB = graph.createTexture("bloom B", half(GL_RGBA16F));
+        FrameGraph::ResourceHandle debugColor = graph.createTexture("debug color", full(GL_RGBA8));
+
+        const GLbitfield colorDepth = GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT;
+        graph.addPass({ .name = "post", .reads = { sceneColor, bloomB }, .writes = { FrameGraph::BACKBUFFER }, .clear = GL_COLOR_BUFFER_BIT });
+        graph.addPass({ .name = "bloom blur", .reads = { bloomA }, .writes = { bloomB }, .clear = GL_COLOR_BUFFER_BIT });
+        graph.addPass({ .name = "bloom downsample", .reads = { sceneColor }, .writes = { bloomA }, .clear = GL_COLOR_BUFFER_BIT });
+        graph.addPass({ .name = "scene", .reads = { shadowDepth, reflectionColor, refractionColor, refractionDepth },
+            .writes = { sceneColor, sceneDepth }, .clear = colorDepth, .clearDepth = 1.0f });
+        graph.addPass({ .name = "debug", .reads = { sceneDepth }, .writes = { debugColor }, .clear = GL_COLOR_BUFFER_BIT });
+        graph.addPass({ .name = "shadow", .writes = { shadowDepth }, .clear = GL_DEPTH_BUFFER_BIT, .clearDepth = 1.0f });
+        graph.addPass({ .name = "reflection", .reads = { shadowDepth }, .writes = { reflectionColor, reflectionDepth }, .clear = colorDepth, .clearDepth = 1.0f });
+        graph.addPass({ .name = "refraction", .reads = { shadowDepth }, .writes = { refractionColor, refractionDepth }, .clear = colorDepth, .clearDepth = 1.0f });
+
+        auto start = std::chrono::steady_clock::now();
+        graph.compile();
+        double compileSeconds = secondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++) {
+            graph.execute();
+            profiler.endFrame();
+        }
+        glFinish();
+        double frameSeconds = secondsSince(start) / frames;
+
+        const FrameGraph::Stats& stats = graph.getStats();
+        if (!aliasing) {
+            std::string order;
+            for (FrameGraph::PassHandle pass : graph.getOrder()) {
+                order += (order.empty() ? "" : " -> ") + graph.getPassName(pass);
+            }
+            std::cout << "Order: " << order << std::endl;
+            std::cout << std::format("Passes: {0} scheduled, {1} culled", stats.passes, stats.culledPasses) << std::endl;
+        }
+        std::cout << std::format("Aliasing {0:>3}: {1} textures for {2} resources, {3:.1f} MB, compile {4:.3f} ms, frame {5:.3f} ms",
+            aliasing ? "on" : "off", stats.textures, stats.transientResources, stats.textureBytes / (1024.0 * 1024.0),
+            compileSeconds * 1000, frameSeconds * 1000) << std::endl;
+
+        if (aliasing) {
+            for (const Profiler::Scope& scope : profiler.getScopes()) {
+                std::cout << std::format("  {0:<18} CPU {1:7.3f} ms  GPU {2:7.3f} ms", scope.name, scope.cpuMilliseconds, scope.gpuMilliseconds) << std::endl;
+            }
+            profiler.stopTrace();
+            std::filesystem::path tracePath = std::filesystem::path(executableDirectory) / "frame_graph_trace.json";
+            if (profiler.writeTrace(tracePath)) {
+                std::cout << std::format("{0} trace events written to {1}, {2} GPU results dropped", profiler.getTraceEventCount(),
+                    tracePath.string(), profiler.getDroppedQueries()) << std::endl;
+            }
+        }
+        graph.release();
+    }
+
+    // A pass that only clears a target is followed by one that clears it to the same values and draws, so the second
+    // clear is skipped. It is not once the first pass draws too, or when the second pass clears to another color.
+    typedef struct {
+        const char* name;
+        bool prepassDraws;
+        glm::vec4 clearColor;
+        int expectedSkippedClears;
+    } ClearCase;
+    const ClearCase clearCases[] = {
+        { .name = "clear only", .prepassDraws = false, .clearColor = glm::vec4(0.0f), .expectedSkippedClears = 1 },
+        { .name = "clear and draw", .prepassDraws = true, .clearColor = glm::vec4(0.0f), .expectedSkippedClears = 0 },
+        { .name = "other color", .prepassDraws = false, .clearColor = glm::vec4(1.0f), .expectedSkippedClears = 0 },
+    };
+    for (const ClearCase& clearCase : clearCases) {
+        FrameGraph graph;
+        graph.setBackbufferSize(size);
+        graph.setBackbuffer(backbuffer);
+        FrameGraph::ResourceHandle color = graph.createTexture("color", { .format = GL_RGBA8, .width = 0, .height = 0, .scale = 1.0f });
+        std::function<void()> draw = []() {};
+        graph.addPass({ .name = "prepass", .writes = { color }, .clear = GL_COLOR_BUFFER_BIT,
+            .execute = clearCase.prepassDraws ? draw : std::function<void()>() });
+        graph.addPass({ .name = "scene", .writes = { color }, .clear = GL_COLOR_BUFFER_BIT, .clearColor = clearCase.clearColor, .execute = draw });
+        graph.addPass({ .name = "post", .reads = { color }, .writes = { FrameGraph::BACKBUFFER }, .clear = GL_COLOR_BUFFER_BIT });
+        graph.execute();
+        int skippedClears = graph.getStats().skippedClears;
+        std::cout << std::format("{0:<15} {1} clears skipped, {2} expected: {3}", std::string(clearCase.name) + ":", skippedClears,
+            clearCase.expectedSkippedClears, check(skippedClears == clearCase.expectedSkippedClears) ? "matches" : "DIFFERS") << std::endl;
+        graph.release();
+    }
+
+    GLState::bindFramebuffer(0);
+    glDeleteFramebuffers(1, &backbuffer);
+    glDeleteRenderbuffers(2, renderbuffers);
+    OffscreenContext::destroy();
+}
+
+/**
+    Draws the water surface alone from a few typical camera poses, with frustum culling of the patches off and on. A
+    GL_PRIMITIVES_GENERATED query counts the triangles the tessellator emits and a GL_TIME_ELAPSED query times the draw.
+    The frame time is the wall time of the draw followed by glFinish.
+*/
+void Benchmark::waterCulling() {
+    const int frames = 5;
+    const glm::ivec2 size = glm::ivec2(1920, 1080);
+    const float time = 12.5f;
+
+    typedef struct {
+        const char* name;
+        glm::vec3 position;
+        // Degrees, as in Camera
+        float yaw;
+        float pitch;
+    } Pose;
+    const Pose poses[] = {
+        { .name = "start view", .position = glm::vec3(0.0f, 30.0f, 200.0f), .yaw = -90.0f, .pitch = -10.0f },
+        { .name = "horizon", .position = glm::vec3(0.0f, 5.0f, 0.0f), .yaw = 0.0f, .pitch = 0.0f },
+        { .name = "looking down", .position = glm::vec3(0.0f, 150.0f, 0.0f), .yaw = 0.0f, .pitch = -60.0f },
+        { .name = "straight down", .position = glm::vec3(0.0f, 50.0f, 0.0f), .yaw = 0.0f, .pitch = -89.0f },
+        { .name = "far out", .position = glm::vec3(40000.0f, 20.0f, -25000.0f), .yaw = 45.0f, .pitch = -5.0f },
+    };
+
+    if (!createContext()) {
+        return;
+    }
+
+    GLuint renderbuffers[2];
+    GLuint framebuffer = createRenderTarget(size, renderbuffers);
+    glEnable(GL_DEPTH_TEST);
+
+    UniformBuffers uniformBuffers;
+    uniformBuffers.init();
+    Water water;
+    water.init(nullptr, 0);
+    uniformBuffers.updateWaves(water.getWaveTable(), water.getWaveCount());
+
+    GLuint queries[2];
+    glGenQueries(2, queries);
+
+    for (const Pose& pose : poses) {
+        const glm::vec3 forward = glm::normalize(glm::vec3(
+            cos(glm::radians(pose.yaw)) * cos(glm::radians(pose.pitch)),
+            sin(glm::radians(pose.pitch)),
+            sin(glm::radians(pose.yaw)) * cos(glm::radians(pose.pitch))));
+        UniformBuffers::FrameData frame = {
+            .view = glm::lookAt(pose.position, pose.position + forward, glm::vec3(0.0f, 1.0f, 0.0f)),
+            .projection = glm::perspective(glm::radians(45.0f), size.x / (float)size.y, 0.1f, 10000.0f),
+            .cameraPosition = pose.position,
+            .time = time,
+            .underwaterFlag = 0,
+            .viewportSize = glm::vec2(size)
+        };
+        uniformBuffers.updateFrame(frame);
+        water.updateGrid(pose.position);
+
+        std::string line = std::format("{0:<14}", pose.name);
+        for (bool culling : { false, true }) {
+            water.setFrustumCulling(culling);
+            GLuint64 triangles = 0;
+            GLuint64 gpuNanoseconds = 0;
+            double frameSeconds = 0.0;
+            for (int i = 0; i < frames; i++) {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                glFinish();
+                auto start = std::chrono::steady_clock::now();
+                glBeginQuery(GL_PRIMITIVES_GENERATED, queries[0]);
+                glBeginQuery(GL_TIME_ELAPSED, queries[1]);
+                water.render();
+                glEndQuery(GL_TIME_ELAPSED);
+                glEndQuery(GL_PRIMITIVES_GENERATED);
+                glFinish();
+                frameSeconds += secondsSince(start);
+
+                GLuint64 result;
+                glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &triangles);
+                glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &result);
+                gpuNanoseconds += result;
+            }
+            line += std::format("  culling {0:>3}: {1:>9} triangles, GPU {2:8.3f} ms, frame {3:8.3f} ms", culling ? "on" : "off",
+                triangles, gpuNanoseconds / 1e6 / frames, frameSeconds * 1000 / frames);
+        }
+        std::cout << line << std::endl;
+    }
+
+    glDeleteQueries(2, queries);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(2, renderbuffers);
+    OffscreenContext::destroy();
+}
+
+/**
+    Selects the water patches for a range of view distances and counts the patches and the triangles the tessellator
+    emits with frustum culling on, next to the number of smallest patches a fixed grid would need to cover the same
+    distance. The camera is then moved far from the origin to show the patch count does not depend on its position.
+*/
+void Benchmark::waterGrid() {
+    const glm::ivec2 size = glm::ivec2(1920, 1080);
+    const glm::vec3 forward = glm::normalize(glm::vec3(0.0f, -0.17f, -1.0f));
+    const float viewDistances[] = { 1000.0f, 2000.0f, 5000.0f, 10000.0f, 20000.0f, 50000.0f };
+    const int updates = 100;
+
+    if (!createContext()) {
+        return;
+    }
+
+    GLuint renderbuffers[2];
+    GLuint framebuffer = createRenderTarget(size, renderbuffers);
+    glEnable(GL_DEPTH_TEST);
+
+    UniformBuffers uniformBuffers;
+    uniformBuffers.init();
+    Water water;
+    water.init(nullptr, 0);
+    uniformBuffers.updateWaves(water.getWaveTable(), water.getWaveCount());
+    GLuint query;
+    glGenQueries(1, &query);
+
+    auto measure = [&](glm::vec3 position, float viewDistance) {
+        WaterGridSettings settings = water.getGrid().getSettings();
+        settings.viewDistance = viewDistance;
+        water.getGrid().setSettings(settings);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < updates; i++) {
+            water.updateGrid(position);
+        }
+        double updateSeconds = secondsSince(start) / updates;
+
+        UniformBuffers::FrameData frame = {
+            .view = glm::lookAt(position, position + forward, glm::vec3(0.0f, 1.0f, 0.0f)),
+            .projection = glm::perspective(glm::radians(45.0f), size.x / (float)size.y, 0.1f, viewDistance),
+            .cameraPosition = position,
+            .time = 12.5f,
+            .underwaterFlag = 0,
+            .viewportSize = glm::vec2(size)
+        };
+        uniformBuffers.updateFrame(frame);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glBeginQuery(GL_PRIMITIVES_GENERATED, query);
+        water.render();
+        glEndQuery(GL_PRIMITIVES_GENERATED);
+        GLuint64 triangles = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &triangles);
+
+        const float patchSize = settings.patchSize;
+        const double fixedPatches = std::pow(std::ceil(2.0 * viewDistance / patchSize), 2.0);
+        std::cout << std::format("View distance {0:>7.0f} m at ({1:.0f}, {2:.0f}): {3:>5} patches, {4:>9} triangles, update {5:6.3f} ms, fixed grid {6:>9.0f} patches",
+            viewDistance, position.x, position.z, water.getGrid().getPatches().size(), triangles, updateSeconds * 1000, fixedPatches) << std::endl;
+    };
+
+    for (float viewDistance : viewDistances) {
+        measure(glm::vec3(0.0f, 30.0f, 200.0f), viewDistance);
+    }
+    measure(glm::vec3(123456.0f, 30.0f, -654321.0f), 10000.0f);
+
+    glDeleteQueries(1, &query);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(2, renderbuffers);
+    OffscreenContext::destroy();
+}
+
+/**
+    Counts the triangles the tessellator emits for the start view at several resolutions and target triangle sizes,
+    along with the screen area per triangle. With the levels set from the projected size of the patch edges, the
+    triangle count follows the pixel count, so the area per triangle stays about the same at every resolution.
+*/
+void Benchmark::waterTessellation() {
+    const glm::ivec2 sizes[] = { glm::ivec2(1280, 720), glm::ivec2(1920, 1080), glm::ivec2(3840, 2160) };
+    const float triangleSizes[] = { 4.0f, 8.0f, 16.0f };
+    const glm::vec3 position = glm::vec3(0.0f, 30.0f, 200.0f);
+    const glm::vec3 forward = glm::normalize(glm::vec3(0.0f, -0.17f, -1.0f));
+
+    if (!createContext()) {
+        return;
+    }
+    glEnable(GL_DEPTH_TEST);
+
+    UniformBuffers uniformBuffers;
+    uniformBuffers.init();
+    Water water;
+    water.init(nullptr, 0);
+    uniformBuffers.updateWaves(water.getWaveTable(), water.getWaveCount());
+    water.updateGrid(position);
+    GLuint query;
+    glGenQueries(1, &query);
+
+    for (glm::ivec2 size : sizes) {
+        GLuint renderbuffers[2];
+        GLuint framebuffer = createRenderTarget(size, renderbuffers);
+        UniformBuffers::FrameData frame = {
+            .view = glm::lookAt(position, position + forward, glm::vec3(0.0f, 1.0f, 0.0f)),
+            .projection = glm::perspective(glm::radians(45.0f), size.x / (float)size.y, 0.1f, 10000.0f),
+            .cameraPosition = position,
+            .time = 12.5f,
+            .underwaterFlag = 0,
+            .viewportSize = glm::vec2(size)
+        };
+        uniformBuffers.updateFrame(frame);
+
+        for (float triangleSize : triangleSizes) {
+            water.setTriangleSize(triangleSize);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            auto start = std::chrono::steady_clock::now();
+            glBeginQuery(GL_PRIMITIVES_GENERATED, query);
+            water.render();
+            glEndQuery(GL_PRIMITIVES_GENERATED);
+            GLuint64 triangles = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &triangles);
+            double seconds = secondsSince(start);
+
+            std::cout << std::format("{0:>4}x{1:<4} triangle size {2:>4.0f} px: {3:>8} triangles, {4:6.1f} pixels per triangle, draw {5:8.2f} ms",
+                size.x, size.y, triangleSize, triangles, size.x * size.y / std::max(double(triangles), 1.0), seconds * 1000) << std::endl;
+        }
+
+        GLState::bindFramebuffer(0);
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(2, renderbuffers);
+    }
+
+    glDeleteQueries(1, &query);
+    OffscreenContext::destroy();
+}
+
+/**
+    Compares summing the 20 Gerstner waves in the eval shader against looking them up in the baked window around the
+    camera. The vertex stages are timed alone, with rasterization discarded, at 1920x1080 for several triangle sizes,
+    and the bake is timed on its own. The baked displacement is then read back and compared with the waves summed on
+    the CPU at random locations inside the window, interpolated bilinearly like the eval shader's lookups at mip level
+    0, and at the texel centers, where the only difference is float rounding.
+*/
+void Benchmark::waterBake() {
+    const int resolutions[] = { 512, 1024, 2048 };
+    const float triangleSizes[] = { 16.0f, 8.0f, 4.0f };
+    const float windowSize = 1024.0f;
+    const glm::ivec2 size = glm::ivec2(1920, 1080);
+    const glm::vec3 position = glm::vec3(0.0f, 30.0f, 200.0f);
+    const glm::vec3 forward = glm::normalize(glm::vec3(0.0f, -0.17f, -1.0f));
+    const float time = 12.5f;
+    const int sampleCount = 100000;
+
+    if (!createContext()) {
+        return;
+    }
+    GLuint renderbuffers[2];
+    GLuint framebuffer = createRenderTarget(size, renderbuffers);
+    glEnable(GL_DEPTH_TEST);
+
+    UniformBuffers uniformBuffers;
+    uniformBuffers.init();
+    Water water;
+    water.init(nullptr, 0);
+    uniformBuffers.updateWaves(water.getWaveTable(), water.getWaveCount());
+    UniformBuffers::FrameData frame = {
+        .view = glm::lookAt(position, position + forward, glm::vec3(0.0f, 1.0f, 0.0f)),
+        .projection = glm::perspective(glm::radians(45.0f), size.x / (float)size.y, 0.1f, 10000.0f),
+        .cameraPosition = position,
+        .time = time,
+        .underwaterFlag = 0,
+        .viewportSize = glm::vec2(size)
+    };
+    uniformBuffers.updateFrame(frame);
+    water.updateGrid(position);
+    GLuint queries[2];
+    glGenQueries(2, queries);
+
+    // Draws once to warm up, then times a second draw and counts its triangles. Timed on the CPU to the end of the
+    // draw, some drivers report no GPU time for draws whose rasterization is discarded.
+    auto timeVertexStages = [&](double& milliseconds, GLuint64& triangles) {
+        glEnable(GL_RASTERIZER_DISCARD);
+        water.render();
+        glFinish();
+        auto start = std::chrono::steady_clock::now();
+        glBeginQuery(GL_PRIMITIVES_GENERATED, queries[1]);
+        water.render();
+        glEndQuery(GL_PRIMITIVES_GENERATED);
+        glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &triangles);
+        glFinish();
+        milliseconds = secondsSince(start) * 1000;
+        glDisable(GL_RASTERIZER_DISCARD);
+    };
+
+    double analyticMilliseconds[std::size(triangleSizes)];
+    for (int i = 0; i < std::size(triangleSizes); i++) {
+        water.setTriangleSize(triangleSizes[i]);
+        GLuint64 triangles = 0;
+        timeVertexStages(analyticMilliseconds[i], triangles);
+        std::cout << std::format("Summed waves, triangle size {0:>4.0f} px: {1:>8} triangles, vertex stages {2:8.2f} ms",
+            triangleSizes[i], triangles, analyticMilliseconds[i]) << std::endl;
+    }
+
+    // Forward evaluation of the waves, a single solver iteration at the undisplaced location
+    std::vector<glm::vec2> locations = randomLocations(sampleCount, 0.5f * windowSize);
+    WaveSampler::Waves waves;
+    WaveSampler::prepareWaves(water.getWaveTable(), water.getWaveCount(), time, waves);
+    WaveSampler::Batch batch;
+    auto sumWaves = [&]() {
+        WaveSampler::sample(waves, { .tolerance = 0.0f, .maxIterations = 1, .newton = false }, batch);
+    };
+
+    for (int resolution : resolutions) {
+        water.setWaveBakeSettings({ .enabled = true, .resolution = resolution, .windowSize = windowSize });
+        water.bakeWaves();
+        glBeginQuery(GL_TIME_ELAPSED, queries[0]);
+        water.bakeWaves();
+        glEndQuery(GL_TIME_ELAPSED);
+        GLuint64 bakeNanoseconds = 0;
+        glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &bakeNanoseconds);
+        GLState::bindFramebuffer(framebuffer);
+        glViewport(0, 0, size.x, size.y);
+
+        std::cout << std::format("Baked {0}x{0} over {1:.0f} m ({2:.2f} m texels): bake {3:8.2f} ms", resolution, windowSize,
+            windowSize / resolution, bakeNanoseconds / 1e6) << std::endl;
+        for (int i = 0; i < std::size(triangleSizes); i++) {
+            water.setTriangleSize(triangleSizes[i]);
+            double milliseconds;
+            GLuint64 triangles = 0;
+            timeVertexStages(milliseconds, triangles);
+            std::cout << std::format("    triangle size {0:>4.0f} px: {1:>8} triangles, vertex stages {2:8.2f} ms ({3:.2f}x)",
+                triangleSizes[i], triangles, milliseconds, analyticMilliseconds[i] / milliseconds) << std::endl;
+        }
+
+        std::vector<glm::vec4> texels(static_cast<size_t>(resolution) * resolution);
+        GLState::activeTexture(GL_TEXTURE0);
+        GLState::bindTexture(GL_TEXTURE_2D, water.getBakedDisplacementTexture());
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, texels.data());
+
+        // Texel centers are at (i + 0.5) / resolution * windowSize plus whole windows, the copy nearest the camera is baked
+        const float texelSize = windowSize / resolution;
+        auto texel = [&](int x, int z) {
+            x = ((x % resolution) + resolution) % resolution;
+            z = ((z % resolution) + resolution) % resolution;
+            return texels[static_cast<size_t>(z) * resolution + x];
+        };
+        auto bilinear = [&](glm::vec2 location) {
+            const glm::vec2 grid = location / texelSize - 0.5f;
+            const glm::vec2 cell = glm::floor(grid);
+            const glm::vec2 t = grid - cell;
+            const int x = static_cast<int>(cell.x);
+            const int z = static_cast<int>(cell.y);
+            return glm::mix(glm::mix(texel(x, z), texel(x + 1, z), t.x), glm::mix(texel(x, z + 1), texel(x + 1, z + 1), t.x), t.y);
+        };
+
+        float maxErrors[2] = {};
+        double squaredErrors[2] = {};
+        for (int pass = 0; pass < 2; pass++) {
+            WaveSampler::resize(batch, sampleCount);
+            for (int i = 0; i < sampleCount; i++) {
+                glm::vec2 location = glm::vec2(position.x, position.z) + locations[i] * (1.0f - 4.0f / resolution);
+                if (pass == 1) {
+                    location = (glm::floor(location / texelSize) + 0.5f) * texelSize;
+                }
+                batch.x[i] = location.x;
+                batch.z[i] = location.y;
+            }
+            sumWaves();
+            for (int i = 0; i < sampleCount; i++) {
+                const float error = std::abs(bilinear(glm::vec2(batch.x[i], batch.z[i])).y - batch.height[i]);
+                maxErrors[pass] = std::max(maxErrors[pass], error);
+                squaredErrors[pass] += static_cast<double>(error) * error;
+            }
+        }
+        std::cout << std::format("    height error: interpolated max {0:.4f} m, rms {1:.4f} m; at texel centers max {2:.1e} m",
+            maxErrors[0], std::sqrt(squaredErrors[0] / sampleCount), maxErrors[1]) << std::endl;
+    }
+
+    glDeleteQueries(2, queries);
+    GLState::bindFramebuffer(0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(2, renderbuffers);
+    OffscreenContext::destroy();
+}
+
+/**
+    Compares the wave counts with kernels of their own against their neighbors, which run the generic kernel. On the
+    CPU, batched queries are timed for each instruction set and reported per wave evaluated, the number of waves times
+    the solver iterations of each query, so counts that need more iterations are not penalized. On the GPU, the water
+    programs are rebuilt for each count and the vertex stages are timed alone at 1920x1080, as in waterBake.
+*/
+void Benchmark::waveCount() {
+    const int waveCounts[] = { 8, 9, 16, 17, 20, 32, 33, 64 };
+    const glm::ivec2 size = glm::ivec2(1920, 1080);
+    const glm::vec3 position = glm::vec3(0.0f, 30.0f, 200.0f);
+    const glm::vec3 forward = glm::normalize(glm::vec3(0.0f, -0.17f, -1.0f));
+    const float time = 12.5f;
+    const int queryCount = 20000;
+
+    std::vector<WaveSampler::InstructionSet> instructionSets = { WaveSampler::INSTRUCTION_SET_SCALAR };
+    if (WaveSampler::getInstructionSet() >= WaveSampler::INSTRUCTION_SET_SSE2) {
+        instructionSets.push_back(WaveSampler::INSTRUCTION_SET_SSE2);
+    }
+    if (WaveSampler::getInstructionSet() >= WaveSampler::INSTRUCTION_SET_AVX2) {
+        instructionSets.push_back(WaveSampler::INSTRUCTION_SET_AVX2);
+    }
+    std::vector<glm::vec2> locations = randomLocations(queryCount, 2000.0f);
+    WaveSampler::Batch batch;
+    WaveSampler::resize(batch, queryCount);
+    for (int i = 0; i < queryCount; i++) {
+        batch.x[i] = locations[i].x;
+        batch.z[i] = locations[i].y;
+    }
+
+    std::cout << std::format("{0:<6} {1:<9} {2:>10}", "waves", "kernel", "iterations");
+    for (auto instructionSet : instructionSets) {
+        std::cout << std::format(" {0:>9} ns/query {1:>7} ns/wave", WaveSampler::getInstructionSetName(instructionSet), "");
+    }
+    std::cout << std::endl;
+    for (int waveCount : waveCounts) {
+        Water water;
+        water.setWaveCount(waveCount);
+        WaveSampler::Waves waves;
+        WaveSampler::prepareWaves(water.getWaveTable(), water.getWaveCount(), time, waves);
+        const bool specialized = std::find(std::begin(WaveSampler::SPECIALIZED_WAVE_COUNTS), std::end(WaveSampler::SPECIALIZED_WAVE_COUNTS),
+            waveCount) != std::end(WaveSampler::SPECIALIZED_WAVE_COUNTS);
+
+        std::string line;
+        long long totalIterations = 0;
+        for (auto instructionSet : instructionSets) {
+            // Warms up the kernel, then takes the faster of two runs
+            WaveSampler::sample(waves, water.getSolverSettings(), batch, 0, batch.x.size(), instructionSet);
+            double seconds = 1e9;
+            for (int run = 0; run < 2; run++) {
+                auto start = std::chrono::steady_clock::now();
+                WaveSampler::sample(waves, water.getSolverSettings(), batch, 0, batch.x.size(), instructionSet);
+                seconds = std::min(seconds, secondsSince(start));
+            }
+            totalIterations = 0;
+            for (int i = 0; i < queryCount; i++) {
+                totalIterations += batch.iterations[i];
+            }
+            line += std::format(" {0:>18.1f} {1:>15.2f}", seconds * 1e9 / queryCount, seconds * 1e9 / (static_cast<double>(totalIterations) * waveCount));
+        }
+        std::cout << std::format("{0:<6} {1:<9} {2:>10.2f}", waveCount, specialized ? "unrolled" : "generic",
+            totalIterations / static_cast<double>(queryCount)) << line << std::endl;
+    }
+
+    if (!createContext()) {
+        return;
+    }
+    GLuint renderbuffers[2];
+    GLuint framebuffer = createRenderTarget(size, renderbuffers);
+    glEnable(GL_DEPTH_TEST);
+
+    UniformBuffers uniformBuffers;
+    uniformBuffers.init();
+    Water water;
+    water.init(nullptr, 0);
+    UniformBuffers::FrameData frame = {
+        .view = glm::lookAt(position, position + forward, glm::vec3(0.0f, 1.0f, 0.0f)),
+        .projection = glm::perspective(glm::radians(45.0f), size.x / (float)size.y, 0.1f, 10000.0f),
+        .cameraPosition = position,
+        .time = time,
+        .underwaterFlag = 0,
+        .viewportSize = glm::vec2(size)
+    };
+    uniformBuffers.updateFrame(frame);
+    water.updateGrid(position);
+
+    for (int waveCount : waveCounts) {
+        glFinish();
+        auto start = std::chrono::steady_clock::now();
+        water.setWaveCount(waveCount);
+        glFinish();
+        const double buildMilliseconds = secondsSince(start) * 1000;
+        uniformBuffers.updateWaves(water.getWaveTable(), water.getWaveCount());
+
+        // Draws once to warm up, then times a second draw with rasterization discarded
+        glEnable(GL_RASTERIZER_DISCARD);
+        water.render();
+        glFinish();
+        start = std::chrono::steady_clock::now();
+        water.render();
+        glFinish();
+        const double drawMilliseconds = secondsSince(start) * 1000;
+        glDisable(GL_RASTERIZER_DISCARD);
+        std::cout << std::format("{0:>2} waves: program build {1:8.2f} ms, vertex stages {2:8.2f} ms", waveCount,
+            buildMilliseconds, drawMilliseconds) << std::endl;
+    }
+
+    GLState::bindFramebuffer(0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(2, renderbuffers);
+    OffscreenContext::destroy();
+}
+
+/**
+    Times the FFT ocean at 128, 256 and 512 nodes per side. On the CPU, a full update and the four 2D FFTs it contains,
+    and batched wave queries answered from the tile against the 20 Gerstner waves. On the GPU, uploading the textures
+    with their mipmaps, and drawing the water for the start view with the Gerstner waves and with the ocean tile.
+*/
+void Benchmark::oceanSpectrum() {
+    const int resolutions[] = { 128, 256, 512 };
+    const glm::ivec2 size = glm::ivec2(1280, 720);
+    const glm::vec3 position = glm::vec3(0.0f, 30.0f, 200.0f);
+    const glm::vec3 forward = glm::normalize(glm::vec3(0.0f, -0.17f, -1.0f));
+    const float time = 12.5f;
+    const int queryCount = 100000;
+
+    if (!createContext()) {
+        return;
+    }
+    GLuint renderbuffers[2];
+    GLuint framebuffer = createRenderTarget(size, renderbuffers);
+    glEnable(GL_DEPTH_TEST);
+
+    UniformBuffers uniformBuffers;
+    uniformBuffers.init();
+    Water water;
+    water.init(nullptr, 0);
+    uniformBuffers.updateWaves(water.getWaveTable(), water.getWaveCount());
+    UniformBuffers::FrameData frame = {
+        .view = glm::lookAt(position, position + forward, glm::vec3(0.0f, 1.0f, 0.0f)),
+        .projection = glm::perspective(glm::radians(45.0f), size.x / (float)size.y, 0.1f, 10000.0f),
+        .cameraPosition = position,
+        .time = time,
+        .underwaterFlag = 0,
+        .viewportSize = glm::vec2(size)
+    };
+    uniformBuffers.updateFrame(frame);
+    water.updateGrid(position);
+    GLuint query;
+    glGenQueries(1, &query);
+
+    std::vector<glm::vec2> locations = randomLocations(queryCount, 500.0f);
+    std::vector<float> heights(queryCount);
+    std::vector<glm::vec3> normals(queryCount);
+
+    // Draws the water once to warm up and then times a second draw on the GPU
+    auto timeDraw = [&]() {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        water.render();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        water.render();
+        glEndQuery(GL_TIME_ELAPSED);
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+        return nanoseconds / 1e6;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    water.approximateWaveGeometryBatch(locations, time, heights, normals);
+    double gerstnerQuerySeconds = secondsSince(start);
+    double gerstnerDrawMilliseconds = timeDraw();
+    std::cout << std::format("Gerstner, {0} waves: queries {1:6.1f} ns/query, draw {2:8.2f} ms",
+        water.getWaveCount(), gerstnerQuerySeconds * 1e9 / queryCount, gerstnerDrawMilliseconds) << std::endl;
+
+    for (int resolution : resolutions) {
+        OceanSettings settings = water.getOcean().getSettings();
+        settings.enabled = true;
+        settings.cascadeCount = 1;
+        settings.cascades[0] = { .tileSize = 256.0f, .resolution = resolution, .updateInterval = 1 };
+        water.getOcean().setSettings(settings);
+        water.updateOcean(time);
+
+        const int updates = std::max(4, 2 * 512 * 512 / (resolution * resolution));
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < updates; i++) {
+            water.updateOcean(time);
+        }
+        double updateSeconds = secondsSince(start) / updates;
+
+        FFT fft;
+        fft.init(resolution, true);
+        std::vector<FFT::Complex> grid(resolution * resolution, FFT::Complex(1.0f));
+        std::vector<FFT::Complex> scratch(resolution * resolution);
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < updates * 4; i++) {
+            fft.transform2D(grid.data(), scratch.data());
+        }
+        double fftSeconds = secondsSince(start) / updates;
+
+        start = std::chrono::steady_clock::now();
+        water.approximateWaveGeometryBatch(locations, time, heights, normals);
+        double querySeconds = secondsSince(start);
+
+        // The first render after an update uploads the textures
+        glFinish();
+        start = std::chrono::steady_clock::now();
+        water.render();
+        glFinish();
+        double uploadAndDrawSeconds = secondsSince(start);
+        double drawMilliseconds = timeDraw();
+
+        std::cout << std::format("{0}x{0} FFT ocean, {1} waves, {2:.1f} MB", resolution, resolution * resolution,
+            water.getOcean().getMemoryUsage() / (1024.0 * 1024.0)) << std::endl;
+        std::cout << std::format("    update {0:8.3f} ms, of which 4 2D FFTs {1:8.3f} ms", updateSeconds * 1000, fftSeconds * 1000) << std::endl;
+        std::cout << std::format("    queries {0:6.1f} ns/query, upload and first draw {1:8.2f} ms, draw {2:8.2f} ms",
+            querySeconds * 1e9 / queryCount, uploadAndDrawSeconds * 1000, drawMilliseconds) << std::endl;
+    }
+
+    glDeleteQueries(1, &query);
+    GLState::bindFramebuffer(0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(2, renderbuffers);
+    OffscreenContext::destroy();
+}
+
+/**
+    Measures the CPU ocean update without rendering, as on a simulation node that only answers wave queries. First the
+    four 2D transforms of an update on one thread, as interleaved complex rows against split planes transformed a band
+    of columns at a time with SIMD. Then full updates through Water on 1 to 32 threads for several resolutions, with the
+    largest difference from the single thread displacement, which should be 0 since every node is computed the same way
+    on any thread. Thread counts above the hardware thread count, printed first, only add switching overhead.
+*/
+void Benchmark::oceanSolverScaling() {
+    const int resolutions[] = { 128, 256, 512, 1024 };
+    const int threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+    const float time = 12.5f;
+    std::cout << std::format("Hardware threads: {0}", std::thread::hardware_concurrency()) << std::endl;
+
+    for (int resolution : resolutions) {
+        const size_t nodeCount = static_cast<size_t>(resolution) * resolution;
+        const int repeats = std::max(2, 4 * 512 * 512 / static_cast<int>(nodeCount));
+        FFT fft;
+        fft.init(resolution, true);
+
+        std::vector<FFT::Complex> interleaved(nodeCount, FFT::Complex(1.0f, 0.5f));
+        std::vector<FFT::Complex> scratch(nodeCount);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats * 4; i++) {
+            fft.transform2D(interleaved.data(), scratch.data());
+        }
+        double interleavedSeconds = secondsSince(start) / repeats;
+
+        std::vector<float> planes[4];
+        for (std::vector<float>& plane : planes) {
+            plane.assign(nodeCount, 1.0f);
+        }
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats * 4; i++) {
+            fft.transformColumns(planes[0].data(), planes[1].data(), 0, resolution);
+            FFT::transpose(planes[0].data(), planes[2].data(), resolution, 0, resolution);
+            FFT::transpose(planes[1].data(), planes[3].data(), resolution, 0, resolution);
+            fft.transformColumns(planes[2].data(), planes[3].data(), 0, resolution);
+            FFT::transpose(planes[2].data(), planes[0].data(), resolution, 0, resolution);
+            FFT::transpose(planes[3].data(), planes[1].data(), resolution, 0, resolution);
+        }
+        double splitSeconds = secondsSince(start) / repeats;
+        std::cout << std::format("{0}x{0}: 4 2D FFTs on one thread, interleaved {1:8.3f} ms, split SIMD {2:8.3f} ms ({3:.2f}x)",
+            resolution, interleavedSeconds * 1000, splitSeconds * 1000, interleavedSeconds / splitSeconds) << std::endl;
+
+        Water water;
+        water.setWaveParameters();
+        std::vector<glm::vec4> reference;
+        double singleThreadSeconds = 0.0;
+        for (int threadCount : threadCounts) {
+            OceanSettings settings = water.getOcean().getSettings();
+            settings.enabled = true;
+            settings.cascadeCount = 1;
+            settings.cascades[0] = { .tileSize = 256.0f, .resolution = resolution, .updateInterval = 1 };
+            water.getOcean().setSettings(settings);
+            ThreadPool threadPool;
+            threadPool.init(threadCount);
+            water.getOcean().setThreadPool(&threadPool);
+            water.updateOcean(time);
+
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repeats; i++) {
+                water.updateOcean(time);
+            }
+            double seconds = secondsSince(start) / repeats;
+
+            const std::vector<glm::vec4>& displacements = water.getOcean().getCascade(0).getDisplacements();
+            if (threadCount == 1) {
+                reference = displacements;
+                singleThreadSeconds = seconds;
+            }
+            float maxDifference = 0.0f;
+            for (size_t i = 0; i < nodeCount; i++) {
+                maxDifference = std::max(maxDifference, glm::length(displacements[i] - reference[i]));
+            }
+
+            glm::vec3 wavePosition, waveNormal;
+            water.approximateWaveGeometry(glm::vec3(10.0f, 0.0f, 20.0f), time, wavePosition, waveNormal);
+            std::cout << std::format("    {0:>2} threads: update {1:8.3f} ms, speedup {2:5.2f}x, max difference {3:.1e} m, height at (10, 20) {4:.3f} m",
+                threadCount, seconds * 1000, singleThreadSeconds / seconds, maxDifference, wavePosition.y) << std::endl;
+            water.getOcean().setThreadPool(nullptr);
+        }
+    }
+}
+
+/**
+    Compares ways of covering both long swells and short chop with the FFT ocean: one small tile, which repeats every
+    256 m, one large fine tile, and three cascades updated every frame or at intervals of 4, 2 and 1 frames. Prints the
+    CPU update time per frame averaged over 16 frames, the GPU draw time for the start view, the batched query time and
+    the significant wave height, four times the standard deviation of the queried heights, which should agree between
+    configurations covering the same wavenumbers since the cascades split them without overlap.
+*/
+void Benchmark::oceanCascades() {
+    typedef struct {
+        const char* name;
+        int cascadeCount;
+        OceanCascadeSettings cascades[3];
+    } Configuration;
+    // Ordered by memory, which is kept by each cascade when its resolution drops
+    const Configuration configurations[] = {
+        { "1 tile 256 m, 256x256", 1, { { 256.0f, 256, 1 } } },
+        { "3 cascades, every frame", 3, { { 1024.0f, 256, 1 }, { 256.0f, 256, 1 }, { 64.0f, 256, 1 } } },
+        { "3 cascades, every 4, 2, 1 frames", 3, { { 1024.0f, 256, 4 }, { 256.0f, 256, 2 }, { 64.0f, 256, 1 } } },
+        { "1 tile 1024 m, 1024x1024", 1, { { 1024.0f, 1024, 1 } } }
+    };
+    const glm::ivec2 size = glm::ivec2(1280, 720);
+    const glm::vec3 position = glm::vec3(0.0f, 30.0f, 200.0f);
+    const glm::vec3 forward = glm::normalize(glm::vec3(0.0f, -0.17f, -1.0f));
+    const float startTime = 12.5f;
+    const int frames = 16;
+    const int queryCount = 100000;
+
+    if (!createContext()) {
+        return;
+    }
+    GLuint renderbuffers[2];
+    GLuint framebuffer = createRenderTarget(size, renderbuffers);
+    glEnable(GL_DEPTH_TEST);
+
+    UniformBuffers uniformBuffers;
+    uniformBuffers.init();
+    Water water;
+    water.init(nullptr, 0);
+    uniformBuffers.updateWaves(water.getWaveTable(), water.getWaveCount());
+    UniformBuffers::FrameData frame = {
+        .view = glm::lookAt(position, position + forward, glm::vec3(0.0f, 1.0f, 0.0f)),
+        .projection = glm::perspective(glm::radians(45.0f), size.x / (float)size.y, 0.1f, 10000.0f),
+        .cameraPosition = position,
+        .time = startTime,
+        .underwaterFlag = 0,
+        .viewportSize = glm::vec2(size)
+    };
+    uniformBuffers.updateFrame(frame);
+    water.updateGrid(position);
+    GLuint query;
+    glGenQueries(1, &query);
+
+    std::vector<glm::vec2> locations = randomLocations(queryCount, 2000.0f);
+    std::vector<float> heights(queryCount);
+    std::vector<glm::vec3> normals(queryCount);
+
+    for (const Configuration& configuration : configurations) {
+        OceanSettings settings = water.getOcean().getSettings();
+        settings.enabled = true;
+        settings.cascadeCount = configuration.cascadeCount;
+        for (int i = 0; i < configuration.cascadeCount; i++) {
+            settings.cascades[i] = configuration.cascades[i];
+        }
+        water.getOcean().setSettings(settings);
+        water.updateOcean(startTime);
+        water.render();
+
+        // Each frame updates the cascades due and uploads their textures, 60 frames per second of simulated time
+        float time = startTime;
+        double updateSeconds = 0.0;
+        double uploadSeconds = 0.0;
+        for (int i = 0; i < frames; i++) {
+            time += 1.0f / 60.0f;
+            auto start = std::chrono::steady_clock::now();
+            water.updateOcean(time);
+            updateSeconds += secondsSince(start);
+            glFinish();
+            start = std::chrono::steady_clock::now();
+            water.render();
+            glFinish();
+            uploadSeconds += secondsSince(start);
+        }
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        water.render();
+        glEndQuery(GL_TIME_ELAPSED);
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+
+        auto start = std::chrono::steady_clock::now();
+        water.approximateWaveGeometryBatch(locations, time, heights, normals);
+        double querySeconds = secondsSince(start);
+        double sum = 0.0;
+        double sumOfSquares = 0.0;
+        for (float height : heights) {
+            sum += height;
+            sumOfSquares += static_cast<double>(height) * height;
+        }
+        double mean = sum / queryCount;
+        double significantHeight = 4.0 * std::sqrt(std::max(sumOfSquares / queryCount - mean * mean, 0.0));
+
+        const OceanCascadeSettings& smallest = configuration.cascades[configuration.cascadeCount - 1];
+        std::cout << std::format("{0}: repeats every {1:.0f} m, shortest wave {2:.2f} m, {3:.1f} MB", configuration.name,
+            configuration.cascades[0].tileSize, 2.0f * smallest.tileSize / smallest.resolution,
+            water.getOcean().getMemoryUsage() / (1024.0 * 1024.0)) << std::endl;
+        std::cout << std::format("    update {0:8.3f} ms/frame, upload and draw {1:8.2f} ms/frame, draw {2:8.2f} ms",
+            updateSeconds * 1000 / frames, uploadSeconds * 1000 / frames, nanoseconds / 1e6) << std::endl;
+        std::cout << std::format("    queries {0:6.1f} ns/query, significant wave height {1:.2f} m",
+            querySeconds * 1e9 / queryCount, significantHeight) << std::endl;
+    }
+
+    glDeleteQueries(1, &query);
+    GLState::bindFramebuffer(0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(2, renderbuffers);
+    OffscreenContext::destroy();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+/**
+    Command line benchmarks. Each benchmark is selected with its own flag, for example "ocean-gl --benchmark-waves",
+    and runs to completion before the main window is created. Benchmarks that need OpenGL create their own hidden window.
+    Some benchmarks also check their results, such as the error of an approximation against its bound or the output of
+    an optimized path against the original, and report any failed check through run.
+*/
+namespace Benchmark {
+	// Returns false if no benchmark was selected. passed is set to false if a check of any selected benchmark failed.
+	bool run(int argc, char** argv, bool& passed);
+	void waveSampling();
+	void waveQueryScaling();
+	void waveSolver();
+	void waveTable();
+	void heightFieldCache();
+	void instancedObjects();
+	void objParsing();
+	void meshCache();
+	void vertexCacheOptimization();
+	void vertexFormat();
+	void uniformOverhead();
+	void frameGraph();
+	void waterCulling();
+	void waterGrid();
+	void waterTessellation();
+	void waterBake();
+	void waveCount();
+	void oceanSpectrum();
+	void oceanSolverScaling();
+	void oceanCascades();
+}
@@ -87,3 +87,10 @@ void Camera::setMovementEnabled(bool enabled) {
 	movementEnabled = enabled;
 	mouseJustEntered = true;
 }
+
+
+void Camera::setOrientation(float yaw, float pitch) {
+	this->yaw = yaw;
+	this->pitch = glm::clamp(pitch, -89.0f, 89.0f);
+	updateVectors();
+}
\ No newline at end of file
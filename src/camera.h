@@ -39,6 +39,8 @@ public:
 	void mouseExit(int exitedWindow);
 	void frameUpdate(float elapsedTime);
     void setMovementEnabled(bool enabled);
+	// Angles in degrees, pitch is clamped like mouse movement
+	void setOrientation(float yaw, float pitch);
 	glm::mat4 getViewMatrix();
 	glm::mat4 getProjectionMatrix(float aspectRatio);
 private:
@@ -1,11 +1,11 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
-#include <windows.h>
-#include <libloaderapi.h>
 #include <iostream>
 #include <filesystem>
 
 #include "cubemap.h"
+#include "uniformBuffers.h"
+#include "glState.h"
 
 extern std::string executableDirectory;
 
@@ -26,9 +26,10 @@ void Cubemap::init() {
     vertexShader.compileAndAttach(program, GL_VERTEX_SHADER, "cubemap_vertex.glsl");
     fragmentShader.compileAndAttach(program, GL_FRAGMENT_SHADER, "cubemap_fragment.glsl");
     glLinkProgram(program);
+    UniformBuffers::bindBlocks(program);
 
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    GLState::bindVertexArray(vao);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_VERTICES), CUBE_VERTICES, GL_STATIC_DRAW);
 
     GLuint vertexPositionLocation = glGetAttribLocation(program, "vertexPosition");
@@ -36,7 +37,7 @@ void Cubemap::init() {
     glVertexAttribPointer(vertexPositionLocation, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 
     glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    GLState::bindTexture(GL_TEXTURE_CUBE_MAP, texture);
 
     int width, height, channels;
     for (int i = 0; i < images.size(); i++) {
@@ -60,23 +61,12 @@ void Cubemap::init() {
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 }
 
-void Cubemap::render(bool cameraUnderwater) {
-    glDepthMask(GL_FALSE);
-    glBindVertexArray(vao);
-    glUseProgram(program);
-    vertexShader.setUniformMat4("view", view);
-    vertexShader.setUniformMat4("projection", projection);
-    fragmentShader.setUniformInt("underwaterFlag", static_cast<int>(cameraUnderwater));
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+void Cubemap::render() {
+    GLState::depthMask(GL_FALSE);
+    GLState::bindVertexArray(vao);
+    GLState::useProgram(program);
+    GLState::activeTexture(GL_TEXTURE0);
+    GLState::bindTexture(GL_TEXTURE_CUBE_MAP, texture);
     glDrawArrays(GL_TRIANGLES, 0, 36);
-    glDepthMask(GL_TRUE);
-}
-
-void Cubemap::setViewMatrix(glm::mat4 view) {
-    this->view = glm::mat4(glm::mat3(view));
-}
-
-void Cubemap::setProjectionMatrix(glm::mat4 projection) {
-    this->projection = projection;
+    GLState::depthMask(GL_TRUE);
 }
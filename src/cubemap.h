@@ -56,12 +56,8 @@ private:
     GLuint program;
     Shader vertexShader;
     Shader fragmentShader;
-    glm::mat4 view;
-    glm::mat4 projection;
 
 public:
 	void init();
-    void render(bool cameraUnderwater);
-    void setViewMatrix(glm::mat4 view);
-    void setProjectionMatrix(glm::mat4 projection);
+    void render();
 };
@@ -9,17 +9,13 @@
 #include "shader.h"
 #include "ui.h"
 #include "loader.h"
-
+#include "glState.h"
 
 void Engine::setup(GLFWwindow* window) {
     this->window = window;
 
-    cubemap.init();
-    water.init(this, cubemap.texture);
-    testObject.loadOBJ("cube/cube");
-
-    glClearColor(0.0f, 0.3f, 0.3f, 0.0f);
-    glEnable(GL_DEPTH_TEST);
+    setupScene();
+    setupFrameGraph(true);
 
     int width, height;
     glfwGetFramebufferSize(window, &width, &height);
@@ -30,11 +26,101 @@ void Engine::setup(GLFWwindow* window) {
     // Set pointers to UI values
     UIInputs& uiInputs = UI::getInputs();
     uiInputs.frameTime = &frameTimeAverage;
+    uiInputs.frameGraph = &frameGraph;
+    uiInputs.profiler = &profiler;
+    uiInputs.water = &water;
 
     lastFrameTime = glfwGetTime();
 
 }
 
+void Engine::setupOffscreen(glm::ivec2 size) {
+    window = nullptr;
+
+    setupScene();
+    setupFrameGraph(false);
+
+    glGenRenderbuffers(2, offscreenRenderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreenRenderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.x, size.y);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreenRenderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size.x, size.y);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &offscreenFramebuffer);
+    GLState::bindFramebuffer(offscreenFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreenRenderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, offscreenRenderbuffers[1]);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Offscreen framebuffer is incomplete, status 0x" << std::hex << status << std::dec << "." << std::endl;
+    }
+    GLState::bindFramebuffer(0);
+
+    frameGraph.setBackbuffer(offscreenFramebuffer);
+    windowResizeCallback(size.x, size.y);
+}
+
+void Engine::setupScene() {
+    uniformBuffers.init();
+    cubemap.init();
+    water.init(this, cubemap.texture);
+    hasWaveParameterUpdate = true;
+    waveQueries.init(&water);
+    testObject.loadOBJ("cube/cube");
+
+    glEnable(GL_DEPTH_TEST);
+}
+
+/**
+    Declares the passes of a frame. Every pass currently draws straight to the backbuffer, so they run in the order
+    they are declared here; passes rendering to intermediate targets declare them with frameGraph.createTexture.
+*/
+void Engine::setupFrameGraph(bool drawUI) {
+    frameGraph.setProfiler(&profiler);
+    oceanScope = profiler.getScope("Ocean", false);
+    waveQueryScope = profiler.getScope("Wave queries", false);
+    waterGridScope = profiler.getScope("Water grid", false);
+    waveBakeScope = profiler.getScope("Wave bake", true);
+    presentScope = profiler.getScope("Present", false);
+
+    frameGraph.addPass({
+        .name = "Sky",
+        .writes = { FrameGraph::BACKBUFFER },
+        .clear = GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT,
+        .clearColor = glm::vec4(0.0f, 0.3f, 0.3f, 0.0f),
+        .clearDepth = 1.0f,
+        .execute = [this]() { cubemap.render(); }
+    });
+    frameGraph.addPass({
+        .name = "Water",
+        .writes = { FrameGraph::BACKBUFFER },
+        .execute = [this]() { water.render(); }
+    });
+    frameGraph.addPass({
+        .name = "Objects",
+        .writes = { FrameGraph::BACKBUFFER },
+        .execute = [this]() { testObject.render(elapsedTime); }
+    });
+    if (!drawUI) {
+        return;
+    }
+    frameGraph.addPass({
+        .name = "UI",
+        .writes = { FrameGraph::BACKBUFFER },
+        .execute = []() {
+            UI::renderFrame();
+            // The ImGui renderer binds its own program, buffers and textures
+            GLState::invalidate();
+        }
+    });
+}
+
+void Engine::setWaveCount(int count) {
+    water.setWaveCount(count);
+    hasWaveParameterUpdate = true;
+}
+
 void Engine::keyCallback(int key, int scancode, int action, int mods) {
     switch (key) {
     case GLFW_KEY_W:
@@ -116,16 +202,12 @@ void Engine::mouseEnteredCallback(int entered) {
 
 void Engine::windowResizeCallback(int width, int height) {
     windowSize = glm::ivec2(width, height);
-    glViewport(0, 0, width, height);
-
-    glm::mat4 projection = camera.getProjectionMatrix(windowSize.x / (float)windowSize.y);
-    water.setProjectionMatrix(projection);
-    cubemap.setProjectionMatrix(projection);
+    frameGraph.setBackbufferSize(windowSize);
 }
 
 void Engine::renderFrame() {
     float currentTime = glfwGetTime();
-    float elapsedTime = currentTime - lastFrameTime;
+    elapsedTime = currentTime - lastFrameTime;
 
     frameTimeAverage = frameTimeAverageDecay * frameTimeAverage + (1.0f - frameTimeAverageDecay) * elapsedTime;
 
@@ -137,31 +219,80 @@ void Engine::renderFrame() {
         windowResizeCallback(width, height);
     }
 
+    drawFrame(currentTime);
+    profiler.begin(presentScope);
+    glfwSwapBuffers(window);
+    profiler.end(presentScope);
+    profiler.endFrame();
+    
+    lastFrameTime = currentTime;
+}
+
+/**
+    There is no swap to wait on offscreen, so the frame is finished inside the present scope instead. This keeps the
+    CPU from queueing frames ahead of the GPU and makes every GPU timing available when its query is read back.
+*/
+void Engine::renderOffscreenFrame(float time, float timeStep) {
+    elapsedTime = timeStep;
+    frameTimeAverage = frameTimeAverageDecay * frameTimeAverage + (1.0f - frameTimeAverageDecay) * elapsedTime;
+
+    drawFrame(time);
+    profiler.begin(presentScope);
+    glFinish();
+    profiler.end(presentScope);
+    profiler.endFrame();
+}
+
+void Engine::drawFrame(float time) {
+    profiler.begin(oceanScope);
+    water.updateOcean(time);
+    profiler.end(oceanScope);
+
+    // All CPU wave queries for the frame are gathered and evaluated together before any draw calls are made
+    profiler.begin(waveQueryScope);
+    waveQueries.clear();
+    WaveQueryService::Handle cameraWaveQuery = waveQueries.submit(camera.position);
+    testObject.queueWaveQuery();
+    waveQueries.execute(time);
+    profiler.end(waveQueryScope);
+
+    profiler.begin(waterGridScope);
+    water.updateGrid(camera.position);
+    profiler.end(waterGridScope);
+
     glm::vec3 wavePosition;
     glm::vec3 waveNormal;
-    water.approximateWaveGeometry(camera.position, currentTime, wavePosition, waveNormal);
+    waveQueries.getResult(cameraWaveQuery, wavePosition, waveNormal);
     bool cameraUnderwater = wavePosition.y > camera.position.y;
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    UI::setupFrame();
-    cubemap.render(cameraUnderwater);
-    water.render(currentTime, cameraUnderwater);
-    testObject.render(
-        camera.getViewMatrix(),
-        camera.getProjectionMatrix(windowSize.x / (float)windowSize.y),
-        currentTime,
-        elapsedTime
-    );
-    UI::renderFrame();
-    glfwSwapBuffers(window);
-    
-    lastFrameTime = currentTime;
+    // Camera and time are uploaded once for every program, the wave table only when it changes
+    UniformBuffers::FrameData frame = {
+        .view = camera.getViewMatrix(),
+        .projection = camera.getProjectionMatrix(windowSize.x / (float)windowSize.y),
+        .cameraPosition = camera.position,
+        .time = time,
+        .underwaterFlag = static_cast<int>(cameraUnderwater),
+        .viewportSize = glm::vec2(windowSize)
+    };
+    uniformBuffers.updateFrame(frame);
+    if (hasWaveParameterUpdate) {
+        uniformBuffers.updateWaves(water.getWaveTable(), water.getWaveCount());
+        hasWaveParameterUpdate = false;
+    }
+
+    // Renders to the water's own textures, before the frame graph binds the targets of its passes
+    profiler.begin(waveBakeScope);
+    water.bakeWaves();
+    profiler.end(waveBakeScope);
+
+    if (window) {
+        UI::setupFrame();
+    }
+    frameGraph.execute();
+    GLState::endFrame();
 }
 
 void Engine::handleInputs(float elapsedTime) {
     glfwPollEvents();
     camera.frameUpdate(elapsedTime);
-    water.setViewMatrix(camera.getViewMatrix());
-    cubemap.setViewMatrix(camera.getViewMatrix());
 }
@@ -5,17 +5,34 @@
 #include "cubemap.h"
 #include "water.h"
 #include "object.h"
+#include "waveQueryService.h"
+#include "uniformBuffers.h"
+#include "frameGraph.h"
+#include "profiler.h"
 
 
 class Engine {
 public:
 	Camera camera;
 private:
-	GLFWwindow* window;
+	// Null when rendering offscreen
+	GLFWwindow* window = nullptr;
+	GLuint offscreenFramebuffer = 0;
+	// Color and depth
+	GLuint offscreenRenderbuffers[2] = {};
 
+	UniformBuffers uniformBuffers;
+	FrameGraph frameGraph;
+	Profiler profiler;
+	Profiler::ScopeHandle oceanScope;
+	Profiler::ScopeHandle waveQueryScope;
+	Profiler::ScopeHandle waterGridScope;
+	Profiler::ScopeHandle waveBakeScope;
+	Profiler::ScopeHandle presentScope;
 	Water water;
 	Cubemap cubemap;
-	Object testObject{&water};
+	WaveQueryService waveQueries;
+	Object testObject{&waveQueries};
 
 	bool hasWaveParameterUpdate = false;
 
@@ -25,15 +42,26 @@ private:
 	float frameTimeAverageDecay = 0.9f;
 	float frameTimeAverage = 1.0;
 	float lastFrameTime;
+	float elapsedTime = 0.0f;
 
 public:
 	void setup(GLFWwindow* window);
+	// Renders into a framebuffer object of the given size instead of a window, with no input or UI
+	void setupOffscreen(glm::ivec2 size);
 	void renderFrame();
+	// Renders the frame at a simulated time, timeStep seconds after the previous one, into the offscreen framebuffer
+	void renderOffscreenFrame(float time, float timeStep);
+	const Profiler& getProfiler() const { return profiler; }
+	// See Water::setWaveCount, also uploads the new wave table before the next frame
+	void setWaveCount(int count);
 	void keyCallback(int key, int scancode, int action, int mods);
 	void mousePositionCallback(double x, double y);
 	void mouseEnteredCallback(int entered);
 
 private:
+	void setupScene();
+	void setupFrameGraph(bool drawUI);
+	void drawFrame(float time);
 	void handleInputs(float elapsedTime);
 	void windowResizeCallback(int width, int height);
 };
@@ -0,0 +1,189 @@
+#include <cmath>
+#include <utility>
+#include <algorithm>
+
+#include "fft.h"
+#include "fftKernel.h"
+
+// std::complex multiplication checks for infinities and NaNs unless compiled with fast math
+static inline FFT::Complex multiply(FFT::Complex a, FFT::Complex b) {
+    return FFT::Complex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+void FFT::init(int size, bool inverse) {
+    this->size = size;
+    this->inverse = inverse;
+    const double PI = 3.1415926535897932384626433832795;
+    const double sign = inverse ? 1.0 : -1.0;
+
+    twiddles.resize(size > 1 ? size - 1 : 0);
+    for (int m = 1; m < size; m *= 2) {
+        for (int j = 0; j < m; j++) {
+            double angle = sign * PI * j / m;
+            twiddles[m - 1 + j] = Complex(static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle)));
+        }
+    }
+    twiddleReal.resize(twiddles.size());
+    twiddleImaginary.resize(twiddles.size());
+    for (size_t i = 0; i < twiddles.size(); i++) {
+        twiddleReal[i] = twiddles[i].real();
+        twiddleImaginary[i] = twiddles[i].imag();
+    }
+
+    swaps.clear();
+    int bits = 0;
+    while ((1 << bits) < size) {
+        bits++;
+    }
+    for (int i = 0; i < size; i++) {
+        int reversed = 0;
+        for (int bit = 0; bit < bits; bit++) {
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        }
+        if (i < reversed) {
+            swaps.push_back({ i, reversed });
+        }
+    }
+}
+
+/**
+    Decimation in time on bit reversed input. A radix-4 butterfly over elements j, j + m, j + 2m and j + 3m of a block
+    of 4m first does the span m stage on both halves with the twiddle w1, then the span 2m stage with w2 and w2 times
+    the quarter turn exp(+-i pi / 2), which is a swap of the real and imaginary parts.
+*/
+void FFT::transform(Complex* data) const {
+    for (const std::pair<int, int>& swap : swaps) {
+        std::swap(data[swap.first], data[swap.second]);
+    }
+
+    int m = 1;
+    int stages = 0;
+    while ((1 << stages) < size) {
+        stages++;
+    }
+    if (stages % 2 == 1) {
+        for (int block = 0; block < size; block += 2) {
+            Complex a = data[block];
+            Complex b = data[block + 1];
+            data[block] = a + b;
+            data[block + 1] = a - b;
+        }
+        m = 2;
+    }
+
+    for (; m < size; m *= 4) {
+        const Complex* w1Table = &twiddles[m - 1];
+        const Complex* w2Table = &twiddles[2 * m - 1];
+        for (int block = 0; block < size; block += 4 * m) {
+            Complex* x = data + block;
+            for (int j = 0; j < m; j++) {
+                const Complex w1 = w1Table[j];
+                const Complex w2 = w2Table[j];
+                const Complex w3 = inverse ? Complex(-w2.imag(), w2.real()) : Complex(w2.imag(), -w2.real());
+
+                Complex a1 = multiply(w1, x[j + m]);
+                Complex a3 = multiply(w1, x[j + 3 * m]);
+                Complex b0 = x[j] + a1;
+                Complex b1 = x[j] - a1;
+                Complex b2 = x[j + 2 * m] + a3;
+                Complex b3 = x[j + 2 * m] - a3;
+
+                Complex c2 = multiply(w2, b2);
+                Complex c3 = multiply(w3, b3);
+                x[j] = b0 + c2;
+                x[j + 2 * m] = b0 - c2;
+                x[j + m] = b1 + c3;
+                x[j + 3 * m] = b1 - c3;
+            }
+        }
+    }
+}
+
+static void transposeComplex(const FFT::Complex* source, FFT::Complex* destination, int size) {
+    const int BLOCK = 16;
+    for (int blockRow = 0; blockRow < size; blockRow += BLOCK) {
+        for (int blockColumn = 0; blockColumn < size; blockColumn += BLOCK) {
+            const int rowEnd = std::min(blockRow + BLOCK, size);
+            const int columnEnd = std::min(blockColumn + BLOCK, size);
+            for (int row = blockRow; row < rowEnd; row++) {
+                for (int column = blockColumn; column < columnEnd; column++) {
+                    destination[column * size + row] = source[row * size + column];
+                }
+            }
+        }
+    }
+}
+
+void FFT::transform2D(Complex* data, Complex* scratch) const {
+    for (int row = 0; row < size; row++) {
+        transform(data + row * size);
+    }
+    transposeComplex(data, scratch, size);
+    for (int row = 0; row < size; row++) {
+        transform(scratch + row * size);
+    }
+    transposeComplex(scratch, data, size);
+}
+
+void FFT::transformColumns(float* real, float* imaginary, int columnBegin, int columnEnd) const {
+    for (const std::pair<int, int>& swap : swaps) {
+        std::swap_ranges(real + swap.first * size + columnBegin, real + swap.first * size + columnEnd, real + swap.second * size + columnBegin);
+        std::swap_ranges(imaginary + swap.first * size + columnBegin, imaginary + swap.first * size + columnEnd, imaginary + swap.second * size + columnBegin);
+    }
+
+    int m = 1;
+    int stages = 0;
+    while ((1 << stages) < size) {
+        stages++;
+    }
+    if (stages % 2 == 1) {
+        for (int row = 0; row < size; row += 2) {
+            float* real0 = real + row * size;
+            float* imaginary0 = imaginary + row * size;
+            float* real1 = real0 + size;
+            float* imaginary1 = imaginary0 + size;
+            for (int column = columnBegin; column < columnEnd; column++) {
+                float r = real0[column];
+                float i = imaginary0[column];
+                real0[column] = r + real1[column];
+                imaginary0[column] = i + imaginary1[column];
+                real1[column] = r - real1[column];
+                imaginary1[column] = i - imaginary1[column];
+            }
+        }
+        m = 2;
+    }
+
+    // Columns that do not fill a whole register are done one at a time
+    const int vectorEnd = SIMD::hasAvx2() ? radix4StagesAvx2(real, imaginary, m, columnBegin, columnEnd) :
+        radix4StagesSse2(real, imaginary, m, columnBegin, columnEnd);
+    FFTKernel::radix4Stages<SIMD::ScalarLanes>(real, imaginary, size, m, twiddleReal.data(), twiddleImaginary.data(),
+        inverse, vectorEnd, columnEnd);
+}
+
+int FFT::radix4StagesSse2(float* real, float* imaginary, int m, int columnBegin, int columnEnd) const {
+#ifdef SIMD_SSE2
+    typedef SIMD::Sse2Lanes Lanes;
+    const int vectorEnd = columnBegin + (columnEnd - columnBegin) / Lanes::width * Lanes::width;
+    FFTKernel::radix4Stages<Lanes>(real, imaginary, size, m, twiddleReal.data(), twiddleImaginary.data(), inverse,
+        columnBegin, vectorEnd);
+    return vectorEnd;
+#else
+    return columnBegin;
+#endif
+}
+
+void FFT::transpose(const float* source, float* destination, int size, int rowBegin, int rowEnd) {
+    const int BLOCK = 16;
+    for (int blockRow = rowBegin; blockRow < rowEnd; blockRow += BLOCK) {
+        for (int blockColumn = 0; blockColumn < size; blockColumn += BLOCK) {
+            const int blockRowEnd = std::min(blockRow + BLOCK, rowEnd);
+            const int columnEnd = std::min(blockColumn + BLOCK, size);
+            for (int row = blockRow; row < blockRowEnd; row++) {
+                for (int column = blockColumn; column < columnEnd; column++) {
+                    destination[column * size + row] = source[row * size + column];
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <complex>
+
+/**
+	In place complex FFT of a power of two size, with the twiddle factors and the bit reversal permutation computed once
+	by init. Stages are done two at a time as radix-4 butterflies, so each pass over the data does the work of two
+	radix-2 stages; a size with an odd number of stages starts with one radix-2 pass. The twiddles of each stage are
+	stored contiguously, so the inner loops read them in order.
+
+	The inverse transform is not normalized, it computes sum(x[k] * exp(2 pi i k n / size)) as used to go from a spectrum
+	to a height field. 2D transforms of a size x size row major grid transform the rows, then transpose the grid in
+	blocks, transform the rows again and transpose back, so every pass walks memory in order.
+
+	Grids can also be stored as separate real and imaginary planes and transformed a band of columns at a time. Every
+	column in the band uses the same twiddle at the same step, so the butterflies work on several neighboring columns
+	per SSE2 or AVX2 instruction with no shuffles, and bands can be given to different threads. AVX2 is used when
+	SIMD::hasAvx2, otherwise SSE2. A 2D transform is then a column pass, a transpose, another column pass and a
+	transpose back, see OceanSpectrum::update.
+*/
+class FFT {
+public:
+	typedef std::complex<float> Complex;
+
+private:
+	int size = 0;
+	bool inverse = false;
+	// Stage with span m uses twiddles[m - 1 + j] = exp(-+ pi i j / m) for j < m, size - 1 entries in total
+	std::vector<Complex> twiddles;
+	// The same twiddles as separate parts, for the column transforms
+	std::vector<float> twiddleReal;
+	std::vector<float> twiddleImaginary;
+	// Index pairs swapped by the bit reversal permutation
+	std::vector<std::pair<int, int>> swaps;
+
+	// Radix-4 stages of transformColumns from span m over the whole registers of [columnBegin, columnEnd), return the
+	// first column left for the scalar pass. The AVX2 variant is defined in fftAvx2.cpp.
+	int radix4StagesSse2(float* real, float* imaginary, int m, int columnBegin, int columnEnd) const;
+	int radix4StagesAvx2(float* real, float* imaginary, int m, int columnBegin, int columnEnd) const;
+
+public:
+	void init(int size, bool inverse);
+	int getSize() const { return size; }
+	void transform(Complex* data) const;
+	// scratch must hold size * size values
+	void transform2D(Complex* data, Complex* scratch) const;
+	// Transforms the columns [columnBegin, columnEnd) of a size x size grid stored as row major real and imaginary planes
+	void transformColumns(float* real, float* imaginary, int columnBegin, int columnEnd) const;
+	// Writes the rows [rowBegin, rowEnd) of a size x size plane into the same columns of destination
+	static void transpose(const float* source, float* destination, int size, int rowBegin, int rowEnd);
+	static bool isPowerOfTwo(int size) { return size > 0 && (size & (size - 1)) == 0; }
+};
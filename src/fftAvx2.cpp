@@ -0,0 +1,18 @@
+/**
+    AVX2 variant of the FFT column butterflies. This file is compiled with AVX2 and FMA code generation enabled (see
+    CMakeLists.txt) and is only called after SIMD::hasAvx2 has checked for support at runtime.
+*/
+#include "fft.h"
+#include "fftKernel.h"
+
+int FFT::radix4StagesAvx2(float* real, float* imaginary, int m, int columnBegin, int columnEnd) const {
+#if defined(__AVX2__)
+    typedef SIMD::Avx2Lanes Lanes;
+    const int vectorEnd = columnBegin + (columnEnd - columnBegin) / Lanes::width * Lanes::width;
+    FFTKernel::radix4Stages<Lanes>(real, imaginary, size, m, twiddleReal.data(), twiddleImaginary.data(), inverse,
+        columnBegin, vectorEnd);
+    return vectorEnd;
+#else
+    return radix4StagesSse2(real, imaginary, m, columnBegin, columnEnd);
+#endif
+}
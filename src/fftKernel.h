@@ -0,0 +1,103 @@
+#pragma once
+#include "simd.h"
+
+/**
+    Lane generic column butterflies of FFT::transformColumns, written against the lanes types of simd.h. This header is
+    included by fft.cpp and by fftAvx2.cpp, which instantiates the stages with the AVX2 lanes and its own compiler flags.
+*/
+namespace FFTKernel {
+    // A twiddle broadcast to every lane
+    template <typename Lanes>
+    struct Twiddle {
+        typename Lanes::Type real;
+        typename Lanes::Type imaginary;
+    };
+
+    template <typename Lanes>
+    inline void multiply(const Twiddle<Lanes>& w, typename Lanes::Type& real, typename Lanes::Type& imaginary) {
+        typename Lanes::Type r = Lanes::sub(Lanes::mul(w.real, real), Lanes::mul(w.imaginary, imaginary));
+        imaginary = Lanes::add(Lanes::mul(w.real, imaginary), Lanes::mul(w.imaginary, real));
+        real = r;
+    }
+
+    template <typename Lanes>
+    inline Twiddle<Lanes> broadcast(float real, float imaginary) {
+        return { Lanes::set(real), Lanes::set(imaginary) };
+    }
+
+    /**
+        The radix-4 butterfly of FFT::transform over rows j, j + m, j + 2m and j + 3m, for the columns [begin, end),
+        which must be a multiple of the lane width.
+    */
+    template <typename Lanes>
+    inline void butterflyColumns(float* real, float* imaginary, int size, int row, int m,
+        const Twiddle<Lanes>& w1, const Twiddle<Lanes>& w2, const Twiddle<Lanes>& w3, int begin, int end) {
+        float* real0 = real + row * size;
+        float* imaginary0 = imaginary + row * size;
+        float* real1 = real0 + m * size;
+        float* imaginary1 = imaginary0 + m * size;
+        float* real2 = real0 + 2 * m * size;
+        float* imaginary2 = imaginary0 + 2 * m * size;
+        float* real3 = real0 + 3 * m * size;
+        float* imaginary3 = imaginary0 + 3 * m * size;
+
+        for (int column = begin; column < end; column += Lanes::width) {
+            typename Lanes::Type a1Real = Lanes::load(real1 + column);
+            typename Lanes::Type a1Imaginary = Lanes::load(imaginary1 + column);
+            typename Lanes::Type a3Real = Lanes::load(real3 + column);
+            typename Lanes::Type a3Imaginary = Lanes::load(imaginary3 + column);
+            multiply(w1, a1Real, a1Imaginary);
+            multiply(w1, a3Real, a3Imaginary);
+
+            typename Lanes::Type x0Real = Lanes::load(real0 + column);
+            typename Lanes::Type x0Imaginary = Lanes::load(imaginary0 + column);
+            typename Lanes::Type x2Real = Lanes::load(real2 + column);
+            typename Lanes::Type x2Imaginary = Lanes::load(imaginary2 + column);
+            typename Lanes::Type b0Real = Lanes::add(x0Real, a1Real);
+            typename Lanes::Type b0Imaginary = Lanes::add(x0Imaginary, a1Imaginary);
+            typename Lanes::Type b1Real = Lanes::sub(x0Real, a1Real);
+            typename Lanes::Type b1Imaginary = Lanes::sub(x0Imaginary, a1Imaginary);
+            typename Lanes::Type c2Real = Lanes::add(x2Real, a3Real);
+            typename Lanes::Type c2Imaginary = Lanes::add(x2Imaginary, a3Imaginary);
+            typename Lanes::Type c3Real = Lanes::sub(x2Real, a3Real);
+            typename Lanes::Type c3Imaginary = Lanes::sub(x2Imaginary, a3Imaginary);
+            multiply(w2, c2Real, c2Imaginary);
+            multiply(w3, c3Real, c3Imaginary);
+
+            Lanes::store(real0 + column, Lanes::add(b0Real, c2Real));
+            Lanes::store(imaginary0 + column, Lanes::add(b0Imaginary, c2Imaginary));
+            Lanes::store(real2 + column, Lanes::sub(b0Real, c2Real));
+            Lanes::store(imaginary2 + column, Lanes::sub(b0Imaginary, c2Imaginary));
+            Lanes::store(real1 + column, Lanes::add(b1Real, c3Real));
+            Lanes::store(imaginary1 + column, Lanes::add(b1Imaginary, c3Imaginary));
+            Lanes::store(real3 + column, Lanes::sub(b1Real, c3Real));
+            Lanes::store(imaginary3 + column, Lanes::sub(b1Imaginary, c3Imaginary));
+        }
+    }
+
+    /**
+        Runs the radix-4 stages of a size x size grid from span m up over the columns [begin, end), a multiple of the
+        lane width. The twiddles are the split parts of FFT::twiddles.
+    */
+    template <typename Lanes>
+    void radix4Stages(float* real, float* imaginary, int size, int m, const float* twiddleReal,
+        const float* twiddleImaginary, bool inverse, int begin, int end) {
+        if (begin == end) {
+            return;
+        }
+        for (; m < size; m *= 4) {
+            for (int block = 0; block < size; block += 4 * m) {
+                for (int j = 0; j < m; j++) {
+                    const float w1Real = twiddleReal[m - 1 + j];
+                    const float w1Imaginary = twiddleImaginary[m - 1 + j];
+                    const float w2Real = twiddleReal[2 * m - 1 + j];
+                    const float w2Imaginary = twiddleImaginary[2 * m - 1 + j];
+                    const float w3Real = inverse ? -w2Imaginary : w2Imaginary;
+                    const float w3Imaginary = inverse ? w2Real : -w2Real;
+                    butterflyColumns<Lanes>(real, imaginary, size, block + j, m, broadcast<Lanes>(w1Real, w1Imaginary),
+                        broadcast<Lanes>(w2Real, w2Imaginary), broadcast<Lanes>(w3Real, w3Imaginary), begin, end);
+                }
+            }
+        }
+    }
+}
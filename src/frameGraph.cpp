@@ -0,0 +1,428 @@
+#include <iostream>
+#include <algorithm>
+
+#include "frameGraph.h"
+#include "glState.h"
+
+static bool isDepthFormat(GLenum format) {
+    switch (format) {
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32:
+    case GL_DEPTH_COMPONENT32F:
+    case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH32F_STENCIL8:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool hasStencil(GLenum format) {
+    return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+static size_t getBytesPerTexel(GLenum format) {
+    switch (format) {
+    case GL_R8:
+        return 1;
+    case GL_R16F:
+    case GL_RG8:
+    case GL_DEPTH_COMPONENT16:
+        return 2;
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_DEPTH32F_STENCIL8:
+        return 8;
+    case GL_RGBA32F:
+        return 16;
+    default:
+        return 4;
+    }
+}
+
+static bool isTransient(FrameGraph::ResourceHandle resource) {
+    return resource != FrameGraph::BACKBUFFER;
+}
+
+FrameGraph::ResourceHandle FrameGraph::createTexture(const std::string& name, const TextureDescription& description) {
+    resources.push_back({ .name = name, .description = description, .texture = -1 });
+    compiled = false;
+    return static_cast<ResourceHandle>(resources.size() - 1);
+}
+
+FrameGraph::PassHandle FrameGraph::addPass(const PassDescription& description) {
+    Pass pass = {};
+    pass.description = description;
+    passes.push_back(pass);
+    compiled = false;
+    return static_cast<PassHandle>(passes.size() - 1);
+}
+
+void FrameGraph::setBackbufferSize(glm::ivec2 size) {
+    if (size != backbufferSize) {
+        backbufferSize = size;
+        compiled = false;
+    }
+}
+
+void FrameGraph::setBackbuffer(GLuint framebuffer) {
+    if (framebuffer != backbuffer) {
+        backbuffer = framebuffer;
+        compiled = false;
+    }
+}
+
+void FrameGraph::setAliasing(bool enabled) {
+    aliasing = enabled;
+    compiled = false;
+}
+
+void FrameGraph::setProfiler(Profiler* profiler) {
+    this->profiler = profiler;
+    compiled = false;
+}
+
+GLuint FrameGraph::getTexture(ResourceHandle resource) const {
+    if (resource <= BACKBUFFER || resource >= static_cast<ResourceHandle>(resources.size()) || resources[resource].texture < 0) {
+        return 0;
+    }
+    return textures[resources[resource].texture].id;
+}
+
+glm::ivec2 FrameGraph::getSize(const TextureDescription& description) const {
+    if (description.width > 0 && description.height > 0) {
+        return glm::ivec2(description.width, description.height);
+    }
+    return glm::max(glm::ivec2(glm::vec2(backbufferSize) * description.scale), glm::ivec2(1));
+}
+
+void FrameGraph::compile() {
+    release();
+    stats = {};
+    schedule();
+    allocateTextures();
+    createFramebuffers();
+
+    for (PassHandle pass : order) {
+        passes[pass].scope = profiler ? profiler->getScope(passes[pass].description.name, true) : -1;
+    }
+    stats.passes = static_cast<int>(order.size());
+    stats.culledPasses = static_cast<int>(passes.size() - order.size());
+    compiled = true;
+}
+
+/**
+    Culls passes that do not contribute to the backbuffer, then orders the remaining ones with Kahn's algorithm,
+    picking the earliest declared pass among those whose dependencies have all run.
+*/
+void FrameGraph::schedule() {
+    const int passCount = static_cast<int>(passes.size());
+    auto writes = [&](int pass, ResourceHandle resource) {
+        const std::vector<ResourceHandle>& passWrites = passes[pass].description.writes;
+        return std::find(passWrites.begin(), passWrites.end(), resource) != passWrites.end();
+    };
+    auto reads = [&](int pass, ResourceHandle resource) {
+        const std::vector<ResourceHandle>& passReads = passes[pass].description.reads;
+        return std::find(passReads.begin(), passReads.end(), resource) != passReads.end();
+    };
+
+    for (int pass = 0; pass < passCount; pass++) {
+        passes[pass].culled = !writes(pass, BACKBUFFER);
+        for (ResourceHandle resource : passes[pass].description.reads) {
+            if (writes(pass, resource) && isTransient(resource)) {
+                std::cerr << "Pass " << passes[pass].description.name << " reads and writes " << resources[resource].name
+                    << ", which is a feedback loop." << std::endl;
+            }
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int pass = 0; pass < passCount; pass++) {
+            if (!passes[pass].culled) {
+                continue;
+            }
+            for (int reader = 0; reader < passCount && passes[pass].culled; reader++) {
+                if (reader == pass || passes[reader].culled) {
+                    continue;
+                }
+                for (ResourceHandle resource : passes[pass].description.writes) {
+                    if (reads(reader, resource)) {
+                        passes[pass].culled = false;
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    // dependencies[pass] lists the passes that must run before it
+    std::vector<std::vector<int>> dependencies(passCount);
+    for (int pass = 0; pass < passCount; pass++) {
+        if (passes[pass].culled) {
+            continue;
+        }
+        for (int other = 0; other < passCount; other++) {
+            if (other == pass || passes[other].culled) {
+                continue;
+            }
+            bool dependsOnOther = false;
+            for (ResourceHandle resource : passes[other].description.writes) {
+                bool readOnly = reads(pass, resource) && !writes(pass, resource);
+                bool laterWriter = writes(pass, resource) && other < pass;
+                dependsOnOther = dependsOnOther || readOnly || laterWriter;
+            }
+            if (dependsOnOther) {
+                dependencies[pass].push_back(other);
+            }
+        }
+    }
+
+    order.clear();
+    std::vector<bool> scheduled(passCount, false);
+    while (true) {
+        int next = -1;
+        for (int pass = 0; pass < passCount && next < 0; pass++) {
+            if (passes[pass].culled || scheduled[pass]) {
+                continue;
+            }
+            bool ready = std::all_of(dependencies[pass].begin(), dependencies[pass].end(), [&](int dependency) { return scheduled[dependency]; });
+            if (ready) {
+                next = pass;
+            }
+        }
+        if (next < 0) {
+            break;
+        }
+        scheduled[next] = true;
+        order.push_back(next);
+    }
+
+    for (int pass = 0; pass < passCount; pass++) {
+        if (!passes[pass].culled && !scheduled[pass]) {
+            std::cerr << "Pass " << passes[pass].description.name << " is part of a dependency cycle and was not scheduled." << std::endl;
+        }
+    }
+}
+
+/**
+    Assigns a texture to every transient resource used by a scheduled pass. Walking the passes in order, a resource takes
+    a texture when it is first used and returns it after its last use, and a returned texture with the same format and
+    size is taken before a new one is created.
+*/
+void FrameGraph::allocateTextures() {
+    const int resourceCount = static_cast<int>(resources.size());
+    std::vector<int> firstUse(resourceCount, -1);
+    std::vector<int> lastUse(resourceCount, -1);
+    for (int position = 0; position < static_cast<int>(order.size()); position++) {
+        const PassDescription& description = passes[order[position]].description;
+        for (const std::vector<ResourceHandle>* list : { &description.reads, &description.writes }) {
+            for (ResourceHandle resource : *list) {
+                if (firstUse[resource] < 0) {
+                    firstUse[resource] = position;
+                }
+                lastUse[resource] = position;
+            }
+        }
+    }
+
+    for (Resource& resource : resources) {
+        resource.texture = -1;
+    }
+    std::vector<int> freeTextures;
+    for (int position = 0; position < static_cast<int>(order.size()); position++) {
+        for (ResourceHandle resource = BACKBUFFER + 1; resource < resourceCount; resource++) {
+            if (firstUse[resource] != position) {
+                continue;
+            }
+            const GLenum format = resources[resource].description.format;
+            const glm::ivec2 size = getSize(resources[resource].description);
+            auto match = std::find_if(freeTextures.begin(), freeTextures.end(),
+                [&](int texture) { return textures[texture].format == format && textures[texture].size == size; });
+            if (match != freeTextures.end()) {
+                resources[resource].texture = *match;
+                freeTextures.erase(match);
+                continue;
+            }
+
+            Texture texture = { .format = format, .size = size, .id = 0 };
+            glGenTextures(1, &texture.id);
+            GLState::bindTexture(GL_TEXTURE_2D, texture.id);
+            GLenum uploadFormat = isDepthFormat(format) ? (hasStencil(format) ? GL_DEPTH_STENCIL : GL_DEPTH_COMPONENT) : GL_RGBA;
+            GLenum uploadType = format == GL_DEPTH24_STENCIL8 ? GL_UNSIGNED_INT_24_8 : (format == GL_DEPTH32F_STENCIL8 ? GL_FLOAT_32_UNSIGNED_INT_24_8_REV : GL_FLOAT);
+            glTexImage2D(GL_TEXTURE_2D, 0, format, size.x, size.y, 0, uploadFormat, uploadType, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            textures.push_back(texture);
+            resources[resource].texture = static_cast<int>(textures.size() - 1);
+            stats.textureBytes += size.x * size.y * getBytesPerTexel(format);
+        }
+
+        if (aliasing) {
+            for (ResourceHandle resource = BACKBUFFER + 1; resource < resourceCount; resource++) {
+                if (lastUse[resource] == position) {
+                    freeTextures.push_back(resources[resource].texture);
+                }
+            }
+        }
+    }
+
+    for (ResourceHandle resource = BACKBUFFER + 1; resource < resourceCount; resource++) {
+        stats.transientResources += firstUse[resource] >= 0;
+    }
+    stats.textures = static_cast<int>(textures.size());
+    targetStates.assign(textures.size() + 1, {});
+}
+
+void FrameGraph::createFramebuffers() {
+    for (int passIndex : order) {
+        Pass& pass = passes[passIndex];
+        const std::vector<ResourceHandle>& writes = pass.description.writes;
+        if (std::find(writes.begin(), writes.end(), BACKBUFFER) != writes.end()) {
+            if (writes.size() > 1) {
+                std::cerr << "Pass " << pass.description.name << " writes the backbuffer and other targets, only the backbuffer is bound." << std::endl;
+            }
+            pass.framebuffer = backbuffer;
+            pass.size = backbufferSize;
+            continue;
+        }
+
+        glGenFramebuffers(1, &pass.framebuffer);
+        GLState::bindFramebuffer(pass.framebuffer);
+        std::vector<GLenum> drawBuffers;
+        for (ResourceHandle resource : writes) {
+            const Texture& texture = textures[resources[resource].texture];
+            GLenum attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(drawBuffers.size());
+            if (isDepthFormat(texture.format)) {
+                attachment = hasStencil(texture.format) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+            } else {
+                drawBuffers.push_back(attachment);
+            }
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture.id, 0);
+            pass.size = texture.size;
+        }
+        if (drawBuffers.empty()) {
+            glDrawBuffer(GL_NONE);
+        } else {
+            glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+        }
+
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Framebuffer of pass " << pass.description.name << " is incomplete, status 0x" << std::hex << status << std::dec << "." << std::endl;
+        }
+    }
+    GLState::bindFramebuffer(0);
+}
+
+/**
+    Clears the targets a pass writes, unless every target is still cleared to the requested values because only passes
+    without an execute callback have written it since its last clear this frame.
+*/
+void FrameGraph::clearTargets(const Pass& pass) {
+    const PassDescription& description = pass.description;
+    if (!description.clear) {
+        return;
+    }
+
+    bool redundant = true;
+    for (ResourceHandle resource : description.writes) {
+        const int target = isTransient(resource) ? resources[resource].texture + 1 : 0;
+        GLbitfield bits = description.clear;
+        if (isTransient(resource)) {
+            bits &= isDepthFormat(resources[resource].description.format) ? GL_DEPTH_BUFFER_BIT : GL_COLOR_BUFFER_BIT;
+        }
+        const TargetState& state = targetStates[target];
+        bool sameValues = (!(bits & GL_COLOR_BUFFER_BIT) || state.clearColor == description.clearColor) &&
+            (!(bits & GL_DEPTH_BUFFER_BIT) || state.clearDepth == description.clearDepth);
+        redundant = redundant && (state.clearedBits & bits) == bits && sameValues;
+    }
+    if (redundant) {
+        stats.skippedClears++;
+        return;
+    }
+
+    if (description.clear & GL_COLOR_BUFFER_BIT) {
+        glClearColor(description.clearColor.r, description.clearColor.g, description.clearColor.b, description.clearColor.a);
+    }
+    if (description.clear & GL_DEPTH_BUFFER_BIT) {
+        // Depth writes must be enabled for the depth clear to have an effect
+        GLState::depthMask(GL_TRUE);
+        glClearDepth(description.clearDepth);
+    }
+    glClear(description.clear);
+
+    for (ResourceHandle resource : description.writes) {
+        TargetState& state = targetStates[isTransient(resource) ? resources[resource].texture + 1 : 0];
+        state.clearedBits = description.clear;
+        state.clearColor = description.clearColor;
+        state.clearDepth = description.clearDepth;
+    }
+}
+
+void FrameGraph::execute() {
+    if (!compiled) {
+        compile();
+    }
+
+    stats.skippedClears = 0;
+    stats.skippedFramebufferBinds = 0;
+    for (TargetState& state : targetStates) {
+        state.clearedBits = 0;
+    }
+
+    GLuint framebuffer = ~0u;
+    glm::ivec2 viewport = glm::ivec2(-1);
+    for (int position = 0; position < static_cast<int>(order.size()); position++) {
+        Pass& pass = passes[order[position]];
+        if (pass.framebuffer == framebuffer) {
+            stats.skippedFramebufferBinds++;
+        }
+        framebuffer = pass.framebuffer;
+        GLState::bindFramebuffer(framebuffer);
+        if (pass.size != viewport) {
+            viewport = pass.size;
+            glViewport(0, 0, viewport.x, viewport.y);
+        }
+        if (profiler) {
+            profiler->begin(pass.scope);
+        }
+        clearTargets(pass);
+        if (pass.description.execute) {
+            pass.description.execute();
+        }
+        if (profiler) {
+            profiler->end(pass.scope);
+        }
+
+        // A pass without a callback only clears, so its targets stay cleared for the next pass that writes them
+        if (pass.description.execute) {
+            for (ResourceHandle resource : pass.description.writes) {
+                targetStates[isTransient(resource) ? resources[resource].texture + 1 : 0].clearedBits = 0;
+            }
+        }
+    }
+}
+
+void FrameGraph::release() {
+    for (Texture& texture : textures) {
+        glDeleteTextures(1, &texture.id);
+    }
+    textures.clear();
+    for (Pass& pass : passes) {
+        const std::vector<ResourceHandle>& writes = pass.description.writes;
+        // The backbuffer's framebuffer belongs to the caller
+        bool writesBackbuffer = std::find(writes.begin(), writes.end(), BACKBUFFER) != writes.end();
+        if (pass.framebuffer != 0 && !writesBackbuffer) {
+            glDeleteFramebuffers(1, &pass.framebuffer);
+        }
+        pass.framebuffer = 0;
+    }
+    // Names of deleted objects are reused by GL, so cached bindings to them can no longer be trusted
+    GLState::invalidate();
+    compiled = false;
+}
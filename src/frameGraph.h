@@ -0,0 +1,137 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <functional>
+#include <glm/glm.hpp>
+
+#include "glCommon.h"
+#include "profiler.h"
+
+/**
+	Schedules the render passes of a frame from the resources each pass declares it reads and writes. Passes are
+	declared once, with a callback that records their draws, and the graph is compiled into an order, a set of render
+	targets and a framebuffer per pass. It is recompiled only when the declarations or the backbuffer size change.
+
+	Ordering: the writers of a resource run in declaration order, and every pass that only reads a resource runs after
+	all of its writers. Among passes that are ready, the one declared first runs first, so a graph declared in a valid
+	order keeps it. Passes whose writes are never read by a pass that writes the backbuffer are culled.
+
+	Resources are either the backbuffer, the default framebuffer unless another one is set, or transient textures that
+	only live for the frame. Transient textures with the same description and disjoint lifetimes share one GL texture.
+	Their contents are undefined when their first writer runs, unless it clears them.
+
+	A clear is skipped if the targets are still cleared to the same values, which is the case when every pass that wrote
+	them since their last clear has no execute callback and so only cleared them. The framebuffer is not rebound between
+	passes that write the same targets. GL 4.1 needs no explicit barrier between rendering to a texture and sampling it,
+	so there are no barriers to issue; binding a pass's framebuffer is the only cost of a transition.
+
+	When a profiler is set, each pass is timed in a GPU scope of the same name.
+*/
+class FrameGraph {
+public:
+	typedef int ResourceHandle;
+	typedef int PassHandle;
+	static const ResourceHandle BACKBUFFER = 0;
+
+	typedef struct {
+		// Sized internal format, such as GL_RGBA8, GL_RGBA16F or GL_DEPTH_COMPONENT24. Integer formats are not supported.
+		GLenum format;
+		// Fixed size in pixels, or 0 to use the backbuffer size multiplied by scale
+		int width;
+		int height;
+		float scale;
+	} TextureDescription;
+
+	typedef struct {
+		std::string name = {};
+		std::vector<ResourceHandle> reads = {};
+		// Render targets. Either only the backbuffer, or transient textures of the same size with at most one depth format.
+		std::vector<ResourceHandle> writes = {};
+		// GL_COLOR_BUFFER_BIT and/or GL_DEPTH_BUFFER_BIT, applied to the written targets before execute is called
+		GLbitfield clear = 0;
+		glm::vec4 clearColor = glm::vec4(0.0f);
+		float clearDepth = 1.0f;
+		// Records the pass's draws. Empty for a pass that only clears its targets.
+		std::function<void()> execute = {};
+	} PassDescription;
+
+	typedef struct {
+		int passes;
+		int culledPasses;
+		int transientResources;
+		// GL textures backing the transient resources, fewer than transientResources when some are aliased
+		int textures;
+		size_t textureBytes;
+		int skippedClears;
+		int skippedFramebufferBinds;
+	} Stats;
+
+private:
+	typedef struct {
+		std::string name;
+		TextureDescription description;
+		// Index into textures, assigned by compile
+		int texture;
+	} Resource;
+
+	typedef struct {
+		GLenum format;
+		glm::ivec2 size;
+		GLuint id;
+	} Texture;
+
+	typedef struct {
+		PassDescription description;
+		bool culled;
+		GLuint framebuffer;
+		glm::ivec2 size;
+		Profiler::ScopeHandle scope;
+	} Pass;
+
+	// Clear state of a render target, clearedBits is reset once a pass has drawn to it
+	typedef struct {
+		GLbitfield clearedBits;
+		glm::vec4 clearColor;
+		float clearDepth;
+	} TargetState;
+
+	std::vector<Resource> resources = { { .name = "backbuffer", .description = {}, .texture = -1 } };
+	std::vector<Pass> passes;
+	std::vector<PassHandle> order;
+	std::vector<Texture> textures;
+	// Index 0 is the backbuffer, followed by one state per texture
+	std::vector<TargetState> targetStates;
+	glm::ivec2 backbufferSize = glm::ivec2(1);
+	GLuint backbuffer = 0;
+	bool aliasing = true;
+	bool compiled = false;
+	Profiler* profiler = nullptr;
+	Stats stats = {};
+
+public:
+	ResourceHandle createTexture(const std::string& name, const TextureDescription& description);
+	PassHandle addPass(const PassDescription& description);
+	void setBackbufferSize(glm::ivec2 size);
+	// Framebuffer that passes writing BACKBUFFER render to, 0 for the default framebuffer. It is owned by the caller.
+	void setBackbuffer(GLuint framebuffer);
+	// Sharing of textures between transient resources, on by default. Only for measuring the memory it saves.
+	void setAliasing(bool enabled);
+	void setProfiler(Profiler* profiler);
+	// Texture backing a transient resource, valid after compile until the graph is changed
+	GLuint getTexture(ResourceHandle resource) const;
+	void compile();
+	void execute();
+	// Deletes the GL objects of the compiled graph, which is compiled again by the next execute
+	void release();
+	// Passes in the order they run, culled passes are left out
+	const std::vector<PassHandle>& getOrder() const { return order; }
+	const std::string& getPassName(PassHandle pass) const { return passes[pass].description.name; }
+	const Stats& getStats() const { return stats; }
+
+private:
+	void schedule();
+	void allocateTextures();
+	void createFramebuffers();
+	void clearTargets(const Pass& pass);
+	glm::ivec2 getSize(const TextureDescription& description) const;
+};
@@ -0,0 +1,127 @@
+#include "glState.h"
+
+// Never a valid object name or enum, so the first call after invalidate() is always issued
+static const GLuint UNKNOWN = ~0u;
+
+static GLuint currentProgram = UNKNOWN;
+static GLuint vertexArray = UNKNOWN;
+static GLuint arrayBuffer = UNKNOWN;
+static GLuint elementArrayBuffer = UNKNOWN;
+static GLuint uniformBuffer = UNKNOWN;
+static GLuint currentFramebuffer = UNKNOWN;
+static GLenum activeUnit = UNKNOWN;
+static GLenum textureTargets[GLState::MAX_TEXTURE_UNITS];
+static GLuint textures[GLState::MAX_TEXTURE_UNITS];
+static GLuint depthMaskEnabled = UNKNOWN;
+
+static GLState::Counters counters = {};
+static GLState::Counters frameCounters = {};
+
+/**
+    Updates a cached value, returning true if it changed and the GL call should be made.
+*/
+static bool update(GLuint& cached, GLuint value) {
+    if (cached == value) {
+        counters.skipped++;
+        return false;
+    }
+    cached = value;
+    counters.issued++;
+    return true;
+}
+
+static GLuint* getCachedBuffer(GLenum target) {
+    switch (target) {
+    case GL_ARRAY_BUFFER:
+        return &arrayBuffer;
+    case GL_ELEMENT_ARRAY_BUFFER:
+        return &elementArrayBuffer;
+    case GL_UNIFORM_BUFFER:
+        return &uniformBuffer;
+    default:
+        return nullptr;
+    }
+}
+
+void GLState::useProgram(GLuint program) {
+    if (update(currentProgram, program)) {
+        glUseProgram(program);
+    }
+}
+
+void GLState::bindVertexArray(GLuint vao) {
+    if (update(vertexArray, vao)) {
+        glBindVertexArray(vao);
+        elementArrayBuffer = UNKNOWN;
+    }
+}
+
+void GLState::bindBuffer(GLenum target, GLuint buffer) {
+    GLuint* cached = getCachedBuffer(target);
+    if (!cached) {
+        counters.issued++;
+        glBindBuffer(target, buffer);
+    } else if (update(*cached, buffer)) {
+        glBindBuffer(target, buffer);
+    }
+}
+
+void GLState::bindFramebuffer(GLuint framebuffer) {
+    if (update(currentFramebuffer, framebuffer)) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+}
+
+void GLState::activeTexture(GLenum unit) {
+    if (update(activeUnit, unit)) {
+        glActiveTexture(unit);
+    }
+}
+
+void GLState::bindTexture(GLenum target, GLuint texture) {
+    const GLuint unit = activeUnit == UNKNOWN ? MAX_TEXTURE_UNITS : activeUnit - GL_TEXTURE0;
+    if (unit >= MAX_TEXTURE_UNITS) {
+        counters.issued++;
+        glBindTexture(target, texture);
+        return;
+    }
+
+    // Bindings to different targets of the same unit are separate, only the last target bound is cached
+    if (textureTargets[unit] != target) {
+        textureTargets[unit] = target;
+        textures[unit] = UNKNOWN;
+    }
+    if (update(textures[unit], texture)) {
+        glBindTexture(target, texture);
+    }
+}
+
+void GLState::depthMask(GLboolean enabled) {
+    if (update(depthMaskEnabled, enabled)) {
+        glDepthMask(enabled);
+    }
+}
+
+void GLState::invalidate() {
+    currentProgram = UNKNOWN;
+    vertexArray = UNKNOWN;
+    arrayBuffer = UNKNOWN;
+    elementArrayBuffer = UNKNOWN;
+    uniformBuffer = UNKNOWN;
+    currentFramebuffer = UNKNOWN;
+    activeUnit = UNKNOWN;
+    for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+        textureTargets[unit] = UNKNOWN;
+        textures[unit] = UNKNOWN;
+    }
+    depthMaskEnabled = UNKNOWN;
+}
+
+void GLState::endFrame() {
+    frameCounters = counters;
+    counters = {};
+}
+
+const GLState::Counters& GLState::getFrameCounters() {
+    return frameCounters;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "glCommon.h"
+
+/**
+	Cache of the GL bindings the renderer changes most often: program, vertex array, buffers, the draw framebuffer, the
+	active texture unit, texture bindings and the depth mask. Each setter compares against the last value set and only calls into GL when the
+	value changes. Every change to these bindings must go through this cache, and invalidate() must be called after
+	code that binds behind its back, such as the ImGui renderer, or when a new context is made current.
+
+	The element array buffer binding is part of the vertex array state, so it is forgotten whenever the vertex array
+	changes.
+*/
+namespace GLState {
+	static const int MAX_TEXTURE_UNITS = 16;
+
+	typedef struct {
+		// Calls passed through to GL
+		int issued;
+		// Calls skipped because the value was already set
+		int skipped;
+	} Counters;
+
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vao);
+	void bindBuffer(GLenum target, GLuint buffer);
+	// Binds to GL_FRAMEBUFFER, both the draw and read framebuffer
+	void bindFramebuffer(GLuint framebuffer);
+	void activeTexture(GLenum unit);
+	// Binds to the active texture unit
+	void bindTexture(GLenum target, GLuint texture);
+	void depthMask(GLboolean enabled);
+
+	void invalidate();
+	// Ends the counting for a frame, the counts are then available from getFrameCounters until the next call
+	void endFrame();
+	const Counters& getFrameCounters();
+}
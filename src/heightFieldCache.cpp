@@ -0,0 +1,171 @@
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+#include "heightFieldCache.h"
+
+void HeightFieldCache::setSettings(const HeightFieldSettings& settings) {
+    // A disabled cache is never built, so its grid does not need to be valid
+    if (settings.enabled && (settings.resolution < 4 || !(settings.extent > 0.0f))) {
+        std::cerr << "Height field resolution " << settings.resolution << " must be at least 4 and extent " << settings.extent << " must be positive." << std::endl;
+        return;
+    }
+    this->settings = settings;
+    valid = false;
+}
+
+/**
+    Evaluates the waves at every grid node. Nodes are forward evaluated only, so a single solver iteration is used and
+    the kernel's displaced position gives the horizontal displacement at each node.
+*/
+void HeightFieldCache::build(const WaveSampler::WaveConstants* waveTable, int waveCount, glm::vec3 center, float time) {
+    if (!settings.enabled) {
+        valid = false;
+        return;
+    }
+
+    const int resolution = settings.resolution;
+    spacing = settings.extent / (resolution - 1);
+    origin = glm::floor((glm::vec2(center.x, center.z) - settings.extent / 2.0f) / spacing) * spacing;
+    this->time = time;
+
+    WaveSampler::resize(batch, resolution * resolution);
+    for (int z = 0; z < resolution; z++) {
+        for (int x = 0; x < resolution; x++) {
+            batch.x[z * resolution + x] = origin.x + x * spacing;
+            batch.z[z * resolution + x] = origin.y + z * spacing;
+        }
+    }
+
+    WaveSampler::Waves waves;
+    WaveSampler::prepareWaves(waveTable, waveCount, time, waves);
+    const WaveSampler::SolverSettings forwardOnly = { .tolerance = 0.0f, .maxIterations = 1, .newton = false };
+    WaveSampler::sample(waves, forwardOnly, batch);
+
+    nodes.resize(resolution * resolution);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        nodes[i].displacement = glm::vec3(batch.positionX[i] - batch.x[i], batch.height[i], batch.positionZ[i] - batch.z[i]);
+        nodes[i].normal = glm::vec3(batch.normalX[i], batch.normalY[i], batch.normalZ[i]);
+    }
+
+    // One sided differences along the grid border
+    for (int z = 0; z < resolution; z++) {
+        for (int x = 0; x < resolution; x++) {
+            const Node& left = nodes[z * resolution + std::max(x - 1, 0)];
+            const Node& right = nodes[z * resolution + std::min(x + 1, resolution - 1)];
+            const Node& back = nodes[std::max(z - 1, 0) * resolution + x];
+            const Node& front = nodes[std::min(z + 1, resolution - 1) * resolution + x];
+            float distanceX = spacing * (std::min(x + 1, resolution - 1) - std::max(x - 1, 0));
+            float distanceZ = spacing * (std::min(z + 1, resolution - 1) - std::max(z - 1, 0));
+            glm::vec3 derivativeX = (right.displacement - left.displacement) / distanceX;
+            glm::vec3 derivativeZ = (front.displacement - back.displacement) / distanceZ;
+            nodes[z * resolution + x].jacobian = glm::vec4(1.0f + derivativeX.x, derivativeX.z, derivativeZ.x, 1.0f + derivativeZ.z);
+        }
+    }
+    valid = true;
+}
+
+/**
+    Answers a wave query from the grid. Returns false, leaving the outputs untouched, if the grid was built for a
+    different time or the query is too close to the grid edge for the interpolation; the caller should then fall back to
+    the analytic path.
+*/
+bool HeightFieldCache::sample(glm::vec2 desiredLocation, float time, const WaveSampler::SolverSettings& solverSettings,
+    glm::vec3& wavePosition, glm::vec3& waveNormal, WaveSampler::SolverStats* stats) const {
+    if (!valid || time != this->time) {
+        return false;
+    }
+
+    glm::vec2 location = desiredLocation;
+    Node node;
+    float residual;
+    int iteration = 0;
+    while (true) {
+        if (!interpolate(location, node)) {
+            return false;
+        }
+        iteration++;
+
+        glm::vec2 offset = location + glm::vec2(node.displacement.x, node.displacement.z) - desiredLocation;
+        residual = glm::length(offset);
+        if (iteration >= solverSettings.maxIterations || residual < solverSettings.tolerance) {
+            break;
+        }
+
+        glm::vec2 step = offset;
+        float determinant = node.jacobian.x * node.jacobian.w - node.jacobian.z * node.jacobian.y;
+        if (solverSettings.newton && determinant > WaveSampler::MIN_NEWTON_DETERMINANT) {
+            step = glm::vec2(node.jacobian.w * offset.x - node.jacobian.z * offset.y, node.jacobian.x * offset.y - node.jacobian.y * offset.x) / determinant;
+        }
+        location -= step;
+    }
+
+    wavePosition = glm::vec3(location.x + node.displacement.x, node.displacement.y, location.y + node.displacement.z);
+    waveNormal = glm::normalize(node.normal);
+
+    if (stats) {
+        stats->iterations = iteration;
+        stats->residual = residual;
+    }
+    return true;
+}
+
+size_t HeightFieldCache::getMemoryUsage() const {
+    return nodes.capacity() * sizeof(Node) + (batch.x.capacity() + batch.z.capacity() + batch.positionX.capacity() +
+        batch.positionZ.capacity() + batch.height.capacity() + batch.normalX.capacity() + batch.normalY.capacity() +
+        batch.normalZ.capacity() + batch.residual.capacity()) * sizeof(float) + batch.iterations.capacity() * sizeof(int);
+}
+
+static void catmullRomWeights(float t, float weights[4]) {
+    float t2 = t * t;
+    float t3 = t2 * t;
+    weights[0] = 0.5f * (-t3 + 2 * t2 - t);
+    weights[1] = 0.5f * (3 * t3 - 5 * t2 + 2);
+    weights[2] = 0.5f * (-3 * t3 + 4 * t2 + t);
+    weights[3] = 0.5f * (t3 - t2);
+}
+
+bool HeightFieldCache::interpolate(glm::vec2 location, Node& node) const {
+    const int resolution = settings.resolution;
+    glm::vec2 gridLocation = (location - origin) / spacing;
+    glm::ivec2 cell = glm::ivec2(glm::floor(gridLocation));
+    glm::vec2 t = gridLocation - glm::vec2(cell);
+
+    node.displacement = glm::vec3(0);
+    node.normal = glm::vec3(0);
+    node.jacobian = glm::vec4(0);
+
+    if (settings.interpolation == HEIGHT_FIELD_BICUBIC) {
+        if (cell.x < 1 || cell.y < 1 || cell.x >= resolution - 2 || cell.y >= resolution - 2) {
+            return false;
+        }
+
+        float weightsX[4];
+        float weightsZ[4];
+        catmullRomWeights(t.x, weightsX);
+        catmullRomWeights(t.y, weightsZ);
+        for (int z = 0; z < 4; z++) {
+            const Node* row = &nodes[(cell.y - 1 + z) * resolution + cell.x - 1];
+            for (int x = 0; x < 4; x++) {
+                float weight = weightsX[x] * weightsZ[z];
+                node.displacement += row[x].displacement * weight;
+                node.normal += row[x].normal * weight;
+                node.jacobian += row[x].jacobian * weight;
+            }
+        }
+        return true;
+    }
+
+    if (cell.x < 0 || cell.y < 0 || cell.x >= resolution - 1 || cell.y >= resolution - 1) {
+        return false;
+    }
+
+    const Node& n00 = nodes[cell.y * resolution + cell.x];
+    const Node& n10 = nodes[cell.y * resolution + cell.x + 1];
+    const Node& n01 = nodes[(cell.y + 1) * resolution + cell.x];
+    const Node& n11 = nodes[(cell.y + 1) * resolution + cell.x + 1];
+    node.displacement = glm::mix(glm::mix(n00.displacement, n10.displacement, t.x), glm::mix(n01.displacement, n11.displacement, t.x), t.y);
+    node.normal = glm::mix(glm::mix(n00.normal, n10.normal, t.x), glm::mix(n01.normal, n11.normal, t.x), t.y);
+    node.jacobian = glm::mix(glm::mix(n00.jacobian, n10.jacobian, t.x), glm::mix(n01.jacobian, n11.jacobian, t.x), t.y);
+    return true;
+}
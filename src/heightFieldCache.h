@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "waveSampler.h"
+
+enum HeightFieldInterpolation {
+	HEIGHT_FIELD_BILINEAR = 0,
+	HEIGHT_FIELD_BICUBIC = 1
+};
+
+typedef struct {
+	bool enabled;
+	// Number of grid nodes along each side of the square grid, at least 4 for the bicubic lookups
+	int resolution;
+	// World space size, in meters, of each side of the grid
+	float extent;
+	HeightFieldInterpolation interpolation;
+} HeightFieldSettings;
+
+/**
+    A grid of the wave displacement and normal around a center point, evaluated once for a single point in time. The
+    displacement is stored at undisplaced grid locations, so a query inverts it with the same fixed point iteration as
+    Water::approximateWaveGeometry, except that each step is an interpolated grid lookup rather than a full wave sum. The
+    Jacobian needed for Newton steps is found with central differences of the displacement when the grid is built.
+    The grid origin is snapped to the node spacing so nodes stay fixed in world space as the center moves.
+
+    Only single queries are answered from the grid. Batched queries are left to the SIMD kernel of WaveSampler, which
+    is faster than the interpolated lookups and has no interpolation error. Every query the app makes is batched
+    through WaveQueryService, so the cache is off and never built in the app; it is only used by
+    --benchmark-height-field and by callers of Water::approximateWaveGeometry that enable it themselves.
+*/
+class HeightFieldCache {
+private:
+	typedef struct {
+		glm::vec3 displacement;
+		glm::vec3 normal;
+		// Jacobian of the horizontal displaced position, columns are d/dx and d/dz, used for Newton steps
+		glm::vec4 jacobian;
+	} Node;
+
+	HeightFieldSettings settings = {
+		.enabled = false,
+		.resolution = 256,
+		.extent = 512.0f,
+		.interpolation = HEIGHT_FIELD_BILINEAR
+	};
+	std::vector<Node> nodes;
+	WaveSampler::Batch batch;
+	glm::vec2 origin = glm::vec2(0);
+	float spacing = 1.0f;
+	float time = 0.0f;
+	bool valid = false;
+
+public:
+	// Enabled settings with fewer than 4 nodes per side or a non-positive extent are rejected and leave the cache as it was
+	void setSettings(const HeightFieldSettings& settings);
+	const HeightFieldSettings& getSettings() const { return settings; }
+	void build(const WaveSampler::WaveConstants* waveTable, int waveCount, glm::vec3 center, float time);
+	bool sample(glm::vec2 desiredLocation, float time, const WaveSampler::SolverSettings& solverSettings,
+		glm::vec3& wavePosition, glm::vec3& waveNormal, WaveSampler::SolverStats* stats = nullptr) const;
+	size_t getMemoryUsage() const;
+
+private:
+	bool interpolate(glm::vec2 location, Node& node) const;
+};
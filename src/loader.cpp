@@ -1,92 +1,193 @@
+#include <algorithm>
+#include <charconv>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
+#include <optional>
+#include <string_view>
 
 #include "loader.h"
+#include "mappedFile.h"
+#include "threadPool.h"
 
 extern std::string executableDirectory;
 
+// Only the first few items of a line are used, any beyond this are counted but not kept
+static const int MAX_LINE_ITEMS = 8;
+
+// Files are split into chunks of at least this many bytes, so small models are parsed without starting any threads
+static const size_t MIN_CHUNK_SIZE = 4 * 1024 * 1024;
+
+typedef std::array<OBJ::Element, 4> FacePoints;
+
+/**
+    A run of consecutive faces in a chunk that share the same object and material. A chunk does not know the state it
+    starts in, so each run only records the "o", "mtllib" and "usemtl" values that changed just before it; values that
+    are not set carry over from the previous run, which may be in an earlier chunk.
+*/
+typedef struct {
+    std::optional<std::string> objectName;
+    std::optional<std::string> materialFile;
+    std::optional<std::string> materialName;
+    std::vector<FacePoints> faces;
+
+    // Filled in once the chunks are merged, where in the output this run's faces are written
+    OBJ::Object* object;
+    size_t firstFace;
+    std::string resolvedMaterialFile;
+    std::string resolvedMaterialName;
+} FaceRun;
+
+// A line that could not be parsed, reported once all chunks are merged so the messages come out whole and in file order
+typedef struct {
+    // Line number within the chunk, from 0
+    size_t line;
+    std::string message;
+} ParseError;
+
 typedef struct {
-    std::string currentObjectName;
-    std::string currentMaterialFile;
-    std::string currentMaterialName;
-} ParsingState;
+    std::string_view data;
+    // Lines parsed so far, while parsing the index of the current line
+    size_t lineCount;
+    std::vector<ParseError> errors;
+    std::vector<glm::vec4> vertices;
+    std::vector<glm::vec3> textureCoordinates;
+    std::vector<glm::vec3> normals;
+    std::vector<FaceRun> faceRuns;
+    size_t firstVertex;
+    size_t firstTextureCoordinate;
+    size_t firstNormal;
+} Chunk;
+
+typedef struct {
+    std::string_view items[MAX_LINE_ITEMS];
+    int count;
+} LineItems;
+
+/**
+    Parses a number at the start of the text with the same leniency as std::stof and std::stoi, which skip leading
+    whitespace and a plus sign and ignore anything after the number. Text that does not start with a number gives 0.
+*/
+template <typename T>
+static T parseNumber(std::string_view text) {
+    const char* begin = text.data();
+    const char* end = text.data() + text.size();
+    while (begin < end && (*begin == ' ' || *begin == '\t')) {
+        begin++;
+    }
+    if (begin < end && *begin == '+') {
+        begin++;
+    }
+
+    T value = 0;
+    std::from_chars(begin, end, value);
+    return value;
+}
+
+// Items are separated by single spaces, matching how the files are written by Blender
+static void splitLine(std::string_view line, LineItems& lineItems) {
+    lineItems.count = 0;
+    size_t itemStart = 0;
+    while (itemStart < line.length()) {
+        size_t itemEnd = line.find(' ', itemStart);
+        if (itemEnd == std::string_view::npos) {
+            itemEnd = line.length();
+        }
+
+        if (lineItems.count < MAX_LINE_ITEMS) {
+            lineItems.items[lineItems.count] = line.substr(itemStart, itemEnd - itemStart);
+        }
+        lineItems.count++;
+        itemStart = itemEnd + 1;
+    }
+}
 
-static ParsingState state;
+// Returns the run that the next face belongs to, starting a new one if the last one already has faces
+static FaceRun& nextFaceRun(Chunk& chunk) {
+    if (chunk.faceRuns.empty() || !chunk.faceRuns.back().faces.empty()) {
+        chunk.faceRuns.emplace_back();
+    }
+    return chunk.faceRuns.back();
+}
 
-void parseLine(std::vector<std::string>& lineItems, OBJ::File& objFile) {
-    auto& first = lineItems.at(0);
-    if (first.compare("v") == 0) {
+static void parseLine(const LineItems& lineItems, Chunk& chunk) {
+    std::string_view first = lineItems.items[0];
+    if (first == "v") {
         // Vertex
-        if (lineItems.size() >= 4) {
+        if (lineItems.count >= 4) {
             glm::vec4 vertex = glm::vec4(
-                std::stof(lineItems.at(1)),
-                std::stof(lineItems.at(2)),
-                std::stof(lineItems.at(3)),
+                parseNumber<float>(lineItems.items[1]),
+                parseNumber<float>(lineItems.items[2]),
+                parseNumber<float>(lineItems.items[3]),
                 1.0f
             );
 
-            if (lineItems.size() == 5) {
-                vertex.w = std::stof(lineItems.at(4));
+            if (lineItems.count == 5) {
+                vertex.w = parseNumber<float>(lineItems.items[4]);
             }
 
-            objFile.vertices.push_back(vertex);
+            chunk.vertices.push_back(vertex);
         }
-    } else if (first.compare("vt") == 0) {
+    } else if (first == "vt") {
         // Texture coordinate
-        if (lineItems.size() >= 3) {
+        if (lineItems.count >= 3) {
             glm::vec3 textureCoordinate = glm::vec3(
-                std::stof(lineItems.at(1)),
-                std::stof(lineItems.at(2)),
+                parseNumber<float>(lineItems.items[1]),
+                parseNumber<float>(lineItems.items[2]),
                 0.0f
             );
 
-            if (lineItems.size() == 4) {
-                textureCoordinate.z = std::stof(lineItems.at(3));
+            if (lineItems.count == 4) {
+                textureCoordinate.z = parseNumber<float>(lineItems.items[3]);
             }
 
-            objFile.textureCoordinates.push_back(textureCoordinate);
+            chunk.textureCoordinates.push_back(textureCoordinate);
         }
-    } else if (first.compare("vn") == 0) {
+    } else if (first == "vn") {
         // Vertex normal
-        if (lineItems.size() == 4) {
+        if (lineItems.count == 4) {
             glm::vec3 normal = glm::vec3(
-                std::stof(lineItems.at(1)),
-                std::stof(lineItems.at(2)),
-                std::stof(lineItems.at(3))
+                parseNumber<float>(lineItems.items[1]),
+                parseNumber<float>(lineItems.items[2]),
+                parseNumber<float>(lineItems.items[3])
             );
 
-            objFile.normals.push_back(normal);
+            chunk.normals.push_back(normal);
+        }
+    } else if (first == "f") {
+        // Face. Faces are stored with at most four points, larger polygons are reported and left out.
+        FacePoints points;
+        if (lineItems.count - 1 > static_cast<int>(points.size())) {
+            chunk.errors.push_back({ .line = chunk.lineCount, .message = "Ignored a face with " + std::to_string(lineItems.count - 1) +
+                " points, at most " + std::to_string(points.size()) + " are supported," });
+            return;
         }
-    } else if (first.compare("f") == 0) {
-        // Face
-        OBJ::Face face;
-        face.materialFile = state.currentMaterialFile;
-        face.material = state.currentMaterialName;
-        for (int i = 0; i < face.points.size(); i++) {
-            face.points[i].vertexIndex = -1;
-            face.points[i].textureIndex = -1;
-            face.points[i].normalIndex = -1;
+        for (size_t i = 0; i < points.size(); i++) {
+            points[i].vertexIndex = -1;
+            points[i].textureIndex = -1;
+            points[i].normalIndex = -1;
         }
-        
-        for (int i = 1; i < lineItems.size(); i++) {
-            std::string& item = lineItems.at(i);
-            int valueStart = 0;
+
+        const int pointCount = lineItems.count - 1;
+        for (int i = 0; i < pointCount; i++) {
+            std::string_view item = lineItems.items[i + 1];
+            size_t valueStart = 0;
             int valueIndex = 0;
             while (valueStart < item.length()) {
-                int valueEnd = item.find("/", valueStart);
-                if (valueEnd == -1) {
+                size_t valueEnd = item.find('/', valueStart);
+                if (valueEnd == std::string_view::npos) {
                     valueEnd = item.length();
                 }
 
-                int index = std::stoi(item.substr(valueStart, valueEnd - valueStart));
-
-                if (valueIndex == 0) {
-                    face.points[i - 1].vertexIndex = index;
-                } else if (valueIndex == 1) {
-                    face.points[i - 1].textureIndex = index;
-                } else if (valueIndex == 2) {
-                    face.points[i - 1].normalIndex = index;
+                // An empty value, as in "1//3", leaves the index at -1
+                if (valueEnd > valueStart) {
+                    int index = parseNumber<int>(item.substr(valueStart, valueEnd - valueStart));
+                    if (valueIndex == 0) {
+                        points[i].vertexIndex = index;
+                    } else if (valueIndex == 1) {
+                        points[i].textureIndex = index;
+                    } else if (valueIndex == 2) {
+                        points[i].normalIndex = index;
+                    }
                 }
 
                 valueStart = valueEnd + 1;
@@ -94,26 +195,139 @@ void parseLine(std::vector<std::string>& lineItems, OBJ::File& objFile) {
             }
         }
 
-        if (objFile.objects.find(state.currentObjectName) == objFile.objects.end()) {
-            objFile.objects.emplace(state.currentObjectName, OBJ::Object{});
+        if (chunk.faceRuns.empty()) {
+            chunk.faceRuns.emplace_back();
         }
-
-        objFile.objects.at(state.currentObjectName).faces.push_back(face);
-    } else if (first.compare("s") == 0) {
+        chunk.faceRuns.back().faces.push_back(points);
+    } else if (first == "s") {
         // Smooth shading
-        bool smoothShadingEnabled = lineItems.at(1).compare("off") != 0;
         // TODO handle smooth shading
-    } else if (first.compare("o") == 0) {
+    } else if (first == "o" && lineItems.count >= 2) {
         // Object name
-        state.currentObjectName = lineItems.at(1);
-    } else if (first.compare("mtllib") == 0) {
+        nextFaceRun(chunk).objectName = lineItems.items[1];
+    } else if (first == "mtllib" && lineItems.count >= 2) {
         // External material file
-        state.currentMaterialFile = lineItems.at(1);
-    } else if (first.compare("usemtl") == 0) {
+        nextFaceRun(chunk).materialFile = lineItems.items[1];
+    } else if (first == "usemtl" && lineItems.count >= 2) {
         // Use material
-        state.currentMaterialName = lineItems.at(1);
+        nextFaceRun(chunk).materialName = lineItems.items[1];
     } else {
-        std::cerr << "Unsupported OBJ file operation \"" << first << "\"." << std::endl;
+        chunk.errors.push_back({ .line = chunk.lineCount, .message = "Unsupported OBJ file operation \"" + std::string(first) + "\"" });
+    }
+}
+
+/**
+    Parses the lines of one chunk in place. Each line is split into views of the original text and numbers are read
+    with std::from_chars, so nothing is allocated per line apart from the output itself.
+
+    Blank and whitespace only lines are skipped. A last line without a line break is reported and ignored, as the
+    previous parser only read lines up to a line break.
+*/
+static void parseChunk(Chunk& chunk) {
+    LineItems lineItems;
+    size_t lineStart = 0;
+    while (lineStart < chunk.data.size()) {
+        size_t lineEnd = chunk.data.find('\n', lineStart);
+        const bool lineBreak = lineEnd != std::string_view::npos;
+        if (!lineBreak) {
+            lineEnd = chunk.data.size();
+        }
+
+        std::string_view line = chunk.data.substr(lineStart, lineEnd - lineStart);
+        const bool blank = line.find_first_not_of(" \t\r") == std::string_view::npos;
+        if (!blank && !line.starts_with("#")) {
+            if (lineBreak) {
+                splitLine(line, lineItems);
+                parseLine(lineItems, chunk);
+            } else {
+                chunk.errors.push_back({ .line = chunk.lineCount, .message = "Ignored the last line, which has no line break," });
+            }
+        }
+        chunk.lineCount++;
+        lineStart = lineEnd + 1;
+    }
+}
+
+/**
+    Parses OBJ text split into chunks at line boundaries. Chunks are parsed in parallel into their own vertex and face
+    arrays, then a short serial pass walks the face runs in file order to resolve the object and material of each run
+    and reserve its place in the output, and a second parallel pass copies every chunk into place. Both parallel passes
+    run one task per chunk on the shared thread pool, so there are at most threadCount chunks working at once. Lines
+    that could not be parsed are reported from the calling thread at the end, in file order.
+*/
+static void parseOBJData(std::string_view data, OBJ::File& objFile, int threadCount) {
+    ThreadPool& threadPool = ThreadPool::getShared();
+    if (threadCount <= 0) {
+        threadCount = threadPool.getThreadCount();
+    }
+
+    std::vector<Chunk> chunks;
+    const size_t chunkSize = std::max(MIN_CHUNK_SIZE, data.size() / threadCount + 1);
+    size_t chunkStart = 0;
+    while (chunkStart < data.size()) {
+        size_t chunkEnd = chunkStart + chunkSize < data.size() ? data.find('\n', chunkStart + chunkSize) : std::string_view::npos;
+        chunkEnd = chunkEnd == std::string_view::npos ? data.size() : chunkEnd + 1;
+        chunks.emplace_back();
+        chunks.back().data = data.substr(chunkStart, chunkEnd - chunkStart);
+        chunkStart = chunkEnd;
+    }
+
+    threadPool.run(static_cast<int>(chunks.size()), [&](int index) { parseChunk(chunks[index]); });
+
+    std::string objectName = "default";
+    std::string materialFile;
+    std::string materialName;
+    size_t vertexCount = 0;
+    size_t textureCoordinateCount = 0;
+    size_t normalCount = 0;
+    for (auto& chunk : chunks) {
+        chunk.firstVertex = vertexCount;
+        chunk.firstTextureCoordinate = textureCoordinateCount;
+        chunk.firstNormal = normalCount;
+        vertexCount += chunk.vertices.size();
+        textureCoordinateCount += chunk.textureCoordinates.size();
+        normalCount += chunk.normals.size();
+
+        for (auto& faceRun : chunk.faceRuns) {
+            objectName = faceRun.objectName.value_or(objectName);
+            materialFile = faceRun.materialFile.value_or(materialFile);
+            materialName = faceRun.materialName.value_or(materialName);
+            if (faceRun.faces.empty()) {
+                continue;
+            }
+
+            faceRun.object = &objFile.objects[objectName];
+            faceRun.firstFace = faceRun.object->faces.size();
+            faceRun.object->faces.resize(faceRun.firstFace + faceRun.faces.size());
+            faceRun.resolvedMaterialFile = materialFile;
+            faceRun.resolvedMaterialName = materialName;
+        }
+    }
+    objFile.vertices.resize(vertexCount);
+    objFile.textureCoordinates.resize(textureCoordinateCount);
+    objFile.normals.resize(normalCount);
+
+    threadPool.run(static_cast<int>(chunks.size()), [&](int index) {
+        Chunk& chunk = chunks[index];
+        std::copy(chunk.vertices.begin(), chunk.vertices.end(), objFile.vertices.begin() + chunk.firstVertex);
+        std::copy(chunk.textureCoordinates.begin(), chunk.textureCoordinates.end(), objFile.textureCoordinates.begin() + chunk.firstTextureCoordinate);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), objFile.normals.begin() + chunk.firstNormal);
+        for (auto& faceRun : chunk.faceRuns) {
+            for (size_t i = 0; i < faceRun.faces.size(); i++) {
+                OBJ::Face& face = faceRun.object->faces[faceRun.firstFace + i];
+                face.points = faceRun.faces[i];
+                face.materialFile = faceRun.resolvedMaterialFile;
+                face.material = faceRun.resolvedMaterialName;
+            }
+        }
+    });
+
+    size_t firstLine = 1;
+    for (const Chunk& chunk : chunks) {
+        for (const ParseError& error : chunk.errors) {
+            std::cerr << error.message << " on line " << firstLine + error.line << " of " << objFile.filename << "." << std::endl;
+        }
+        firstLine += chunk.lineCount;
     }
 }
 
@@ -123,47 +337,18 @@ void OBJ::parseOBJ(std::string objFilename, OBJ::File& objFile) {
     path.append("res");
     path.append("model");
     path.append(objFilename);
+    parseOBJFile(path, objFile);
+}
 
-    std::ifstream inputStream;
-    inputStream.open(path);
-
-    if (!inputStream.is_open()) {
+void OBJ::parseOBJFile(const std::filesystem::path& path, OBJ::File& objFile, int threadCount) {
+    MappedFile file;
+    if (!file.open(path)) {
         std::cerr << "Failed to open obj file from " << path << "." << std::endl;
         return;
     }
 
     objFile.filename = path.string();
-
-    inputStream.seekg(0, inputStream.end);
-    std::streampos size = inputStream.tellg();
-    inputStream.seekg(0, inputStream.beg);
-    std::vector<char> buffer(size);
-    inputStream.read(buffer.data(), size);
-
-    state.currentObjectName = "default";
-
-    int lineStart = 0;
-    std::vector<std::string> lineItems;
-    for (int i = 0; i < size; i++) {
-        if (buffer[i] == 0xA) {
-            std::string line = std::string(buffer.begin() + lineStart, buffer.begin() + i);
-            if (!line.starts_with("#")) {
-                lineItems.clear();
-                int itemStart = 0;
-                while (itemStart < line.length()) {
-                    int endIndex = line.find_first_of(" ", itemStart);
-                    if (endIndex == -1) {
-                        endIndex = line.length();
-                    }
-
-                    lineItems.push_back(line.substr(itemStart, endIndex - itemStart));
-                    itemStart = endIndex + 1;
-                }
-                parseLine(lineItems, objFile);
-            }
-            lineStart = i + 1;
-        }
-    }
+    parseOBJData(file.getContents(), objFile, threadCount);
 }
 
 void OBJ::printOBJ(OBJ::File& objFile) {
@@ -3,6 +3,7 @@
 #include <vector>
 #include <map>
 #include <array>
+#include <filesystem>
 #include <glm/glm.hpp>
 
 namespace OBJ {
@@ -30,6 +31,13 @@ namespace OBJ {
 		std::vector<glm::vec3> normals;
 	} File;
 
+	/**
+		Parses a model from res/model, relative to the executable directory. Large files are split into up to threadCount
+		chunks, or one per thread of the shared ThreadPool if it is 0, which are parsed on that pool. Parsing keeps no
+		global state, so several models may be loaded at the same time from different threads; while one load has the
+		pool, the others parse their chunks on their own thread.
+	*/
 	void parseOBJ(std::string objFilename, File& objFile);
+	void parseOBJFile(const std::filesystem::path& path, File& objFile, int threadCount = 0);
 	void printOBJ(File& objFile);
 }
@@ -1,12 +1,16 @@
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#ifdef _WIN32
 #include <windows.h>
 #include <libloaderapi.h>
+#endif
 
 #include "glCommon.h"
 #include "engine.h"
 #include "shader.h"
+#include "benchmark.h"
+#include "sceneBenchmark.h"
 #include <imgui.h>
 
 static Engine engine;
@@ -30,7 +34,32 @@ static void mouseEnteredCallback(GLFWwindow* window, int entered) {
     engine.mouseEnteredCallback(entered);
 }
 
-int main(void) {
+int main(int argc, char** argv) {
+#ifdef _WIN32
+    WCHAR wideExecutableDirectory[MAX_PATH];
+    GetModuleFileNameW(NULL, wideExecutableDirectory, MAX_PATH);
+    unsigned int endIndex = MAX_PATH - 1;
+    while (wideExecutableDirectory[endIndex] != '\\') {
+        wideExecutableDirectory[endIndex--] = 0;
+    }
+
+    std::wstring wideString{ wideExecutableDirectory, endIndex };
+    executableDirectory = std::string(wideString.begin(), wideString.end());
+#else
+    executableDirectory = (std::filesystem::canonical("/proc/self/exe").parent_path() / "").string();
+#endif
+    std::cout << "Executable directory: " << executableDirectory << std::endl;
+
+    SceneBenchmark::Settings benchmarkSettings;
+    if (SceneBenchmark::parseArguments(argc, argv, benchmarkSettings)) {
+        return SceneBenchmark::run(benchmarkSettings) ? 0 : 1;
+    }
+
+    bool benchmarkChecksPassed;
+    if (Benchmark::run(argc, argv, benchmarkChecksPassed)) {
+        return benchmarkChecksPassed ? 0 : 1;
+    }
+
     if (!glfwInit()) {
         std::cout << "Failed to initialize GLFW" << std::endl;
         return -1;
@@ -56,17 +85,6 @@ int main(void) {
     const GLubyte* version = glGetString(GL_VERSION);
     std::cout << "OpenGL version: " << version << std::endl;
 
-    WCHAR wideExecutableDirectory[MAX_PATH];
-    GetModuleFileNameW(NULL, wideExecutableDirectory, MAX_PATH);
-    unsigned int endIndex = MAX_PATH - 1;
-    while (wideExecutableDirectory[endIndex] != '\\') {
-        wideExecutableDirectory[endIndex--] = 0;
-    }
-
-    std::wstring wideString{ wideExecutableDirectory, endIndex };
-    executableDirectory = std::string(wideString.begin(), wideString.end());
-    std::cout << "Executable directory: " << executableDirectory << std::endl;
-
     engine.setup(window);
 
     while (!glfwWindowShouldClose(window)) {
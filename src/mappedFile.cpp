@@ -0,0 +1,99 @@
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mappedFile.h"
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+/**
+    Maps the file at the given path, replacing any previous mapping. Empty files succeed with empty contents, since a
+    zero length mapping is not allowed.
+*/
+bool MappedFile::open(const std::filesystem::path& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to open " << path << " for mapping." << std::endl;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    fileHandle = file;
+    size = static_cast<size_t>(fileSize.QuadPart);
+    if (size == 0) {
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        std::cerr << "Failed to map " << path << "." << std::endl;
+        close();
+        return false;
+    }
+    mappingHandle = mapping;
+    data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file == -1) {
+        std::cerr << "Failed to open " << path << " for mapping." << std::endl;
+        return false;
+    }
+
+    struct stat fileStatus;
+    fstat(file, &fileStatus);
+    size = static_cast<size_t>(fileStatus.st_size);
+    if (size == 0) {
+        ::close(file);
+        return true;
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (mapping != MAP_FAILED) {
+        madvise(mapping, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapping);
+    }
+#endif
+
+    if (!data) {
+        std::cerr << "Failed to map " << path << "." << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle) {
+        CloseHandle(fileHandle);
+    }
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+#else
+    if (data) {
+        munmap(const_cast<char*>(data), size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+}
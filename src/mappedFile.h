@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+/**
+	A read only memory mapping of a whole file. The contents stay valid until the mapping is closed or destroyed, and
+	are paged in by the OS as they are read rather than copied into a buffer up front.
+*/
+class MappedFile {
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	bool open(const std::filesystem::path& path);
+	void close();
+	std::string_view getContents() const { return std::string_view(data, size); }
+	size_t getSize() const { return size; }
+};
@@ -0,0 +1,321 @@
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+
+#include "meshCache.h"
+#include "loader.h"
+#include "vertexCache.h"
+
+extern std::string executableDirectory;
+
+static const char CACHE_MAGIC[8] = "OGLMESH";
+static const uint32_t CACHE_VERSION = 2;
+static const uint32_t CACHE_FLAG_VERTEX_CACHE_OPTIMIZED = 1;
+// Vertex and index data start on this alignment within the cache file
+static const size_t CACHE_DATA_ALIGNMENT = 16;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t vertexStride;
+    int64_t sourceModifiedTime;
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint32_t sourcePathLength;
+    uint32_t flags;
+} CacheHeader;
+
+static size_t alignCacheOffset(size_t offset) {
+    return (offset + CACHE_DATA_ALIGNMENT - 1) / CACHE_DATA_ALIGNMENT * CACHE_DATA_ALIGNMENT;
+}
+
+// 64 bit FNV-1a
+static uint64_t hashBytes(std::string_view bytes) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char byte : bytes) {
+        hash = (hash ^ static_cast<unsigned char>(byte)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static bool hashFile(const std::filesystem::path& path, uint64_t& hash) {
+    MappedFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+    hash = hashBytes(file.getContents());
+    return true;
+}
+
+static std::filesystem::path cachePathFor(const std::filesystem::path& sourcePath, const std::filesystem::path& cacheDirectory) {
+    return cacheDirectory / std::format("{0}-{1:016x}.mesh", sourcePath.stem().string(), hashBytes(sourcePath.string()));
+}
+
+/**
+    Maps a cache file and points the mesh at its data. Fails if the file is missing, truncated, from another version of
+    the format, or was built from a different source path.
+*/
+static bool mapCacheFile(const std::filesystem::path& cachePath, const std::string& sourcePath, MeshCache::Mesh& mesh, CacheHeader& header) {
+    if (!std::filesystem::exists(cachePath) || !mesh.file.open(cachePath)) {
+        return false;
+    }
+
+    std::string_view contents = mesh.file.getContents();
+    if (contents.size() < sizeof(CacheHeader)) {
+        return false;
+    }
+    memcpy(&header, contents.data(), sizeof(CacheHeader));
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+        header.vertexStride != MeshCache::VERTEX_STRIDE) {
+        return false;
+    }
+
+    const size_t vertexOffset = alignCacheOffset(sizeof(CacheHeader) + header.sourcePathLength);
+    const size_t indexOffset = alignCacheOffset(vertexOffset + header.vertexCount * MeshCache::VERTEX_STRIDE * sizeof(float));
+    if (contents.size() < indexOffset + header.indexCount * sizeof(uint32_t) ||
+        contents.substr(sizeof(CacheHeader), header.sourcePathLength) != sourcePath) {
+        return false;
+    }
+
+    mesh.vertices = std::span<const float>(reinterpret_cast<const float*>(contents.data() + vertexOffset), header.vertexCount * MeshCache::VERTEX_STRIDE);
+    mesh.indices = std::span<const uint32_t>(reinterpret_cast<const uint32_t*>(contents.data() + indexOffset), header.indexCount);
+    mesh.vertexCount = static_cast<int>(header.vertexCount);
+    return true;
+}
+
+/**
+    Writes the cache file through a temporary file that is renamed into place, so a concurrent or interrupted load never
+    sees a partly written cache.
+*/
+static bool writeCacheFile(const std::filesystem::path& cachePath, CacheHeader header, const std::string& sourcePath,
+    std::span<const float> vertices, std::span<const uint32_t> indices) {
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.vertexStride = MeshCache::VERTEX_STRIDE;
+    header.vertexCount = vertices.size() / MeshCache::VERTEX_STRIDE;
+    header.indexCount = indices.size();
+    header.sourcePathLength = static_cast<uint32_t>(sourcePath.size());
+
+    std::error_code error;
+    std::filesystem::create_directories(cachePath.parent_path(), error);
+    std::filesystem::path temporaryPath = cachePath;
+    temporaryPath += ".tmp";
+    {
+        std::ofstream outputStream(temporaryPath, std::ios::binary);
+        if (!outputStream.is_open()) {
+            std::cerr << "Failed to write mesh cache " << cachePath << "." << std::endl;
+            return false;
+        }
+
+        const char zeros[CACHE_DATA_ALIGNMENT] = {};
+        const size_t vertexOffset = alignCacheOffset(sizeof(CacheHeader) + sourcePath.size());
+        const size_t indexOffset = alignCacheOffset(vertexOffset + vertices.size_bytes());
+        outputStream.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+        outputStream.write(sourcePath.data(), sourcePath.size());
+        outputStream.write(zeros, vertexOffset - sizeof(CacheHeader) - sourcePath.size());
+        outputStream.write(reinterpret_cast<const char*>(vertices.data()), vertices.size_bytes());
+        outputStream.write(zeros, indexOffset - vertexOffset - vertices.size_bytes());
+        outputStream.write(reinterpret_cast<const char*>(indices.data()), indices.size_bytes());
+        if (!outputStream) {
+            std::cerr << "Failed to write mesh cache " << cachePath << "." << std::endl;
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, cachePath, error);
+    if (error) {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
+
+bool MeshCache::load(const char* name, Mesh& mesh) {
+    std::filesystem::path sourcePath;
+    sourcePath.append(executableDirectory);
+    sourcePath.append("res");
+    sourcePath.append("model");
+    sourcePath.append(std::format("{0}.obj", name));
+
+    std::filesystem::path cacheDirectory;
+    cacheDirectory.append(executableDirectory);
+    cacheDirectory.append("cache");
+    return loadFile(sourcePath, cacheDirectory, mesh);
+}
+
+bool MeshCache::loadFile(const std::filesystem::path& sourcePath, const std::filesystem::path& cacheDirectory, Mesh& mesh, bool optimizeVertexCache) {
+    std::error_code error;
+    const auto modifiedTime = std::filesystem::last_write_time(sourcePath, error);
+    const uintmax_t sourceSize = std::filesystem::file_size(sourcePath, error);
+    if (error) {
+        std::cerr << "Failed to open obj file from " << sourcePath << "." << std::endl;
+        return false;
+    }
+
+    const std::string sourcePathString = sourcePath.string();
+    const std::filesystem::path cachePath = cachePathFor(sourcePath, cacheDirectory);
+    const uint32_t flags = optimizeVertexCache ? CACHE_FLAG_VERTEX_CACHE_OPTIMIZED : 0;
+    CacheHeader cachedHeader;
+    const bool mapped = mapCacheFile(cachePath, sourcePathString, mesh, cachedHeader) && cachedHeader.flags == flags;
+    if (mapped && cachedHeader.sourceSize == sourceSize && cachedHeader.sourceModifiedTime == modifiedTime.time_since_epoch().count()) {
+        return true;
+    }
+
+    // Only hash the source when the cheap checks disagree, for example after a checkout that touched the file
+    CacheHeader header;
+    header.flags = flags;
+    header.sourceModifiedTime = modifiedTime.time_since_epoch().count();
+    header.sourceSize = sourceSize;
+    if (!hashFile(sourcePath, header.sourceHash)) {
+        return false;
+    }
+
+    if (mapped && cachedHeader.sourceHash == header.sourceHash) {
+        // Contents are unchanged, the cache is rewritten with the new time so the next load does not hash again
+        mesh.vertexStorage.assign(mesh.vertices.begin(), mesh.vertices.end());
+        mesh.indexStorage.assign(mesh.indices.begin(), mesh.indices.end());
+    } else if (!buildMesh(sourcePath, mesh.vertexStorage, mesh.indexStorage, mesh.vertexCount, optimizeVertexCache)) {
+        return false;
+    }
+    mesh.file.close();
+
+    // Serve the rewritten cache from its mapping, so cold and warm loads hand the same memory to the GPU
+    if (writeCacheFile(cachePath, header, sourcePathString, mesh.vertexStorage, mesh.indexStorage) &&
+        mapCacheFile(cachePath, sourcePathString, mesh, header)) {
+        mesh.vertexStorage = {};
+        mesh.indexStorage = {};
+        return true;
+    }
+
+    mesh.vertices = mesh.vertexStorage;
+    mesh.indices = mesh.indexStorage;
+    mesh.vertexCount = static_cast<int>(mesh.vertexStorage.size() / VERTEX_STRIDE);
+    return true;
+}
+
+/**
+    Open addressing hash map from OBJ position, texture coordinate and normal index triples to welded vertex indices.
+    Sized up front for the number of face corners, so it never grows.
+*/
+class WeldMap {
+private:
+    static const uint32_t EMPTY = UINT32_MAX;
+    std::vector<uint32_t> slots;
+    std::vector<OBJ::Element> keys;
+    size_t mask;
+
+    static size_t hash(const OBJ::Element& key) {
+        uint64_t value = static_cast<uint32_t>(key.vertexIndex) * 0x9E3779B97F4A7C15ull;
+        value ^= static_cast<uint32_t>(key.textureIndex) * 0xC2B2AE3D27D4EB4Full;
+        value ^= static_cast<uint32_t>(key.normalIndex) * 0x165667B19E3779F9ull;
+        return static_cast<size_t>(value ^ (value >> 29));
+    }
+
+public:
+    WeldMap(size_t maxKeys) {
+        size_t capacity = 16;
+        while (capacity < maxKeys * 2) {
+            capacity *= 2;
+        }
+        slots.assign(capacity, EMPTY);
+        keys.reserve(maxKeys);
+        mask = capacity - 1;
+    }
+
+    // Returns the welded index of the key, and whether it was added by this call
+    uint32_t insert(const OBJ::Element& key, bool& added) {
+        for (size_t slot = hash(key) & mask;; slot = (slot + 1) & mask) {
+            if (slots[slot] == EMPTY) {
+                slots[slot] = static_cast<uint32_t>(keys.size());
+                keys.push_back(key);
+                added = true;
+                return slots[slot];
+            }
+            const OBJ::Element& existing = keys[slots[slot]];
+            if (existing.vertexIndex == key.vertexIndex && existing.textureIndex == key.textureIndex && existing.normalIndex == key.normalIndex) {
+                added = false;
+                return slots[slot];
+            }
+        }
+    }
+};
+
+/**
+    Parses an OBJ model into an indexed triangle list, VERTEX_STRIDE floats per vertex. Face corners that share the same
+    position, texture coordinate and normal indices are welded into one vertex. Quads are split into two triangles;
+    points without a texture coordinate or normal get zeros. The triangles are optionally reordered for the vertex cache.
+*/
+bool MeshCache::buildMesh(const std::filesystem::path& sourcePath, std::vector<float>& vertexData, std::vector<uint32_t>& indices,
+    int& vertexCount, bool optimizeVertexCache) {
+    OBJ::File objFile;
+    OBJ::parseOBJFile(sourcePath, objFile);
+
+    size_t faceCount = 0;
+    for (auto& pair : objFile.objects) {
+        faceCount += pair.second.faces.size();
+    }
+
+    WeldMap weldMap(faceCount * 4);
+    vertexData.clear();
+    indices.clear();
+    indices.reserve(faceCount * 6);
+    for (auto& pair : objFile.objects) {
+        for (auto& face : pair.second.faces) {
+            int points = 0;
+            while (points < face.points.size() && face.points[points].vertexIndex != -1) {
+                points++;
+            }
+
+            int triangles;
+            const int corners[2][3] = { {0, 1, 2}, {0, 2, 3} };
+
+            // TODO: divide arbitrary polygon into triangles, probably only support convex shapes
+            switch (points) {
+            case 3:
+                triangles = 1;
+                break;
+            case 4:
+                triangles = 2;
+                break;
+            default:
+                std::cerr << "Unsupported number of vertices (" << points << ") in face." << std::endl;
+                return false;
+            }
+
+            for (int triangle = 0; triangle < triangles; triangle++) {
+                for (int corner = 0; corner < 3; corner++) {
+                    const OBJ::Element& point = face.points[corners[triangle][corner]];
+                    bool added;
+                    indices.push_back(weldMap.insert(point, added));
+                    if (!added) {
+                        continue;
+                    }
+
+                    glm::vec4 vertex = objFile.vertices[point.vertexIndex - 1];
+                    glm::vec3 textureCoordinate = point.textureIndex > 0 ? objFile.textureCoordinates[point.textureIndex - 1] : glm::vec3(0);
+                    glm::vec3 normal = point.normalIndex > 0 ? objFile.normals[point.normalIndex - 1] : glm::vec3(0);
+                    // Vertex position
+                    vertexData.push_back(vertex.x);
+                    vertexData.push_back(vertex.y);
+                    vertexData.push_back(vertex.z);
+                    // Texture coordinate
+                    vertexData.push_back(textureCoordinate.x);
+                    vertexData.push_back(textureCoordinate.y);
+                    // Normal
+                    vertexData.push_back(normal.x);
+                    vertexData.push_back(normal.y);
+                    vertexData.push_back(normal.z);
+                }
+            }
+        }
+    }
+
+    vertexCount = static_cast<int>(vertexData.size() / VERTEX_STRIDE);
+    if (optimizeVertexCache) {
+        VertexCache::optimize(indices, vertexCount);
+    }
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "mappedFile.h"
+
+/**
+	GPU ready indexed mesh data built from OBJ models, with a binary cache so that warm starts skip OBJ parsing. Cache files are
+	stored in the cache directory next to the executable and record the source path, modification time, size and a hash
+	of the source contents. A cache file is used when the path, time and size match, or when only the time changed but the
+	contents hash the same; otherwise the model is rebuilt from the OBJ and the cache file rewritten. The cache also
+	records whether the triangles were reordered for the vertex cache, and is rebuilt if that setting changes.
+*/
+namespace MeshCache {
+	// Floats per vertex: position xyz, texture uv, normal xyz
+	static const int VERTEX_STRIDE = 8;
+
+	typedef struct {
+		// Views into either the mapped cache file or the storage vectors, valid for the lifetime of the mesh
+		std::span<const float> vertices;
+		// Triangle list indexing into vertices
+		std::span<const uint32_t> indices;
+		int vertexCount;
+
+		MappedFile file;
+		// Only used if the cache file could not be written
+		std::vector<float> vertexStorage;
+		std::vector<uint32_t> indexStorage;
+	} Mesh;
+
+	// Loads res/model/<name>.obj, relative to the executable directory
+	bool load(const char* name, Mesh& mesh);
+	bool loadFile(const std::filesystem::path& sourcePath, const std::filesystem::path& cacheDirectory, Mesh& mesh, bool optimizeVertexCache = true);
+	bool buildMesh(const std::filesystem::path& sourcePath, std::vector<float>& vertexData, std::vector<uint32_t>& indices,
+		int& vertexCount, bool optimizeVertexCache);
+}
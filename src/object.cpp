@@ -1,9 +1,12 @@
-#include <format>
 #include <iostream>
+#include <algorithm>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "object.h"
-#include "loader.h"
+#include "meshCache.h"
+#include "vertexFormat.h"
+#include "uniformBuffers.h"
+#include "glState.h"
 
 static const float PI = 3.1415926535897932384626433832795;
 
@@ -16,114 +19,229 @@ static float lag(float current, float target, float speed, float delta) {
 	return current + diff * speed * delta;
 }
 
-void Object::loadOBJ(const char* name) {
-	OBJ::File objFile;
-	OBJ::parseOBJ(std::format("{0}.obj", name), objFile);
-
-	// Format, 8 floats per vertex: vertex xyz, texture uv, normal xyz
-	std::vector<float> vertexData;
-	for (auto& pair : objFile.objects) {
-		for (auto& face : pair.second.faces) {
-			int triangles;
-			const int indices[2][3] = { {0, 1, 2}, {0, 2, 3} };
-
-			// TODO: divide arbitrary polygon into triangles, probably only support convex shapes
-			switch (face.points.size()) {
-			case 3:
-				triangles = 1;
-				break;
-			case 4:
-				triangles = 2;
-				break;
-			default:
-				std::cerr << "Unsupported number of vertices (" << face.points.size() << ") in face." << std::endl;
-				return;
-			}
-
-			for (int triangle = 0; triangle < triangles; triangle++) {
-				for (int index = 0; index < 3; index++) {
-					int i = indices[triangle][index];
-					// Vertex position
-					vertexData.push_back(objFile.vertices[face.points[i].vertexIndex - 1].x);
-					vertexData.push_back(objFile.vertices[face.points[i].vertexIndex - 1].y);
-					vertexData.push_back(objFile.vertices[face.points[i].vertexIndex - 1].z);
-					// Texture coordinate
-					vertexData.push_back(objFile.textureCoordinates[face.points[i].textureIndex - 1].x);
-					vertexData.push_back(objFile.textureCoordinates[face.points[i].textureIndex - 1].y);
-					// Normal
-					vertexData.push_back(objFile.normals[face.points[i].normalIndex - 1].x);
-					vertexData.push_back(objFile.normals[face.points[i].normalIndex - 1].y);
-					vertexData.push_back(objFile.normals[face.points[i].normalIndex - 1].z);
-
-					renderVertices++;
-				}
-			}
-		}
+/**
+	Uploads the mesh to the bound vertex buffer in the given format and sets up the attributes of the bound VAO, along
+	with the uniforms the vertex shader uses to decode quantized vertices. The program must be in use.
+*/
+static void uploadVertices(const MeshCache::Mesh& mesh, VertexFormat::Format format, GLuint program, Shader& vertexShader) {
+	if (format == VertexFormat::FORMAT_QUANTIZED) {
+		VertexFormat::QuantizedMesh quantized;
+		VertexFormat::quantize(mesh.vertices, quantized);
+		glBufferData(GL_ARRAY_BUFFER, quantized.vertices.size() * sizeof(VertexFormat::QuantizedVertex), quantized.vertices.data(), GL_STATIC_DRAW);
+		vertexShader.setUniformVec3("positionOffset", quantized.positionOffset);
+		vertexShader.setUniformVec3("positionScale", quantized.positionScale);
+		vertexShader.setUniformInt("octahedralNormals", 1);
+	} else {
+		glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size_bytes(), mesh.vertices.data(), GL_STATIC_DRAW);
+		vertexShader.setUniformVec3("positionOffset", glm::vec3(0));
+		vertexShader.setUniformVec3("positionScale", glm::vec3(1));
+		vertexShader.setUniformInt("octahedralNormals", 0);
 	}
+	VertexFormat::setupAttributes(program, format);
+}
+
+/**
+	Model matrix for an object floating on the waves. The object sits at the wave height and is tilted to follow the
+	wave normal, with the tilt lagging behind so the object rocks rather than snapping to each new normal.
+*/
+static glm::mat4 floatingModelMatrix(glm::mat4 modelTransform, glm::vec3 position, glm::vec3 wavePosition, glm::vec3 waveNormal,
+	glm::vec3& rotationAngles, float rotationLagSpeed, float elapsedTime) {
+	float angleX = angleBetweenVectors(
+		glm::vec2(waveNormal.x, waveNormal.y),
+		glm::vec2(0, 1)
+	) * (waveNormal.x < 0 ? -1 : 1);
+	angleX = lag(rotationAngles.x, angleX, rotationLagSpeed, elapsedTime);
+
+	float angleZ = angleBetweenVectors(
+		glm::vec2(waveNormal.z, waveNormal.y),
+		glm::vec2(0, 1)
+	) * (waveNormal.z < 0 ? -1 : 1);
+	angleZ = lag(rotationAngles.z, angleZ, rotationLagSpeed, elapsedTime);
+
+	glm::mat4 model = glm::translate(modelTransform, glm::vec3(position.x, wavePosition.y, position.z));
+	model = glm::rotate(model, angleX, glm::vec3(1, 0, 0));
+	model = glm::rotate(model, angleZ, glm::vec3(0, 0, 1));
+
+	rotationAngles.x = angleX;
+	rotationAngles.z = angleZ;
+	return model;
+}
+
+void Object::loadOBJ(const char* name, VertexFormat::Format format) {
+	MeshCache::Mesh mesh;
+	if (!MeshCache::load(name, mesh)) {
+		return;
+	}
+	renderIndices = static_cast<int>(mesh.indices.size());
 
 	glGenVertexArrays(1, &vao);
 	glGenBuffers(1, &vbo);
+	glGenBuffers(1, &ebo);
 	program = glCreateProgram();
 	vertexShader.compileAndAttach(program, GL_VERTEX_SHADER, "object_passthrough_vertex.glsl");
 	fragmentShader.compileAndAttach(program, GL_FRAGMENT_SHADER, "object_passthrough_fragment.glsl");
 	glLinkProgram(program);
-	glUseProgram(program);
+	GLState::useProgram(program);
+	UniformBuffers::bindBlocks(program);
+	modelUniform = vertexShader.getUniform("model");
 
-	glBindVertexArray(vao);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), vertexData.data(), GL_STATIC_DRAW);
+	GLState::bindVertexArray(vao);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, vbo);
+	uploadVertices(mesh, format, program, vertexShader);
+	GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size_bytes(), mesh.indices.data(), GL_STATIC_DRAW);
 
-	const int stride = 8;
+	modelTransform = glm::mat4(1);
+	modelTransform = glm::scale(modelTransform, glm::vec3(1, 1, 1));
+	vertexShader.setUniformMat4(modelUniform, modelTransform);
+}
 
-	GLuint vertexPositionLocation = glGetAttribLocation(program, "vertexPosition");
-	glEnableVertexAttribArray(vertexPositionLocation);
-	glVertexAttribPointer(vertexPositionLocation, 3, GL_FLOAT, GL_FALSE, stride * sizeof(float), (void*)0);
+void Object::queueWaveQuery() {
+	waveQuery = waveQueries->submit(position);
+}
 
-	GLuint textureCoordinateLocation = glGetAttribLocation(program, "textureCoordinate");
-	glEnableVertexAttribArray(textureCoordinateLocation);
-	glVertexAttribPointer(textureCoordinateLocation, 2, GL_FLOAT, GL_FALSE, stride * sizeof(float), (void*)(3 * sizeof(float)));
+void Object::render(float elapsedTime) {
+	GLState::bindVertexArray(vao);
+	GLState::useProgram(program);
 
-	GLuint vertexNormalLocation = glGetAttribLocation(program, "vertexNormal");
-	glEnableVertexAttribArray(vertexNormalLocation);
-	glVertexAttribPointer(vertexNormalLocation, 3, GL_FLOAT, GL_FALSE, stride * sizeof(float), (void*)(5 * sizeof(float)));
+	// Without a query from this frame's batch, such as before the first queueWaveQuery, the object is drawn undisplaced
+	glm::vec3 wavePosition = position;
+	glm::vec3 waveNormal = glm::vec3(0, 1, 0);
+	if (waveQuery >= 0 && static_cast<size_t>(waveQuery) < waveQueries->getQueryCount()) {
+		waveQueries->getResult(waveQuery, wavePosition, waveNormal);
+	}
 
-	modelTransform = glm::mat4(1);
-	modelTransform = glm::scale(modelTransform, glm::vec3(1, 1, 1));
-	vertexShader.setUniformMat4("model", modelTransform);
+	glm::mat4 model = floatingModelMatrix(modelTransform, position, wavePosition, waveNormal, rotationAngles, rotationLagSpeed, elapsedTime);
+	vertexShader.setUniformMat4(modelUniform, model);
+
+	glDrawElements(GL_TRIANGLES, renderIndices, GL_UNSIGNED_INT, 0);
 }
 
-void Object::render(glm::mat4 view, glm::mat4 projection, float time, float elapsedTime) {
-	glBindVertexArray(vao);
-	glUseProgram(program);
 
-	vertexShader.setUniformMat4("view", view);
-	vertexShader.setUniformMat4("projection", projection);
-	vertexShader.setUniformFloat("time", time);
+void ObjectInstanceSet::loadOBJ(const char* name, VertexFormat::Format format) {
+	MeshCache::Mesh mesh;
+	if (!MeshCache::load(name, mesh)) {
+		return;
+	}
+	renderIndices = static_cast<int>(mesh.indices.size());
 
-	glm::vec3 wavePosition;
-	glm::vec3 waveNormal;
-	water->approximateWaveGeometry(position, time, wavePosition, waveNormal);
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &vbo);
+	glGenBuffers(1, &ebo);
+	glGenBuffers(1, &instanceBuffer);
+	program = glCreateProgram();
+	vertexShader.compileAndAttach(program, GL_VERTEX_SHADER, "object_instanced_vertex.glsl");
+	fragmentShader.compileAndAttach(program, GL_FRAGMENT_SHADER, "object_passthrough_fragment.glsl");
+	glLinkProgram(program);
+	GLState::useProgram(program);
+	UniformBuffers::bindBlocks(program);
+
+	GLState::bindVertexArray(vao);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, vbo);
+	uploadVertices(mesh, format, program, vertexShader);
+	GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size_bytes(), mesh.indices.data(), GL_STATIC_DRAW);
+
+	// A mat4 attribute occupies four consecutive vec4 locations, each advancing once per instance
+	instanceModelLocation = glGetAttribLocation(program, "instanceModel");
+	for (int column = 0; column < 4; column++) {
+		glEnableVertexAttribArray(instanceModelLocation + column);
+		glVertexAttribDivisor(instanceModelLocation + column, 1);
+	}
+	reserveInstanceBuffer(std::max<size_t>(positions.size(), 64));
+}
 
-	float angleX = angleBetweenVectors(
-		glm::vec2(waveNormal.x, waveNormal.y),
-		glm::vec2(0, 1)
-	) * (waveNormal.x < 0 ? -1 : 1);
-	angleX = lag(rotationAngles.x, angleX, rotationLagSpeed, elapsedTime);
+int ObjectInstanceSet::addInstance(glm::vec3 position) {
+	positions.push_back(position);
+	rotationAngles.push_back(glm::vec3(0));
+	return static_cast<int>(positions.size() - 1);
+}
 
-	float angleZ = angleBetweenVectors(
-		glm::vec2(waveNormal.z, waveNormal.y),
-		glm::vec2(0, 1)
-	) * (waveNormal.z < 0 ? -1 : 1);
-	angleZ = lag(rotationAngles.z, angleZ, rotationLagSpeed, elapsedTime);
+void ObjectInstanceSet::queueWaveQueries() {
+	waveQueryHandles.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); i++) {
+		waveQueryHandles[i] = waveQueries->submit(positions[i]);
+	}
+}
 
-	glm::mat4 model = glm::translate(modelTransform, glm::vec3(position.x, wavePosition.y, position.z));
-	model = glm::rotate(model, angleX, glm::vec3(1, 0, 0));
-	model = glm::rotate(model, angleZ, glm::vec3(0, 0, 1));
-	vertexShader.setUniformMat4("model", model);
+/**
+	Waits until the GPU is done with the commands before a fence and deletes it. The wait is repeated on timeouts, the
+	region guarded by the fence must not be written while the GPU may still read it; if the wait fails, the whole
+	pipeline is drained instead.
+*/
+static void waitForFence(GLsync& fence) {
+	GLenum status = GL_TIMEOUT_EXPIRED;
+	while (status == GL_TIMEOUT_EXPIRED) {
+		status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+	}
+	if (status == GL_WAIT_FAILED) {
+		std::cerr << "Waiting on an instance buffer fence failed." << std::endl;
+		glFinish();
+	}
+	glDeleteSync(fence);
+	fence = 0;
+}
 
-	rotationAngles.x = angleX;
-	rotationAngles.z = angleZ;
+void ObjectInstanceSet::render(float elapsedTime) {
+	// Instances added after queueWaveQueries have no wave result yet and are drawn from the next frame on
+	const size_t instanceCount = std::min(positions.size(), waveQueryHandles.size());
+	if (instanceCount == 0) {
+		return;
+	}
+
+	GLState::bindVertexArray(vao);
+	GLState::useProgram(program);
 
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glDrawArrays(GL_TRIANGLES, 0, renderVertices);
+	reserveInstanceBuffer(instanceCount);
+	instanceRegion = (instanceRegion + 1) % INSTANCE_BUFFER_REGIONS;
+
+	// Only waits if the GPU is still reading this region from INSTANCE_BUFFER_REGIONS frames ago
+	GLsync& fence = regionFences[instanceRegion];
+	if (fence) {
+		waitForFence(fence);
+	}
+
+	const size_t regionOffset = instanceRegion * instanceCapacity * sizeof(glm::mat4);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glm::mat4* models = static_cast<glm::mat4*>(glMapBufferRange(GL_ARRAY_BUFFER, regionOffset, instanceCount * sizeof(glm::mat4),
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+	if (!models) {
+		std::cerr << "Failed to map the instance buffer, error " << glGetError() << "." << std::endl;
+		return;
+	}
+	for (size_t i = 0; i < instanceCount; i++) {
+		glm::vec3 wavePosition;
+		glm::vec3 waveNormal;
+		waveQueries->getResult(waveQueryHandles[i], wavePosition, waveNormal);
+		models[i] = floatingModelMatrix(modelTransform, positions[i], wavePosition, waveNormal, rotationAngles[i], rotationLagSpeed, elapsedTime);
+	}
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+
+	for (int column = 0; column < 4; column++) {
+		glVertexAttribPointer(instanceModelLocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+			(void*)(regionOffset + column * sizeof(glm::vec4)));
+	}
+
+	glDrawElementsInstanced(GL_TRIANGLES, renderIndices, GL_UNSIGNED_INT, 0, static_cast<GLsizei>(instanceCount));
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 }
+
+/**
+	Grows the instance buffer so each region holds at least the given number of instances. Growing reallocates the whole
+	buffer, so every outstanding fence is waited on first.
+*/
+void ObjectInstanceSet::reserveInstanceBuffer(size_t instanceCount) {
+	if (instanceCount <= instanceCapacity) {
+		return;
+	}
+
+	for (auto& fence : regionFences) {
+		if (fence) {
+			waitForFence(fence);
+		}
+	}
+
+	instanceCapacity = std::max(instanceCount, instanceCapacity * 2);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, INSTANCE_BUFFER_REGIONS * instanceCapacity * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+}
\ No newline at end of file
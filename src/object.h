@@ -6,7 +6,8 @@
 
 #include "glCommon.h"
 #include "shader.h"
-#include "water.h"
+#include "waveQueryService.h"
+#include "vertexFormat.h"
 
 
 class Object {
@@ -15,18 +16,66 @@ public:
 	glm::vec3 rotationAngles = glm::vec3(0, 0, 0);
 
 private:
-	Water* water;
+	WaveQueryService* waveQueries;
+	WaveQueryService::Handle waveQuery = -1;
 	GLuint vao;
 	GLuint vbo;
+	GLuint ebo;
 	GLuint program;
 	Shader vertexShader;
 	Shader fragmentShader;
-	int renderVertices;
+	Shader::UniformHandle modelUniform;
+	int renderIndices;
 	glm::mat4 modelTransform;
 
 	const float rotationLagSpeed = 1.0f;
 public:
-	Object(Water* water) : water(water) {};
-	void loadOBJ(const char* name);
-	void render(glm::mat4 view, glm::mat4 projection, float time, float elapsedTime);
+	Object(WaveQueryService* waveQueries) : waveQueries(waveQueries) {};
+	void loadOBJ(const char* name, VertexFormat::Format format = VertexFormat::FORMAT_FLOAT);
+	void queueWaveQuery();
+	void render(float elapsedTime);
 };
+
+
+/**
+	Many copies of one mesh drawn with a single instanced draw call. All instances share one vertex buffer and program,
+	and their model matrices are streamed each frame into a ring of INSTANCE_BUFFER_REGIONS regions within one buffer.
+	Each region is guarded by a fence, so the CPU writes one region while the GPU may still be reading the others.
+*/
+class ObjectInstanceSet {
+public:
+	static const int INSTANCE_BUFFER_REGIONS = 3;
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> rotationAngles;
+
+private:
+	WaveQueryService* waveQueries;
+	std::vector<WaveQueryService::Handle> waveQueryHandles;
+	GLuint vao;
+	GLuint vbo;
+	GLuint ebo;
+	GLuint instanceBuffer;
+	GLuint program;
+	GLint instanceModelLocation;
+	Shader vertexShader;
+	Shader fragmentShader;
+	int renderIndices = 0;
+	glm::mat4 modelTransform = glm::mat4(1);
+
+	// Instance capacity of each region of the instance buffer
+	size_t instanceCapacity = 0;
+	int instanceRegion = 0;
+	GLsync regionFences[INSTANCE_BUFFER_REGIONS] = {};
+
+	const float rotationLagSpeed = 1.0f;
+public:
+	ObjectInstanceSet(WaveQueryService* waveQueries) : waveQueries(waveQueries) {};
+	void loadOBJ(const char* name, VertexFormat::Format format = VertexFormat::FORMAT_FLOAT);
+	int addInstance(glm::vec3 position);
+	size_t getInstanceCount() const { return positions.size(); }
+	void queueWaveQueries();
+	void render(float elapsedTime);
+private:
+	void reserveInstanceBuffer(size_t instanceCount);
+};
\ No newline at end of file
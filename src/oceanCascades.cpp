@@ -0,0 +1,176 @@
+#include <iostream>
+#include <algorithm>
+
+#include "oceanCascades.h"
+
+static const float PI = 3.1415926535897932384626433832795f;
+// A cascade hands its short waves to the next smaller tile from this many wavelengths across that tile
+static const float CASCADE_HANDOVER_WAVES = 6.0f;
+
+/**
+    Splits the wavenumbers between the cascades. The boundary between a cascade and the next smaller one is where
+    CASCADE_HANDOVER_WAVES waves fit across the smaller tile, or the Nyquist wavenumber of the larger tile if that is
+    lower, so the band of every cascade ends inside its own grid and the bands neither overlap nor leave gaps.
+*/
+void OceanCascades::setSettings(const OceanSettings& settings) {
+    if (settings.cascadeCount < 1 || settings.cascadeCount > MAX_OCEAN_CASCADES) {
+        std::cerr << "Ocean cascade count " << settings.cascadeCount << " is not between 1 and " << MAX_OCEAN_CASCADES << "." << std::endl;
+        return;
+    }
+    for (int i = 0; i < settings.cascadeCount; i++) {
+        const OceanCascadeSettings& cascade = settings.cascades[i];
+        if (!FFT::isPowerOfTwo(cascade.resolution) || cascade.resolution < 4) {
+            std::cerr << "Ocean cascade resolution " << cascade.resolution << " is not a power of two of at least 4." << std::endl;
+            return;
+        }
+        if (cascade.tileSize <= 0.0f || (i > 0 && cascade.tileSize >= settings.cascades[i - 1].tileSize)) {
+            std::cerr << "Ocean cascade tile sizes must be positive and decreasing." << std::endl;
+            return;
+        }
+    }
+    this->settings = settings;
+
+    float minWavenumber = 0.0f;
+    for (int i = 0; i < settings.cascadeCount; i++) {
+        const OceanCascadeSettings& cascade = settings.cascades[i];
+        float maxWavenumber = 0.0f;
+        if (i + 1 < settings.cascadeCount) {
+            const float handover = CASCADE_HANDOVER_WAVES * 2.0f * PI / settings.cascades[i + 1].tileSize;
+            const float nyquist = PI * cascade.resolution / cascade.tileSize;
+            maxWavenumber = std::max(std::min(handover, nyquist), minWavenumber);
+        }
+
+        OceanSpectrumSettings spectrumSettings = {
+            .resolution = cascade.resolution,
+            .tileSize = cascade.tileSize,
+            .windSpeed = settings.windSpeed,
+            .windDirection = settings.windDirection,
+            .fetch = settings.fetch,
+            .choppiness = settings.choppiness,
+            .spectrum = settings.spectrum,
+            .seed = settings.seed + i,
+            .minWavenumber = minWavenumber,
+            .maxWavenumber = maxWavenumber
+        };
+        cascades[i].setSettings(spectrumSettings);
+        minWavenumber = maxWavenumber;
+    }
+    valid = false;
+}
+
+/**
+    Cascade i is updated on the frames where (frame + i) is a multiple of its interval, and on the first frame after its
+    settings change. The maximum displacement is the sum over the cascades, a bound rather than the true maximum.
+*/
+void OceanCascades::update(float time) {
+    if (!settings.enabled) {
+        valid = false;
+        return;
+    }
+    ThreadPool& pool = threadPool ? *threadPool : ThreadPool::getShared();
+
+    maxDisplacement = 0.0f;
+    for (int i = 0; i < settings.cascadeCount; i++) {
+        const int interval = std::max(settings.cascades[i].updateInterval, 1);
+        cascadeUpdated[i] = !cascades[i].isValid() || (frame + i) % interval == 0;
+        if (cascadeUpdated[i]) {
+            cascades[i].update(time, pool);
+        }
+        maxDisplacement += cascades[i].getMaxDisplacement();
+    }
+    frame++;
+
+    this->time = time;
+    valid = true;
+}
+
+void OceanCascades::interpolate(glm::vec2 location, glm::vec4& displacement, glm::vec4& derivative) const {
+    displacement = glm::vec4(0.0f);
+    derivative = glm::vec4(0.0f);
+    for (int i = 0; i < settings.cascadeCount; i++) {
+        glm::vec4 cascadeDisplacement;
+        glm::vec4 cascadeDerivative;
+        cascades[i].interpolate(location, cascadeDisplacement, cascadeDerivative);
+        displacement += cascadeDisplacement;
+        derivative += cascadeDerivative;
+    }
+}
+
+/**
+    Answers a wave query from the last update. Returns false, leaving the outputs untouched, if the cascades were not
+    updated for this time. See HeightFieldCache::sample for the solver.
+*/
+bool OceanCascades::sample(glm::vec2 desiredLocation, float time, const WaveSampler::SolverSettings& solverSettings,
+    glm::vec3& wavePosition, glm::vec3& waveNormal, WaveSampler::SolverStats* stats) const {
+    if (!valid || time != this->time) {
+        return false;
+    }
+
+    glm::vec2 location = desiredLocation;
+    glm::vec4 displacement;
+    glm::vec4 derivative;
+    float residual;
+    int iteration = 0;
+    while (true) {
+        interpolate(location, displacement, derivative);
+        iteration++;
+
+        glm::vec2 offset = location + glm::vec2(displacement.x, displacement.z) - desiredLocation;
+        residual = glm::length(offset);
+        if (iteration >= solverSettings.maxIterations || residual < solverSettings.tolerance) {
+            break;
+        }
+
+        // The Jacobian is symmetric, displacement.w is both d(z)/dx and d(x)/dz
+        glm::vec2 step = offset;
+        const float jacobianXX = 1.0f + derivative.z;
+        const float jacobianZZ = 1.0f + derivative.w;
+        const float determinant = jacobianXX * jacobianZZ - displacement.w * displacement.w;
+        if (solverSettings.newton && determinant > WaveSampler::MIN_NEWTON_DETERMINANT) {
+            step = glm::vec2(jacobianZZ * offset.x - displacement.w * offset.y, jacobianXX * offset.y - displacement.w * offset.x) / determinant;
+        }
+        location -= step;
+    }
+
+    const glm::vec3 tangent = glm::vec3(1.0f + derivative.z, derivative.x, displacement.w);
+    const glm::vec3 binormal = glm::vec3(displacement.w, derivative.y, 1.0f + derivative.w);
+    wavePosition = glm::vec3(location.x + displacement.x, displacement.y, location.y + displacement.z);
+    waveNormal = glm::normalize(glm::cross(binormal, tangent));
+
+    if (stats) {
+        stats->iterations = iteration;
+        stats->residual = residual;
+    }
+    return true;
+}
+
+// Batched lookup with the same contract as WaveSampler::sample, returns false if the cascades were not updated for this time
+bool OceanCascades::sampleRange(float time, const WaveSampler::SolverSettings& solverSettings, WaveSampler::Batch& batch, size_t begin, size_t end) const {
+    if (!valid || time != this->time) {
+        return false;
+    }
+
+    for (size_t i = begin; i < end; i++) {
+        glm::vec3 wavePosition;
+        glm::vec3 waveNormal;
+        WaveSampler::SolverStats stats;
+        sample(glm::vec2(batch.x[i], batch.z[i]), time, solverSettings, wavePosition, waveNormal, &stats);
+        batch.positionX[i] = wavePosition.x;
+        batch.positionZ[i] = wavePosition.z;
+        batch.height[i] = wavePosition.y;
+        batch.normalX[i] = waveNormal.x;
+        batch.normalY[i] = waveNormal.y;
+        batch.normalZ[i] = waveNormal.z;
+        batch.residual[i] = stats.residual;
+        batch.iterations[i] = stats.iterations;
+    }
+    return true;
+}
+
+size_t OceanCascades::getMemoryUsage() const {
+    size_t bytes = 0;
+    for (int i = 0; i < settings.cascadeCount; i++) {
+        bytes += cascades[i].getMemoryUsage();
+    }
+    return bytes;
+}
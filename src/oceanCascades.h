@@ -0,0 +1,95 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include "oceanSpectrum.h"
+#include "threadPool.h"
+#include "waveSampler.h"
+
+static const int MAX_OCEAN_CASCADES = 4;
+
+typedef struct {
+	// World space size, in meters, of each side of the cascade's tile
+	float tileSize;
+	// Grid nodes along each side of the tile, a power of two
+	int resolution;
+	// Frames between updates of the cascade, 1 updates it every frame
+	int updateInterval;
+} OceanCascadeSettings;
+
+typedef struct {
+	bool enabled;
+	// Cascades in use, from 1 to MAX_OCEAN_CASCADES, ordered from the largest tile to the smallest
+	int cascadeCount;
+	OceanCascadeSettings cascades[MAX_OCEAN_CASCADES];
+	// Shared by every cascade, see OceanSpectrumSettings
+	float windSpeed;
+	float windDirection;
+	float fetch;
+	float choppiness;
+	OceanSpectrumType spectrum;
+	unsigned int seed;
+} OceanSettings;
+
+/**
+	Ocean surface summed from several OceanSpectrum tiles of different sizes, so long swells do not repeat every few
+	hundred meters and short chop still has texels to spare. Each cascade keeps only the wavenumbers between its
+	neighbors' bands, so no wave is counted twice: a cascade hands its short waves to the next smaller tile once they
+	are a few wavelengths across that tile, where the smaller tile resolves them finely enough in direction and length.
+
+	Swells change slowly from frame to frame and chop quickly, so each cascade is updated every updateInterval frames
+	at its own offset, which spreads the larger tiles over different frames. Between updates a cascade keeps the surface
+	of its last update, and the renderer and the wave queries both read that same state.
+
+	Queries sum the displacement and derivatives of every cascade at a location and invert the horizontal displacement
+	with the same fixed point iteration as HeightFieldCache, using the summed Jacobian for Newton steps.
+*/
+class OceanCascades {
+private:
+	OceanSettings settings = {
+		.enabled = false,
+		.cascadeCount = 3,
+		.cascades = {
+			{ .tileSize = 1024.0f, .resolution = 256, .updateInterval = 4 },
+			{ .tileSize = 256.0f, .resolution = 256, .updateInterval = 2 },
+			{ .tileSize = 64.0f, .resolution = 256, .updateInterval = 1 },
+			{ .tileSize = 16.0f, .resolution = 128, .updateInterval = 1 }
+		},
+		.windSpeed = 10.0f,
+		.windDirection = 1.1f,
+		.fetch = 100.0f,
+		.choppiness = 1.0f,
+		.spectrum = OCEAN_SPECTRUM_JONSWAP,
+		.seed = 100
+	};
+
+	OceanSpectrum cascades[MAX_OCEAN_CASCADES];
+	// Cascades updated by the last call to update
+	bool cascadeUpdated[MAX_OCEAN_CASCADES] = {};
+	// The cascades are updated on the shared pool unless another one is set
+	ThreadPool* threadPool = nullptr;
+	unsigned long long frame = 0;
+	float maxDisplacement = 0.0f;
+	float time = 0.0f;
+	bool valid = false;
+
+public:
+	void setSettings(const OceanSettings& settings);
+	const OceanSettings& getSettings() const { return settings; }
+	void setThreadPool(ThreadPool* threadPool) { this->threadPool = threadPool; }
+	// Called once per frame, updates the cascades due this frame to the given time
+	void update(float time);
+	bool sample(glm::vec2 desiredLocation, float time, const WaveSampler::SolverSettings& solverSettings,
+		glm::vec3& wavePosition, glm::vec3& waveNormal, WaveSampler::SolverStats* stats = nullptr) const;
+	bool sampleRange(float time, const WaveSampler::SolverSettings& solverSettings, WaveSampler::Batch& batch, size_t begin, size_t end) const;
+
+	bool isValid() const { return valid; }
+	int getCascadeCount() const { return settings.cascadeCount; }
+	const OceanSpectrum& getCascade(int cascade) const { return cascades[cascade]; }
+	bool wasCascadeUpdated(int cascade) const { return cascadeUpdated[cascade]; }
+	// Largest displacement along any axis of the summed cascades, for culling
+	float getMaxDisplacement() const { return maxDisplacement; }
+	size_t getMemoryUsage() const;
+
+private:
+	void interpolate(glm::vec2 location, glm::vec4& displacement, glm::vec4& derivative) const;
+};
@@ -0,0 +1,250 @@
+#include <iostream>
+#include <cmath>
+#include <random>
+#include <algorithm>
+
+#include "oceanSpectrum.h"
+
+static const float GRAVITY = 9.81f;
+static const float PI = 3.1415926535897932384626433832795f;
+
+void OceanSpectrum::setSettings(const OceanSpectrumSettings& settings) {
+    if (!FFT::isPowerOfTwo(settings.resolution) || settings.resolution < 4) {
+        std::cerr << "Ocean spectrum resolution " << settings.resolution << " is not a power of two of at least 4." << std::endl;
+        return;
+    }
+    this->settings = settings;
+    hasSpectrumUpdate = true;
+    valid = false;
+}
+
+/**
+    Directional wavenumber spectrum, the variance of the surface height per unit area of wave vectors, in m^4.
+
+    Phillips is the spectrum from Tessendorf's notes. Its constant is chosen so the significant wave height matches a
+    fully developed Pierson-Moskowitz sea, 0.21 U^2 / g, and waves shorter than a thousandth of the longest are damped.
+
+    JONSWAP is the frequency spectrum of a fetch limited sea, converted to wave vectors with the deep water dispersion
+    relation, S(k) = S(w) dw/dk / k, and spread around the wind with (2 / pi) cos^2 over the half plane it blows towards.
+*/
+float OceanSpectrum::getSpectrum(glm::vec2 k) const {
+    const float kLength = glm::length(k);
+    if (kLength < 1e-6f) {
+        return 0.0f;
+    }
+    const float windSpeed = std::max(settings.windSpeed, 0.1f);
+    const glm::vec2 wind = glm::vec2(std::cos(settings.windDirection), std::sin(settings.windDirection));
+    const float cosine = glm::dot(k / kLength, wind);
+
+    if (settings.spectrum == OCEAN_SPECTRUM_PHILLIPS) {
+        const float amplitude = 0.00175f;
+        const float longestWave = windSpeed * windSpeed / GRAVITY;
+        const float shortestWave = longestWave / 1000.0f;
+        const float kL = kLength * longestWave;
+        return amplitude * std::exp(-1.0f / (kL * kL)) / std::pow(kLength, 4.0f) * cosine * cosine *
+            std::exp(-kLength * kLength * shortestWave * shortestWave);
+    }
+
+    if (cosine <= 0.0f) {
+        return 0.0f;
+    }
+    const float fetch = std::max(settings.fetch, 0.1f) * 1000.0f;
+    const float omega = std::sqrt(GRAVITY * kLength);
+    const float alpha = 0.076f * std::pow(windSpeed * windSpeed / (fetch * GRAVITY), 0.22f);
+    const float peakOmega = 22.0f * std::cbrt(GRAVITY * GRAVITY / (windSpeed * fetch));
+    const float gamma = 3.3f;
+    const float sigma = omega <= peakOmega ? 0.07f : 0.09f;
+    const float peakOffset = (omega - peakOmega) / (sigma * peakOmega);
+    const float frequencySpectrum = alpha * GRAVITY * GRAVITY / std::pow(omega, 5.0f) *
+        std::exp(-1.25f * std::pow(peakOmega / omega, 4.0f)) * std::pow(gamma, std::exp(-0.5f * peakOffset * peakOffset));
+    return frequencySpectrum * GRAVITY / (2.0f * omega) / kLength * (2.0f / PI) * cosine * cosine;
+}
+
+/**
+    Draws a complex Gaussian amplitude for every wave vector, with the variance the spectrum gives to its cell of the
+    wave vector grid. The wave vector of node (x, z) is 2 pi / tileSize * (x - resolution / 2, z - resolution / 2).
+    Wave vectors outside the wavenumber band get no amplitude. Also lays out the work buffers for this resolution in
+    the arena.
+*/
+void OceanSpectrum::generateAmplitudes() {
+    const int resolution = settings.resolution;
+    const size_t nodeCount = static_cast<size_t>(resolution) * resolution;
+    const int bandCount = resolution / std::min(resolution, BAND_SIZE);
+    arena.reserve(Arena::getAllocationSize(nodeCount * sizeof(FFT::Complex)) + Arena::getAllocationSize(nodeCount * sizeof(float)) +
+        4 * SPECTRUM_COUNT * Arena::getAllocationSize(nodeCount * sizeof(float)) + Arena::getAllocationSize(bandCount * sizeof(float)));
+    initialAmplitudes = arena.allocate<FFT::Complex>(nodeCount);
+    angularFrequencies = arena.allocate<float>(nodeCount);
+    for (int spectrum = 0; spectrum < SPECTRUM_COUNT; spectrum++) {
+        for (int part = 0; part < 2; part++) {
+            spectra[spectrum][part] = arena.allocate<float>(nodeCount);
+            transposed[spectrum][part] = arena.allocate<float>(nodeCount);
+        }
+    }
+    bandMaxDisplacements = arena.allocate<float>(bandCount);
+
+    const float dk = 2.0f * PI / settings.tileSize;
+    const float maxWavenumber = settings.maxWavenumber > 0.0f ? settings.maxWavenumber : INFINITY;
+    std::mt19937 random(settings.seed);
+    std::normal_distribution<float> gaussian;
+    for (int z = 0; z < resolution; z++) {
+        for (int x = 0; x < resolution; x++) {
+            const glm::vec2 k = dk * glm::vec2(x - resolution / 2, z - resolution / 2);
+            const float kLength = glm::length(k);
+            const bool inBand = kLength >= settings.minWavenumber && kLength < maxWavenumber;
+            const float amplitude = inBand ? std::sqrt(getSpectrum(k) * dk * dk / 2.0f) : 0.0f;
+            const float real = gaussian(random);
+            const float imaginary = gaussian(random);
+            initialAmplitudes[z * resolution + x] = FFT::Complex(real, imaginary) * amplitude;
+            angularFrequencies[z * resolution + x] = std::sqrt(GRAVITY * glm::length(k));
+        }
+    }
+
+    fft.init(resolution, true);
+    displacements.resize(nodeCount);
+    derivatives.resize(nodeCount);
+    hasSpectrumUpdate = false;
+}
+
+/**
+    The amplitude at time t is h(k, t) = h0(k) exp(i w t) + conj(h0(-k)) exp(-i w t), which keeps the height real. The
+    other fields are h times i k for the slopes, i k / |k| for the horizontal displacement, which moves points towards
+    the crests like the Gerstner waves, and -k k / |k| for the derivatives of the displacement. The spectra are packed
+    in pairs, (height, d(x)/dz), (x, z displacement), (x, z slope) and (d(x)/dx, d(z)/dz).
+
+    The wave vectors on the first row and column, at the Nyquist frequency, have no partner at -k on the grid and are
+    left out, since their transform would not be real and would leak into the other field of the pair.
+*/
+void OceanSpectrum::fillSpectra(float time, int rowBegin, int rowEnd) {
+    const int resolution = settings.resolution;
+    const float dk = 2.0f * PI / settings.tileSize;
+    for (int z = rowBegin; z < rowEnd; z++) {
+        for (int x = 0; x < resolution; x++) {
+            const int index = z * resolution + x;
+            const glm::vec2 k = dk * glm::vec2(x - resolution / 2, z - resolution / 2);
+            const float kLength = glm::length(k);
+            if (x == 0 || z == 0 || kLength < 1e-6f) {
+                for (int spectrum = 0; spectrum < SPECTRUM_COUNT; spectrum++) {
+                    spectra[spectrum][0][index] = 0.0f;
+                    spectra[spectrum][1][index] = 0.0f;
+                }
+                continue;
+            }
+
+            // Written out in real arithmetic, std::complex products check for infinities and NaNs
+            const int opposite = ((resolution - z) % resolution) * resolution + (resolution - x) % resolution;
+            const float phase = angularFrequencies[index] * time;
+            const float c = std::cos(phase);
+            const float s = std::sin(phase);
+            const FFT::Complex a = initialAmplitudes[index];
+            const FFT::Complex b = initialAmplitudes[opposite];
+            const float hReal = (a.real() + b.real()) * c - (a.imag() + b.imag()) * s;
+            const float hImaginary = (a.real() - b.real()) * s + (a.imag() - b.imag()) * c;
+
+            // A pair (p, q) of real scale factors packs p h + i q h, whose parts are below
+            const glm::vec2 direction = k / kLength;
+            auto pack = [&](int spectrum, float pReal, float pImaginary, float qReal, float qImaginary) {
+                spectra[spectrum][0][index] = pReal * hReal - pImaginary * hImaginary - qReal * hImaginary - qImaginary * hReal;
+                spectra[spectrum][1][index] = pReal * hImaginary + pImaginary * hReal + qReal * hReal - qImaginary * hImaginary;
+            };
+            // Height and d(x)/dz
+            pack(0, 1.0f, 0.0f, -k.x * direction.y, 0.0f);
+            // x and z displacement
+            pack(1, 0.0f, direction.x, 0.0f, direction.y);
+            // x and z slope
+            pack(2, 0.0f, k.x, 0.0f, k.y);
+            // d(x)/dx and d(z)/dz
+            pack(3, -k.x * direction.x, 0.0f, -k.y * direction.y, 0.0f);
+        }
+    }
+}
+
+// Wave vectors start at -resolution / 2 rather than 0, which flips the sign of every other node
+void OceanSpectrum::writeOutputs(int rowBegin, int rowEnd, float& maxDisplacement) {
+    const int resolution = settings.resolution;
+    const float choppiness = settings.choppiness;
+    maxDisplacement = 0.0f;
+    for (int z = rowBegin; z < rowEnd; z++) {
+        for (int x = 0; x < resolution; x++) {
+            const int index = z * resolution + x;
+            const float sign = ((x + z) & 1) ? -1.0f : 1.0f;
+            const glm::vec4 displacement = sign * glm::vec4(choppiness * spectra[1][0][index], spectra[0][0][index],
+                choppiness * spectra[1][1][index], choppiness * spectra[0][1][index]);
+            displacements[index] = displacement;
+            derivatives[index] = sign * glm::vec4(spectra[2][0][index], spectra[2][1][index], choppiness * spectra[3][0][index],
+                choppiness * spectra[3][1][index]);
+            maxDisplacement = std::max(maxDisplacement, glm::max(std::abs(displacement.x), glm::max(std::abs(displacement.y), std::abs(displacement.z))));
+        }
+    }
+}
+
+/**
+    Each pass is split into bands of BAND_SIZE rows or columns, one task per band and spectrum, and the pool finishes a
+    pass before the next one starts. The 2D transforms are a column pass, a transpose, a column pass over the
+    transposed planes, which transforms the rows, and a transpose back.
+*/
+void OceanSpectrum::update(float time, ThreadPool& threadPool) {
+    if (hasSpectrumUpdate) {
+        generateAmplitudes();
+    }
+
+    const int resolution = settings.resolution;
+    const int bandSize = std::min(resolution, BAND_SIZE);
+    const int bandCount = resolution / bandSize;
+
+    threadPool.run(bandCount, [&](int band) {
+        fillSpectra(time, band * bandSize, (band + 1) * bandSize);
+    });
+
+    auto transformColumns = [&](float* (&planes)[SPECTRUM_COUNT][2]) {
+        threadPool.run(SPECTRUM_COUNT * bandCount, [&](int task) {
+            const int spectrum = task / bandCount;
+            const int band = task % bandCount;
+            fft.transformColumns(planes[spectrum][0], planes[spectrum][1], band * bandSize, (band + 1) * bandSize);
+        });
+    };
+    auto transpose = [&](float* (&source)[SPECTRUM_COUNT][2], float* (&destination)[SPECTRUM_COUNT][2]) {
+        threadPool.run(SPECTRUM_COUNT * bandCount, [&](int task) {
+            const int spectrum = task / bandCount;
+            const int band = task % bandCount;
+            for (int part = 0; part < 2; part++) {
+                FFT::transpose(source[spectrum][part], destination[spectrum][part], resolution, band * bandSize, (band + 1) * bandSize);
+            }
+        });
+    };
+    transformColumns(spectra);
+    transpose(spectra, transposed);
+    transformColumns(transposed);
+    transpose(transposed, spectra);
+
+    threadPool.run(bandCount, [&](int band) {
+        writeOutputs(band * bandSize, (band + 1) * bandSize, bandMaxDisplacements[band]);
+    });
+    maxDisplacement = *std::max_element(bandMaxDisplacements, bandMaxDisplacements + bandCount);
+
+    this->time = time;
+    valid = true;
+}
+
+void OceanSpectrum::interpolate(glm::vec2 location, glm::vec4& displacement, glm::vec4& derivative) const {
+    const int resolution = settings.resolution;
+    const glm::vec2 grid = location / settings.tileSize * float(resolution);
+    const glm::vec2 cell = glm::floor(grid);
+    const glm::vec2 t = grid - cell;
+    const int x0 = ((static_cast<int>(cell.x) % resolution) + resolution) % resolution;
+    const int z0 = ((static_cast<int>(cell.y) % resolution) + resolution) % resolution;
+    const int x1 = (x0 + 1) % resolution;
+    const int z1 = (z0 + 1) % resolution;
+
+    const int indices[4] = { z0 * resolution + x0, z0 * resolution + x1, z1 * resolution + x0, z1 * resolution + x1 };
+    const float weights[4] = { (1 - t.x) * (1 - t.y), t.x * (1 - t.y), (1 - t.x) * t.y, t.x * t.y };
+    displacement = glm::vec4(0.0f);
+    derivative = glm::vec4(0.0f);
+    for (int corner = 0; corner < 4; corner++) {
+        displacement += weights[corner] * displacements[indices[corner]];
+        derivative += weights[corner] * derivatives[indices[corner]];
+    }
+}
+
+size_t OceanSpectrum::getMemoryUsage() const {
+    return arena.getCapacity() + (displacements.capacity() + derivatives.capacity()) * sizeof(glm::vec4);
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "fft.h"
+#include "arena.h"
+#include "threadPool.h"
+
+enum OceanSpectrumType {
+	OCEAN_SPECTRUM_PHILLIPS = 0,
+	OCEAN_SPECTRUM_JONSWAP = 1
+};
+
+typedef struct {
+	// Grid nodes along each side of the tile, a power of two
+	int resolution;
+	// World space size, in meters, of each side of the tile, which repeats across the ocean
+	float tileSize;
+	// Wind speed in meters per second, 10 m above the surface
+	float windSpeed;
+	// Angle of the wind in radians, 0 blows towards +x
+	float windDirection;
+	// Distance in kilometers the wind has blown over the water, only used by JONSWAP
+	float fetch;
+	// Scale of the horizontal displacement, 0 gives rounded crests and larger values sharper crests
+	float choppiness;
+	OceanSpectrumType spectrum;
+	unsigned int seed;
+	// Wave vectors shorter than minWavenumber or at least maxWavenumber, in radians per meter, are left out, so tiles of
+	// different sizes can be summed without repeating waves. A maxWavenumber of 0 keeps every wave vector on the grid.
+	float minWavenumber;
+	float maxWavenumber;
+} OceanSpectrumSettings;
+
+/**
+	Ocean surface built from a wave spectrum as described by Tessendorf in "Simulating Ocean Water". Random amplitudes for
+	every wave vector on the grid are drawn once from the spectrum when the settings change; each update evolves them to
+	the given time with the deep water dispersion relation and transforms them into a periodic tile of displacement and
+	its derivatives. The cost of an update depends only on the resolution, and every wave vector on the grid inside the
+	wavenumber band contributes, up to resolution * resolution waves in all.
+
+	Each output field is real, so two fields are transformed together as the real and imaginary parts of one complex
+	FFT, which makes the eight fields four 2D transforms. The spectra are stored as separate real and imaginary planes
+	and every pass of an update, filling the spectra, the column transforms, the transposes and the output, is split
+	into bands of rows or columns run on a thread pool. The planes are carved from one arena when the settings change,
+	so an update allocates nothing.
+
+	The outputs hold derivatives rather than normals and Jacobians, since those of several tiles do not add up while
+	derivatives do, see OceanCascades.
+*/
+class OceanSpectrum {
+private:
+	OceanSpectrumSettings settings = {
+		.resolution = 256,
+		.tileSize = 256.0f,
+		.windSpeed = 10.0f,
+		.windDirection = 1.1f,
+		.fetch = 100.0f,
+		.choppiness = 1.0f,
+		.spectrum = OCEAN_SPECTRUM_JONSWAP,
+		.seed = 100,
+		.minWavenumber = 0.0f,
+		.maxWavenumber = 0.0f
+	};
+
+	static const int SPECTRUM_COUNT = 4;
+	// Rows or columns per task of the parallel passes, a multiple of the SIMD width of FFT::transformColumns
+	static const int BAND_SIZE = 16;
+
+	bool hasSpectrumUpdate = true;
+	FFT fft;
+	Arena arena;
+	// Amplitude of each wave vector at time 0, h0(k) in Tessendorf's notes
+	FFT::Complex* initialAmplitudes = nullptr;
+	float* angularFrequencies = nullptr;
+	// Real and imaginary planes of the packed spectra of the field pairs, see update, and of their transposes
+	float* spectra[SPECTRUM_COUNT][2] = {};
+	float* transposed[SPECTRUM_COUNT][2] = {};
+	// Largest displacement found by each band of the output pass
+	float* bandMaxDisplacements = nullptr;
+
+	// Horizontal displacement in x and z, the height, and d(x)/dz = d(z)/dx
+	std::vector<glm::vec4> displacements;
+	// Slopes of the height along x and z, d(x)/dx and d(z)/dz. With d(x)/dz these are the Jacobian of the displaced
+	// horizontal position minus the identity.
+	std::vector<glm::vec4> derivatives;
+	float maxDisplacement = 0.0f;
+	float time = 0.0f;
+	bool valid = false;
+
+public:
+	void setSettings(const OceanSpectrumSettings& settings);
+	const OceanSpectrumSettings& getSettings() const { return settings; }
+	void update(float time, ThreadPool& threadPool);
+	// Bilinear lookup in the periodic tile, see displacements and derivatives
+	void interpolate(glm::vec2 location, glm::vec4& displacement, glm::vec4& derivative) const;
+
+	bool isValid() const { return valid; }
+	// Time of the last update
+	float getTime() const { return time; }
+	const std::vector<glm::vec4>& getDisplacements() const { return displacements; }
+	const std::vector<glm::vec4>& getDerivatives() const { return derivatives; }
+	// Largest displacement along any axis in the last update, for culling
+	float getMaxDisplacement() const { return maxDisplacement; }
+	size_t getMemoryUsage() const;
+
+private:
+	void generateAmplitudes();
+	void fillSpectra(float time, int rowBegin, int rowEnd);
+	void writeOutputs(int rowBegin, int rowEnd, float& maxDisplacement);
+	float getSpectrum(glm::vec2 k) const;
+};
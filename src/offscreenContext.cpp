@@ -0,0 +1,143 @@
+#include <iostream>
+#include <cstring>
+
+#ifdef OCEAN_GL_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "offscreenContext.h"
+#include "glState.h"
+
+namespace OffscreenContext {
+#ifdef OCEAN_GL_EGL
+    static EGLDisplay display = EGL_NO_DISPLAY;
+    static EGLContext context = EGL_NO_CONTEXT;
+
+    static bool hasExtension(const char* extensions, const char* name) {
+        if (!extensions) {
+            return false;
+        }
+        const size_t length = strlen(name);
+        for (const char* start = extensions; (start = strstr(start, name)) != nullptr; start += length) {
+            if ((start == extensions || start[-1] == ' ') && (start[length] == ' ' || start[length] == '\0')) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+        Prefers Mesa's surfaceless platform, which needs neither a display server nor a GPU, and otherwise uses the
+        default display of the EGL implementation.
+    */
+    static EGLDisplay getDisplay() {
+        const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+            auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+            if (getPlatformDisplay) {
+                EGLDisplay surfaceless = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+                if (surfaceless != EGL_NO_DISPLAY) {
+                    return surfaceless;
+                }
+            }
+        }
+        return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    bool create() {
+        display = getDisplay();
+        EGLint major, minor;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+            std::cerr << "Failed to initialize EGL, error 0x" << std::hex << eglGetError() << std::dec << std::endl;
+            return false;
+        }
+
+        // Rendering only goes to framebuffer objects, so the context is made current without a surface
+        const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+        if (!hasExtension(extensions, "EGL_KHR_surfaceless_context")) {
+            std::cerr << "EGL " << major << "." << minor << " does not support surfaceless contexts" << std::endl;
+            destroy();
+            return false;
+        }
+
+        // The default surface type is window, which surfaceless displays have no configs for
+        const EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint configCount = 0;
+        if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+            std::cerr << "Failed to find an EGL config for OpenGL" << std::endl;
+            destroy();
+            return false;
+        }
+
+        const EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 1,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        eglBindAPI(EGL_OPENGL_API);
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+        if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+            std::cerr << "Failed to create an OpenGL 4.1 context, EGL error 0x" << std::hex << eglGetError() << std::dec << std::endl;
+            destroy();
+            return false;
+        }
+
+        gladLoadGLLoader((GLADloadproc) eglGetProcAddress);
+        GLState::invalidate();
+        return true;
+    }
+
+    void destroy() {
+        if (display == EGL_NO_DISPLAY) {
+            return;
+        }
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context != EGL_NO_CONTEXT) {
+            eglDestroyContext(display, context);
+            context = EGL_NO_CONTEXT;
+        }
+        eglTerminate(display);
+        display = EGL_NO_DISPLAY;
+    }
+#else
+    static GLFWwindow* window = nullptr;
+
+    bool create() {
+        if (!glfwInit()) {
+            std::cerr << "Failed to initialize GLFW" << std::endl;
+            return false;
+        }
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        window = glfwCreateWindow(64, 64, "ocean-gl offscreen", NULL, NULL);
+        if (!window) {
+            std::cerr << "Failed to create an OpenGL 4.1 context" << std::endl;
+            glfwTerminate();
+            return false;
+        }
+        glfwMakeContextCurrent(window);
+        gladLoadGLLoader((GLADloadproc) glfwGetProcAddress);
+        GLState::invalidate();
+        return true;
+    }
+
+    void destroy() {
+        if (!window) {
+            return;
+        }
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        window = nullptr;
+    }
+#endif
+}
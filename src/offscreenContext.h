@@ -0,0 +1,14 @@
+#pragma once
+#include "glCommon.h"
+
+/**
+	An OpenGL 4.1 core context without a window, for rendering into framebuffer objects on machines without a display
+	or GPU. Builds with EGL (OCEAN_GL_EGL) create a surfaceless EGL context, which Mesa provides on top of llvmpipe when
+	there is no GPU. Other builds fall back to a hidden GLFW window, which still needs a display to connect to.
+
+	The context is made current and GL functions are loaded by create. Only one offscreen context exists at a time.
+*/
+namespace OffscreenContext {
+	bool create();
+	void destroy();
+}
@@ -0,0 +1,147 @@
+#include <iostream>
+#include <fstream>
+#include <format>
+#include <algorithm>
+
+#include "profiler.h"
+
+Profiler::ScopeHandle Profiler::getScope(const std::string& name, bool gpu) {
+    for (int i = 0; i < scopes.size(); i++) {
+        if (scopes[i].name == name && scopes[i].gpu == gpu) {
+            return i;
+        }
+    }
+
+    scopes.push_back({
+        .name = name,
+        .gpu = gpu,
+        .cpuHistory = std::vector<float>(HISTORY_LENGTH, 0.0f),
+        .gpuHistory = std::vector<float>(HISTORY_LENGTH, 0.0f),
+        .cpuMilliseconds = 0.0f,
+        .gpuMilliseconds = 0.0f,
+        .gpuFrame = -1
+    });
+    queries.emplace_back(gpu ? QUERY_LATENCY : 0, PendingQuery{ .query = 0, .pending = false, .cpuStart = 0.0 });
+    scopeStarts.push_back(0.0);
+    return static_cast<ScopeHandle>(scopes.size() - 1);
+}
+
+double Profiler::now() const {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+/**
+    Reads back the query in this slot if its result is available, and drops it otherwise. Queries are only resolved
+    when their slot is about to be reused, QUERY_LATENCY frames after they were issued.
+*/
+void Profiler::resolveQuery(ScopeHandle scope, PendingQuery& pending) {
+    if (!pending.pending) {
+        return;
+    }
+    pending.pending = false;
+
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        droppedQueries++;
+        return;
+    }
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &nanoseconds);
+    const double microseconds = nanoseconds / 1e3;
+
+    Scope& resolved = scopes[scope];
+    resolved.gpuMilliseconds = static_cast<float>(microseconds / 1e3);
+    resolved.gpuHistory[frame % HISTORY_LENGTH] = resolved.gpuMilliseconds;
+    resolved.gpuFrame = frame;
+
+    if (tracing && traceEvents.size() < MAX_TRACE_EVENTS) {
+        const double start = std::max(pending.cpuStart, lastGpuEventEnd);
+        traceEvents.push_back({ .scope = scope, .gpu = true, .start = start, .duration = microseconds });
+        lastGpuEventEnd = start + microseconds;
+    }
+}
+
+void Profiler::begin(ScopeHandle scope) {
+    const double start = now();
+    scopeStarts[scope] = start;
+    if (!scopes[scope].gpu) {
+        return;
+    }
+
+    PendingQuery& pending = queries[scope][frame % QUERY_LATENCY];
+    if (pending.query == 0) {
+        glGenQueries(1, &pending.query);
+    }
+    resolveQuery(scope, pending);
+    pending.pending = true;
+    pending.cpuStart = start;
+    glBeginQuery(GL_TIME_ELAPSED, pending.query);
+}
+
+void Profiler::end(ScopeHandle scope) {
+    if (scopes[scope].gpu) {
+        glEndQuery(GL_TIME_ELAPSED);
+    }
+
+    const double start = scopeStarts[scope];
+    const double duration = now() - start;
+    Scope& ended = scopes[scope];
+    ended.cpuMilliseconds = static_cast<float>(duration / 1e3);
+    ended.cpuHistory[frame % HISTORY_LENGTH] = ended.cpuMilliseconds;
+
+    if (tracing && traceEvents.size() < MAX_TRACE_EVENTS) {
+        traceEvents.push_back({ .scope = scope, .gpu = false, .start = start, .duration = duration });
+    }
+}
+
+void Profiler::endFrame() {
+    frame++;
+    if (tracing && traceEvents.size() >= MAX_TRACE_EVENTS) {
+        stopTrace();
+    }
+}
+
+void Profiler::startTrace() {
+    traceEvents.clear();
+    lastGpuEventEnd = 0.0;
+    tracing = true;
+}
+
+/**
+    GPU results of the last QUERY_LATENCY frames are not read back yet and are left out of the trace, so stopping
+    never waits for the GPU.
+*/
+void Profiler::stopTrace() {
+    tracing = false;
+}
+
+/**
+    Writes the recorded events in the Chrome trace event format, which chrome://tracing and https://ui.perfetto.dev
+    open. CPU and GPU scopes are shown as two threads of one process.
+*/
+bool Profiler::writeTrace(const std::filesystem::path& path) const {
+    std::ofstream output(path);
+    if (!output.is_open()) {
+        std::cerr << "Failed to open trace file " << path << "." << std::endl;
+        return false;
+    }
+
+    output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    output << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+    output << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+    for (const TraceEvent& event : traceEvents) {
+        // Scope names are chosen in code, so only quotes and backslashes need escaping
+        std::string name;
+        for (char c : scopes[event.scope].name) {
+            if (c == '"' || c == '\\') {
+                name += '\\';
+            }
+            name += c;
+        }
+        output << std::format(",\n{{\"name\":\"{0}\",\"cat\":\"{1}\",\"ph\":\"X\",\"pid\":1,\"tid\":{2},\"ts\":{3:.3f},\"dur\":{4:.3f}}}",
+            name, event.gpu ? "gpu" : "cpu", event.gpu ? 2 : 1, event.start, event.duration);
+    }
+    output << "\n]}\n";
+    return output.good();
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <chrono>
+#include <filesystem>
+
+#include "glCommon.h"
+
+/**
+	Named CPU and GPU timing scopes with a rolling history for graphs and an optional Chrome trace recording. A scope
+	is looked up once with getScope and then timed each frame between begin and end. GPU scopes wrap their commands in a
+	GL_TIME_ELAPSED query; each scope owns QUERY_LATENCY queries used in turn, so a result is read back QUERY_LATENCY
+	frames after it was issued. A result that is still not available by then is dropped rather than waited for, so the
+	profiler never stalls the pipeline. GPU scopes must not overlap, since only one elapsed time query can be active.
+
+	Elapsed time queries carry no timestamp, so in a trace each GPU event is placed at the later of the CPU time its
+	commands were submitted and the end of the previous GPU event.
+*/
+class Profiler {
+public:
+	typedef int ScopeHandle;
+	static const int QUERY_LATENCY = 3;
+	static const int HISTORY_LENGTH = 240;
+	// Recording stops by itself after this many trace events
+	static const size_t MAX_TRACE_EVENTS = 1000000;
+
+	typedef struct {
+		std::string name;
+		bool gpu;
+		// Times of the last HISTORY_LENGTH frames in milliseconds, indexed by frame % HISTORY_LENGTH. GPU times are stored
+		// in the frame their result was read back, QUERY_LATENCY frames after the commands were issued.
+		std::vector<float> cpuHistory;
+		std::vector<float> gpuHistory;
+		float cpuMilliseconds;
+		float gpuMilliseconds;
+		// Frame gpuMilliseconds was read back in, -1 before the first result
+		int gpuFrame;
+	} Scope;
+
+private:
+	typedef struct {
+		GLuint query;
+		bool pending;
+		// Submission time of the commands, in microseconds since the profiler was created
+		double cpuStart;
+	} PendingQuery;
+
+	typedef struct {
+		ScopeHandle scope;
+		bool gpu;
+		double start;
+		double duration;
+	} TraceEvent;
+
+	std::vector<Scope> scopes;
+	std::vector<std::vector<PendingQuery>> queries;
+	std::vector<double> scopeStarts;
+	std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	int frame = 0;
+	int droppedQueries = 0;
+
+	bool tracing = false;
+	std::vector<TraceEvent> traceEvents;
+	double lastGpuEventEnd = 0.0;
+
+public:
+	ScopeHandle getScope(const std::string& name, bool gpu);
+	void begin(ScopeHandle scope);
+	void end(ScopeHandle scope);
+	void endFrame();
+	const std::vector<Scope>& getScopes() const { return scopes; }
+	// Index of the oldest entry in the history arrays, for plotting them in order
+	int getHistoryOffset() const { return frame % HISTORY_LENGTH; }
+	int getFrame() const { return frame; }
+	int getDroppedQueries() const { return droppedQueries; }
+
+	void startTrace();
+	void stopTrace();
+	bool isTracing() const { return tracing; }
+	size_t getTraceEventCount() const { return traceEvents.size(); }
+	bool writeTrace(const std::filesystem::path& path) const;
+
+private:
+	double now() const;
+	void resolveQuery(ScopeHandle scope, PendingQuery& pending);
+};
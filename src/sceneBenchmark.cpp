@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sceneBenchmark.h"
+#include "engine.h"
+#include "offscreenContext.h"
+
+extern std::string executableDirectory;
+
+namespace SceneBenchmark {
+    typedef struct {
+        glm::vec3 position;
+        // Degrees, yaw keeps increasing so interpolation turns the same way
+        float yaw;
+        float pitch;
+    } CameraKey;
+
+    /**
+        Evenly spaced keys: an overview from the start position, a low pass over the water, grazing angles towards
+        the horizon, a steep view down onto the water, a dip below the surface and back to the start.
+    */
+    static const CameraKey CAMERA_PATH[] = {
+        { .position = glm::vec3(0.0f, 30.0f, 200.0f), .yaw = -90.0f, .pitch = -10.0f },
+        { .position = glm::vec3(0.0f, 6.0f, 100.0f), .yaw = -90.0f, .pitch = -5.0f },
+        { .position = glm::vec3(-80.0f, 3.0f, 40.0f), .yaw = -30.0f, .pitch = 0.0f },
+        { .position = glm::vec3(0.0f, 150.0f, -100.0f), .yaw = 90.0f, .pitch = -50.0f },
+        { .position = glm::vec3(20.0f, -12.0f, 60.0f), .yaw = 180.0f, .pitch = 15.0f },
+        { .position = glm::vec3(0.0f, 30.0f, 200.0f), .yaw = 270.0f, .pitch = -10.0f },
+    };
+    static const int CAMERA_KEY_COUNT = sizeof(CAMERA_PATH) / sizeof(CAMERA_PATH[0]);
+
+    // Position along the path from 0 to 1, eased in and out of every key
+    static CameraKey sampleCameraPath(float pathPosition) {
+        float segment = glm::clamp(pathPosition, 0.0f, 1.0f) * (CAMERA_KEY_COUNT - 1);
+        int index = std::min(static_cast<int>(segment), CAMERA_KEY_COUNT - 2);
+        float blend = glm::smoothstep(0.0f, 1.0f, segment - index);
+        const CameraKey& from = CAMERA_PATH[index];
+        const CameraKey& to = CAMERA_PATH[index + 1];
+        return {
+            .position = glm::mix(from.position, to.position, blend),
+            .yaw = glm::mix(from.yaw, to.yaw, blend),
+            .pitch = glm::mix(from.pitch, to.pitch, blend)
+        };
+    }
+
+    // Nearest rank percentile
+    static float percentile(const std::vector<float>& sorted, float fraction) {
+        if (sorted.empty()) {
+            return 0.0f;
+        }
+        size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+        return sorted[std::clamp(rank, size_t(1), sorted.size()) - 1];
+    }
+
+    typedef struct {
+        float mean;
+        float p50;
+        float p95;
+        float p99;
+        float max;
+    } Summary;
+
+    static Summary summarize(std::vector<float> values) {
+        std::sort(values.begin(), values.end());
+        double sum = 0.0;
+        for (float value : values) {
+            sum += value;
+        }
+        return {
+            .mean = values.empty() ? 0.0f : static_cast<float>(sum / values.size()),
+            .p50 = percentile(values, 0.50f),
+            .p95 = percentile(values, 0.95f),
+            .p99 = percentile(values, 0.99f),
+            .max = values.empty() ? 0.0f : values.back()
+        };
+    }
+
+    static std::string toJSON(const Summary& summary) {
+        return std::format("{{\"mean\":{0:.4f},\"p50\":{1:.4f},\"p95\":{2:.4f},\"p99\":{3:.4f},\"max\":{4:.4f}}}",
+            summary.mean, summary.p50, summary.p95, summary.p99, summary.max);
+    }
+
+    static std::string toJSON(const std::vector<float>& values) {
+        std::string array = "[";
+        for (size_t i = 0; i < values.size(); i++) {
+            // NaN marks a missing value
+            array += i > 0 ? "," : "";
+            array += std::isnan(values[i]) ? "null" : std::format("{0:.4f}", values[i]);
+        }
+        return array + "]";
+    }
+
+    static std::string quote(const std::string& text) {
+        std::string quoted = "\"";
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                quoted += '\\';
+            }
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    bool parseArguments(int argc, char** argv, Settings& settings) {
+        settings = {
+            .frames = 600,
+            .warmupFrames = 30,
+            .size = glm::ivec2(1280, 720),
+            .timeStep = 1.0f / 60.0f,
+            .outputPath = (std::filesystem::path(executableDirectory) / "benchmark.json").string()
+        };
+
+        bool found = false;
+        for (int i = 1; i < argc; i++) {
+            std::string argument = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (argument == "--benchmark") {
+                found = true;
+            } else if (argument == "--frames" && hasValue) {
+                settings.frames = std::max(std::atoi(argv[++i]), 1);
+            } else if (argument == "--warmup" && hasValue) {
+                settings.warmupFrames = std::max(std::atoi(argv[++i]), 0);
+            } else if (argument == "--size" && hasValue) {
+                int width, height;
+                if (sscanf(argv[++i], "%dx%d", &width, &height) == 2 && width > 0 && height > 0) {
+                    settings.size = glm::ivec2(width, height);
+                } else {
+                    std::cerr << "Ignoring invalid size " << argv[i] << ", expected WIDTHxHEIGHT" << std::endl;
+                }
+            } else if (argument == "--time-step" && hasValue) {
+                settings.timeStep = static_cast<float>(std::atof(argv[++i]));
+            } else if (argument == "--output" && hasValue) {
+                settings.outputPath = argv[++i];
+            }
+        }
+        return found;
+    }
+
+    /**
+        Each frame is finished with glFinish before the next one starts, so the frame time is the wall time of the whole
+        frame, and the CPU time is that minus the wait for the GPU. The GPU time of a frame is the sum of every GPU scope
+        it ran, the frame graph's passes and the wave bake. GPU times are read back Profiler::QUERY_LATENCY frames after
+        they were issued, so that many untimed frames are rendered at the end to collect the times of the last timed
+        frames. A frame with a GPU result the profiler dropped has no GPU time; it is left out of the GPU statistics and
+        written as null.
+    */
+    bool run(const Settings& settings) {
+        if (!OffscreenContext::create()) {
+            return false;
+        }
+        const std::string renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+        std::cout << "Renderer: " << renderer << std::endl;
+        std::cout << std::format("Rendering {0} frames at {1}x{2} after {3} warmup frames", settings.frames,
+            settings.size.x, settings.size.y, settings.warmupFrames) << std::endl;
+
+        auto engine = std::make_unique<Engine>();
+        engine->setupOffscreen(settings.size);
+        const Profiler& profiler = engine->getProfiler();
+
+        std::vector<float> times(settings.frames);
+        std::vector<float> frameMilliseconds(settings.frames);
+        std::vector<float> cpuMilliseconds(settings.frames);
+        std::vector<float> gpuMilliseconds(settings.frames);
+        // GPU times of the frames without dropped results, for the summary
+        std::vector<float> completeGpuMilliseconds;
+        int droppedGpuFrames = 0;
+        // Per profiler scope, only filled for GPU scopes
+        std::vector<std::vector<float>> scopeMilliseconds;
+
+        const int totalFrames = settings.warmupFrames + settings.frames + Profiler::QUERY_LATENCY;
+        for (int frame = 0; frame < totalFrames; frame++) {
+            const int timedFrame = frame - settings.warmupFrames;
+            const CameraKey key = sampleCameraPath(timedFrame / static_cast<float>(std::max(settings.frames - 1, 1)));
+            engine->camera.position = key.position;
+            engine->camera.setOrientation(key.yaw, key.pitch);
+            const float time = frame * settings.timeStep;
+
+            const int profilerFrame = profiler.getFrame();
+            const int droppedBefore = profiler.getDroppedQueries();
+            auto start = std::chrono::steady_clock::now();
+            engine->renderOffscreenFrame(time, settings.timeStep);
+            const float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            const std::vector<Profiler::Scope>& scopes = profiler.getScopes();
+            scopeMilliseconds.resize(scopes.size());
+            if (timedFrame >= 0 && timedFrame < settings.frames) {
+                float finishMilliseconds = 0.0f;
+                for (const Profiler::Scope& scope : scopes) {
+                    if (!scope.gpu && scope.name == "Present") {
+                        finishMilliseconds = scope.cpuMilliseconds;
+                    }
+                }
+                times[timedFrame] = time;
+                frameMilliseconds[timedFrame] = milliseconds;
+                cpuMilliseconds[timedFrame] = milliseconds - finishMilliseconds;
+            }
+
+            // Results read back during this frame belong to the frame QUERY_LATENCY frames earlier
+            const int gpuFrame = timedFrame - Profiler::QUERY_LATENCY;
+            if (gpuFrame >= 0 && gpuFrame < settings.frames) {
+                if (profiler.getDroppedQueries() > droppedBefore) {
+                    gpuMilliseconds[gpuFrame] = std::numeric_limits<float>::quiet_NaN();
+                    droppedGpuFrames++;
+                    continue;
+                }
+                for (int scope = 0; scope < scopes.size(); scope++) {
+                    if (scopes[scope].gpu && scopes[scope].gpuFrame == profilerFrame) {
+                        gpuMilliseconds[gpuFrame] += scopes[scope].gpuMilliseconds;
+                        scopeMilliseconds[scope].push_back(scopes[scope].gpuMilliseconds);
+                    }
+                }
+                completeGpuMilliseconds.push_back(gpuMilliseconds[gpuFrame]);
+            }
+        }
+
+        const std::vector<Profiler::Scope>& scopes = profiler.getScopes();
+        const Summary frameSummary = summarize(frameMilliseconds);
+        const Summary cpuSummary = summarize(cpuMilliseconds);
+        const Summary gpuSummary = summarize(completeGpuMilliseconds);
+        std::cout << std::format("{0:<16}{1:>10}{2:>10}{3:>10}{4:>10}", "ms", "mean", "p50", "p95", "p99") << std::endl;
+        auto printSummary = [](const std::string& name, const Summary& summary) {
+            std::cout << std::format("{0:<16}{1:>10.3f}{2:>10.3f}{3:>10.3f}{4:>10.3f}", name, summary.mean, summary.p50,
+                summary.p95, summary.p99) << std::endl;
+        };
+        printSummary("Frame", frameSummary);
+        printSummary("CPU", cpuSummary);
+        printSummary("GPU", gpuSummary);
+
+        std::string passes;
+        for (int scope = 0; scope < scopes.size(); scope++) {
+            if (!scopes[scope].gpu || scopeMilliseconds[scope].empty()) {
+                continue;
+            }
+            const Summary summary = summarize(scopeMilliseconds[scope]);
+            printSummary("  " + scopes[scope].name, summary);
+            passes += std::format("{0}{1}:{2}", passes.empty() ? "" : ",", quote(scopes[scope].name), toJSON(summary));
+        }
+        const int droppedQueries = profiler.getDroppedQueries();
+        if (droppedQueries > 0) {
+            std::cout << std::format("{0} GPU timings were not available in time and were dropped, {1} timed frames have no GPU time",
+                droppedQueries, droppedGpuFrames) << std::endl;
+        }
+
+        engine.reset();
+        OffscreenContext::destroy();
+
+        std::ofstream output(settings.outputPath);
+        if (!output.is_open()) {
+            std::cerr << "Failed to open benchmark output " << settings.outputPath << "." << std::endl;
+            return false;
+        }
+        output << "{\n";
+        output << std::format("\"renderer\":{0},\n\"frames\":{1},\n\"warmupFrames\":{2},\n\"width\":{3},\n\"height\":{4},\n\"timeStep\":{5},\n",
+            quote(renderer), settings.frames, settings.warmupFrames, settings.size.x, settings.size.y, settings.timeStep);
+        output << std::format("\"droppedQueries\":{0},\n\"droppedGpuFrames\":{1},\n", droppedQueries, droppedGpuFrames);
+        output << std::format("\"summary\":{{\"frameMilliseconds\":{0},\"cpuMilliseconds\":{1},\"gpuMilliseconds\":{2}}},\n",
+            toJSON(frameSummary), toJSON(cpuSummary), toJSON(gpuSummary));
+        output << "\"passes\":{" << passes << "},\n";
+        output << "\"perFrame\":{\n";
+        output << "\"time\":" << toJSON(times) << ",\n";
+        output << "\"frameMilliseconds\":" << toJSON(frameMilliseconds) << ",\n";
+        output << "\"cpuMilliseconds\":" << toJSON(cpuMilliseconds) << ",\n";
+        output << "\"gpuMilliseconds\":" << toJSON(gpuMilliseconds) << "\n";
+        output << "}\n}\n";
+        std::cout << "Wrote " << settings.outputPath << std::endl;
+        return output.good();
+    }
+}
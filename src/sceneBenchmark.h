@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <glm/glm.hpp>
+
+/**
+	Renders the full scene offscreen along a scripted camera path, for automated performance runs on machines without a
+	display or GPU. Selected with "ocean-gl --benchmark", optionally followed by:
+		--frames N        timed frames, default 600
+		--warmup N        untimed frames rendered first, default 30
+		--size WxH        framebuffer size, default 1280x720
+		--time-step S     simulated seconds between frames, default 1/60
+		--output PATH     JSON report, default benchmark.json next to the executable
+
+	The camera path and the simulated time depend only on the frame index, so every run renders the same frames. The
+	path is stretched over the timed frames, so runs of any length cover all of it.
+*/
+namespace SceneBenchmark {
+	typedef struct {
+		int frames;
+		int warmupFrames;
+		glm::ivec2 size;
+		float timeStep;
+		std::string outputPath;
+	} Settings;
+
+	// Returns false if --benchmark is not among the arguments
+	bool parseArguments(int argc, char** argv, Settings& settings);
+	bool run(const Settings& settings);
+}
@@ -1,7 +1,4 @@
 #include <iostream>
-#include <windows.h>
-#include <libloaderapi.h>
-#include <iostream>
 #include <fstream>
 #include <filesystem>
 #include <glm/gtc/type_ptr.hpp>
@@ -13,7 +10,7 @@ extern std::string executableDirectory;
 
 Shader::Shader() : id(-1), program(-1) {}
 
-void Shader::compileAndAttach(GLuint program, GLenum shaderType, const std::string& filename) {
+void Shader::compileAndAttach(GLuint program, GLenum shaderType, const std::string& filename, const std::vector<std::string>& defines) {
     this->program = program;
     std::filesystem::path path;
     path.append(executableDirectory);
@@ -33,11 +30,27 @@ void Shader::compileAndAttach(GLuint program, GLenum shaderType, const std::stri
     inputStream.seekg(0, inputStream.beg);
     std::vector<char> buffer(size);
     inputStream.read(buffer.data(), size);
-    const char* shaderSource = buffer.data();
+    // The buffer is not null terminated, and text mode reads may return fewer characters than the file size
+    std::string source(buffer.data(), static_cast<size_t>(inputStream.gcount()));
+    inputStream.close();
+
+    // The #version line must come first, so the defines go right after it. The #line directive keeps the line numbers
+    // in compile errors matching the file.
+    if (!defines.empty()) {
+        size_t versionEnd = source.find('\n', source.find("#version"));
+        versionEnd = versionEnd == std::string::npos ? source.size() : versionEnd + 1;
+        std::string defineLines;
+        for (const std::string& define : defines) {
+            defineLines += "#define " + define + "\n";
+        }
+        defineLines += "#line 2\n";
+        source.insert(versionEnd, defineLines);
+    }
+    const char* shaderSource = source.c_str();
+    const GLint sourceLength = static_cast<GLint>(source.size());
 
     id = glCreateShader(shaderType);
-    glShaderSource(id, 1, &shaderSource, 0);
-    inputStream.close();
+    glShaderSource(id, 1, &shaderSource, &sourceLength);
     glCompileShader(id);
 
     GLint success;
@@ -55,38 +68,77 @@ void Shader::compileAndAttach(GLuint program, GLenum shaderType, const std::stri
     glAttachShader(program, id);
 }
 
-void Shader::setUniformFloat(const std::string & name, float value) {
-    if (!attributeLocations.contains(name)) {
-        attributeLocations.emplace(name, glGetUniformLocation(program, name.c_str()));
+/**
+    Reads the name and location of every active uniform. Array uniforms are listed by the driver as "name[0]" and are
+    stored under their plain name, whose location is that of the first element.
+*/
+void Shader::reflectUniforms() {
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        return;
     }
-    glUniform1f(attributeLocations.at(name), value);
-}
 
-void Shader::setUniformFloatv(const std::string& name, int count, float* values) {
-    if (!attributeLocations.contains(name)) {
-        attributeLocations.emplace(name, glGetUniformLocation(program, name.c_str()));
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<char> name(maxNameLength + 1);
+    for (GLint i = 0; i < uniformCount; i++) {
+        GLsizei nameLength = 0;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(program, i, static_cast<GLsizei>(name.size()), &nameLength, &size, &type, name.data());
+        GLint location = glGetUniformLocation(program, name.data());
+
+        std::string_view uniformName(name.data(), nameLength);
+        if (uniformName.ends_with("[0]")) {
+            uniformName.remove_suffix(3);
+        }
+        uniformNames.emplace_back(uniformName);
+        uniformLocations.push_back(location);
     }
-    glUniform1fv(attributeLocations.at(name), count, values);
+    uniformsReflected = true;
 }
 
-void Shader::setUniformVec3(const std::string& name, glm::vec3 value) {
-    if (!attributeLocations.contains(name)) {
-        attributeLocations.emplace(name, glGetUniformLocation(program, name.c_str()));
+Shader::UniformHandle Shader::getUniform(std::string_view name) {
+    if (!uniformsReflected) {
+        reflectUniforms();
     }
-    glm::value_ptr(value);
-    glUniform3f(attributeLocations.at(name), value.x, value.y, value.z);
-}
 
-void Shader::setUniformMat4(const std::string& name, glm::mat4 mat) {
-    if (!attributeLocations.contains(name)) {
-        attributeLocations.emplace(name, glGetUniformLocation(program, name.c_str()));
+    for (size_t i = 0; i < uniformNames.size(); i++) {
+        if (uniformNames[i] == name) {
+            return static_cast<UniformHandle>(i);
+        }
     }
-    glUniformMatrix4fv(attributeLocations.at(name), 1, GL_FALSE, glm::value_ptr(mat));
+    return -1;
 }
 
-void Shader::setUniformInt(const std::string& name, int value) {
-    if (!attributeLocations.contains(name)) {
-        attributeLocations.emplace(name, glGetUniformLocation(program, name.c_str()));
-    }
-    glUniform1i(attributeLocations.at(name), value);
+void Shader::setUniformFloat(UniformHandle uniform, float value) {
+    glUniform1f(getLocation(uniform), value);
+}
+
+void Shader::setUniformFloatv(UniformHandle uniform, int count, float* values) {
+    glUniform1fv(getLocation(uniform), count, values);
+}
+
+void Shader::setUniformVec3(UniformHandle uniform, glm::vec3 value) {
+    glUniform3f(getLocation(uniform), value.x, value.y, value.z);
+}
+
+void Shader::setUniformVec4v(UniformHandle uniform, int count, float* values) {
+    glUniform4fv(getLocation(uniform), count, values);
+}
+
+void Shader::setUniformMat4(UniformHandle uniform, glm::mat4 mat) {
+    glUniformMatrix4fv(getLocation(uniform), 1, GL_FALSE, glm::value_ptr(mat));
+}
+
+void Shader::setUniformInt(UniformHandle uniform, int value) {
+    glUniform1i(getLocation(uniform), value);
+}
+
+void Shader::setUniformIntv(UniformHandle uniform, int count, int* values) {
+    glUniform1iv(getLocation(uniform), count, values);
 }
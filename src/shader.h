@@ -1,25 +1,49 @@
 #pragma once
 #include <string>
+#include <string_view>
+#include <vector>
 #include <glm/mat4x4.hpp>
-#include <map>
 
 #include "glCommon.h"
 
+/**
+	Uniforms are set through handles, indices into a flat table of the program's active uniform locations that is filled
+	by reflection the first time a uniform is looked up after the program is linked. Handles should be looked up once,
+	after linking, and kept; setting a uniform through a handle is then a single array index. The setters taking a name
+	look the handle up each call and are meant for setup code.
+*/
 class Shader {
 public:
 	GLuint id;
+	// Index into the uniform table, or -1 for a uniform that is not active in the program, which setters ignore
+	typedef int UniformHandle;
 private:
 	GLuint program;
-	std::map<std::string, GLint> attributeLocations;
+	bool uniformsReflected = false;
+	std::vector<std::string> uniformNames;
+	std::vector<GLint> uniformLocations;
 	
 public:
 	Shader();
-	void compileAndAttach(GLuint program, GLenum shaderType, const std::string& filename);
-	void setUniformFloat(const std::string& name, float value);
-	void setUniformFloatv(const std::string& name, int count, float *values);
-	void setUniformVec3(const std::string& name, glm::vec3 value);
-	void setUniformMat4(const std::string& name, glm::mat4 mat);
-	void setUniformInt(const std::string& name, int value);
+	// Each define, such as "WAVE_COUNT 20", is inserted as a #define line after the #version line of the source
+	void compileAndAttach(GLuint program, GLenum shaderType, const std::string& filename, const std::vector<std::string>& defines = {});
+	UniformHandle getUniform(std::string_view name);
+	void setUniformFloat(UniformHandle uniform, float value);
+	void setUniformFloatv(UniformHandle uniform, int count, float* values);
+	void setUniformVec3(UniformHandle uniform, glm::vec3 value);
+	void setUniformVec4v(UniformHandle uniform, int count, float* values);
+	void setUniformMat4(UniformHandle uniform, glm::mat4 mat);
+	void setUniformInt(UniformHandle uniform, int value);
+	void setUniformIntv(UniformHandle uniform, int count, int* values);
+	void setUniformFloat(std::string_view name, float value) { setUniformFloat(getUniform(name), value); }
+	void setUniformFloatv(std::string_view name, int count, float* values) { setUniformFloatv(getUniform(name), count, values); }
+	void setUniformVec3(std::string_view name, glm::vec3 value) { setUniformVec3(getUniform(name), value); }
+	void setUniformVec4v(std::string_view name, int count, float* values) { setUniformVec4v(getUniform(name), count, values); }
+	void setUniformMat4(std::string_view name, glm::mat4 mat) { setUniformMat4(getUniform(name), mat); }
+	void setUniformInt(std::string_view name, int value) { setUniformInt(getUniform(name), value); }
+	void setUniformIntv(std::string_view name, int count, int* values) { setUniformIntv(getUniform(name), count, values); }
 private:
 	void compile(GLenum shaderType, const std::string& filename);
+	void reflectUniforms();
+	GLint getLocation(UniformHandle uniform) const { return uniform < 0 ? -1 : uniformLocations[uniform]; }
 };
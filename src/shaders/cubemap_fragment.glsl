@@ -2,7 +2,15 @@
 
 in vec3 textureCoordinate;
 out vec4 outColor;
-uniform int underwaterFlag;
+// Per-frame data shared by every program, see UniformBuffers::FrameData
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPosition;
+    float time;
+    int underwaterFlag;
+    vec2 viewportSize;
+};
 uniform samplerCube cubemap;
 
 vec3 horizonColors[2] = vec3[2](
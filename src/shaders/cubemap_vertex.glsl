@@ -2,10 +2,18 @@
 
 in vec3 vertexPosition;
 out vec3 textureCoordinate;
-uniform mat4 projection;
-uniform mat4 view;
+// Per-frame data shared by every program, see UniformBuffers::FrameData
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPosition;
+    float time;
+    int underwaterFlag;
+    vec2 viewportSize;
+};
 
 void main() {
     textureCoordinate = vertexPosition;
-    gl_Position = projection * view * vec4(vertexPosition * 100, 1.0);
+    // The translation is removed so the cube stays centered on the camera
+    gl_Position = projection * mat4(mat3(view)) * vec4(vertexPosition * 100, 1.0);
 }
@@ -0,0 +1,36 @@
+#version 410 core
+
+in vec3 vertexPosition;
+in vec3 textureCoordinate;
+in vec3 vertexNormal;
+in mat4 instanceModel;
+out vec3 normal;
+// Per-frame data shared by every program, see UniformBuffers::FrameData
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPosition;
+    float time;
+    int underwaterFlag;
+    vec2 viewportSize;
+};
+// Decoding of quantized vertices, see VertexFormat. Float vertices use a zero offset and unit scale.
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform bool octahedralNormals;
+
+vec3 decodeNormal(vec3 encoded) {
+    if (!octahedralNormals) {
+        return encoded;
+    }
+    vec3 n = vec3(encoded.xy, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (n.z < 0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0 ? 1 : -1, n.y >= 0 ? 1 : -1);
+    }
+    return normalize(n);
+}
+
+void main() {
+	gl_Position = projection * view * instanceModel * vec4(positionOffset + positionScale * vertexPosition, 1.0);
+    normal = normalize(mat3(transpose(inverse(instanceModel))) * decodeNormal(vertexNormal));
+};
@@ -4,12 +4,33 @@ in vec3 vertexPosition;
 in vec3 textureCoordinate;
 in vec3 vertexNormal;
 out vec3 normal;
-uniform mat4 view;
-uniform mat4 projection;
+// Per-frame data shared by every program, see UniformBuffers::FrameData
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPosition;
+    float time;
+    int underwaterFlag;
+    vec2 viewportSize;
+};
 uniform mat4 model;
-uniform float time;
+// Decoding of quantized vertices, see VertexFormat. Float vertices use a zero offset and unit scale.
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform bool octahedralNormals;
+
+vec3 decodeNormal(vec3 encoded) {
+    if (!octahedralNormals) {
+        return encoded;
+    }
+    vec3 n = vec3(encoded.xy, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (n.z < 0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0 ? 1 : -1, n.y >= 0 ? 1 : -1);
+    }
+    return normalize(n);
+}
 
 void main() {
-	gl_Position = projection * view * model * vec4(vertexPosition, 1.0);
-    normal = normalize(mat3(transpose(inverse(model))) * vertexNormal);
+	gl_Position = projection * view * model * vec4(positionOffset + positionScale * vertexPosition, 1.0);
+    normal = normalize(mat3(transpose(inverse(model))) * decodeNormal(vertexNormal));
 };
@@ -0,0 +1,69 @@
+#version 410 core
+
+// Per-frame data shared by every program, see UniformBuffers::FrameData
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPosition;
+    float time;
+    int underwaterFlag;
+    vec2 viewportSize;
+};
+// See water_tess_eval.glsl
+layout (std140) uniform WaveUniforms {
+    float maxWaveDisplacement;
+    vec4 waves[WAVE_COUNT * 2];
+};
+// World space size of the baked window and texels along each of its sides
+uniform float bakeWindowSize;
+uniform float bakeResolution;
+
+layout (location = 0) out vec4 bakedDisplacement;
+layout (location = 1) out vec4 bakedNormal;
+
+
+vec3 accumulateGerstnerWave(vec3 vertexPosition, vec4 waveA, vec4 waveB, inout vec3 tangent, inout vec3 binormal) {
+	vec2 direction = waveA.xy;
+	float amplitude = waveB.x;
+	float steepness = waveB.y;
+
+	float f = waveA.z * dot(direction, vertexPosition.xz) - waveA.w * time;
+	float sinF = sin(f);
+	float cosF = cos(f);
+
+	tangent += vec3(
+		-direction.x * direction.x * steepness * sinF,
+		direction.x * steepness * cosF,
+		-direction.x * direction.y * steepness * sinF
+	);
+
+	binormal += vec3(
+		-direction.x * direction.y * steepness * sinF,
+		direction.y * steepness * cosF,
+		-direction.y * direction.y * steepness * sinF
+	);
+
+	return vec3(
+		direction.x * (amplitude * cosF),
+		amplitude * sinF,
+		direction.y * (amplitude * cosF)
+	);
+}
+
+void main() {
+	// The texture wraps around, each texel holds the copy of its location nearest the camera. Texel centers are at
+	// (texel + 0.5) / resolution * bakeWindowSize plus a whole number of windows, so they stay fixed in world space.
+	vec2 location = gl_FragCoord.xy / bakeResolution * bakeWindowSize;
+	location += bakeWindowSize * round((cameraPosition.xz - location) / bakeWindowSize);
+
+	vec3 position = vec3(location.x, 0.0, location.y);
+	vec3 displacement = vec3(0.0);
+	vec3 tangent = vec3(1.0, 0.0, 0.0);
+	vec3 binormal = vec3(0.0, 0.0, 1.0);
+	for (int i = 0; i < WAVE_COUNT * 2; i += 2) {
+		displacement += accumulateGerstnerWave(position, waves[i], waves[i + 1], tangent, binormal);
+	}
+
+	bakedDisplacement = vec4(displacement, 0.0);
+	bakedNormal = vec4(normalize(cross(binormal, tangent)), 0.0);
+}
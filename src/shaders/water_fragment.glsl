@@ -2,10 +2,33 @@
 
 in vec3 normal;
 in vec3 fragmentPosition;
+in vec2 surfaceLocation;
 out vec4 outColor;
-uniform int underwaterFlag;
-uniform vec3 cameraPosition;
+// Per-frame data shared by every program, see UniformBuffers::FrameData
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPosition;
+    float time;
+    int underwaterFlag;
+    vec2 viewportSize;
+};
 uniform samplerCube cubemap;
+// FFT ocean cascades, see water_tess_eval.glsl. The derivatives hold the x and z slopes, d(x)/dx and d(z)/dz, and
+// the displacement d(x)/dz in its fourth component.
+uniform bool fftOcean;
+uniform int oceanCascadeCount;
+uniform sampler2D oceanDisplacements[4];
+uniform sampler2D oceanDerivatives[4];
+uniform float oceanTileSizes[4];
+
+// Adds the derivatives of one cascade, see sampleOceanCascade in water_tess_eval.glsl
+void addOceanCascade(sampler2D displacements, sampler2D derivatives, float tileSize, inout vec4 derivativeSum, inout float derivativeXZ) {
+    float resolution = float(textureSize(derivatives, 0).x);
+    vec2 coordinate = surfaceLocation / tileSize + 0.5 / resolution;
+    derivativeSum += texture(derivatives, coordinate);
+    derivativeXZ += texture(displacements, coordinate).w;
+}
 
 vec3 lightPosition = vec3(6.0, 10.0, -10.0);
 vec3 baseColor = vec3(0.1, 0.5, 0.7);
@@ -16,6 +39,30 @@ float fogDistances[2] = float[2](4000, 1000);
 float fogFactorMinimums[2] = float[2](0, 0.6);
 
 void main() {
+    vec3 surfaceNormal = normal;
+    float foam = 0.0;
+    if (fftOcean) {
+        vec4 derivatives = vec4(0.0);
+        float derivativeXZ = 0.0;
+        addOceanCascade(oceanDisplacements[0], oceanDerivatives[0], oceanTileSizes[0], derivatives, derivativeXZ);
+        if (oceanCascadeCount > 1) {
+            addOceanCascade(oceanDisplacements[1], oceanDerivatives[1], oceanTileSizes[1], derivatives, derivativeXZ);
+        }
+        if (oceanCascadeCount > 2) {
+            addOceanCascade(oceanDisplacements[2], oceanDerivatives[2], oceanTileSizes[2], derivatives, derivativeXZ);
+        }
+        if (oceanCascadeCount > 3) {
+            addOceanCascade(oceanDisplacements[3], oceanDerivatives[3], oceanTileSizes[3], derivatives, derivativeXZ);
+        }
+        vec3 tangent = vec3(1.0 + derivatives.z, derivatives.x, derivativeXZ);
+        vec3 binormal = vec3(derivativeXZ, derivatives.y, 1.0 + derivatives.w);
+        surfaceNormal = normalize(cross(binormal, tangent));
+        // The Jacobian determinant of the horizontal displacement falls from 1 where crests are squeezed together,
+        // reaching 0 where the surface folds over
+        float jacobian = (1.0 + derivatives.z) * (1.0 + derivatives.w) - derivativeXZ * derivativeXZ;
+        foam = 1.0 - smoothstep(0.3, 0.7, jacobian);
+    }
+
     vec3 shallowColor = vec3(0.098, 0.890, 0.772);
     vec3 deepColor = vec3(0.078, 0.447, 0.549);
     int minHeight = -37;
@@ -32,19 +79,20 @@ void main() {
 
     vec3 lightDirection = normalize(lightPosition - fragmentPosition);
     vec3 viewDirection = normalize(cameraPosition - fragmentPosition);
-    vec3 reflectDirection = reflect(-lightDirection, normal);
-    float diffuse = max(dot(normal, lightDirection), 0.0) * 0.05;
+    vec3 reflectDirection = reflect(-lightDirection, surfaceNormal);
+    float diffuse = max(dot(surfaceNormal, lightDirection), 0.0) * 0.05;
     vec3 specular = specularStrength * pow(max(dot(viewDirection, reflectDirection), 0.0), 32) * vec3(1.0, 1.0, 1.0);
     color = (ambient + diffuse + specular) * color;
 
-    vec3 reflectedViewDirection = reflect(-viewDirection, normalize(normal));
+    vec3 reflectedViewDirection = reflect(-viewDirection, normalize(surfaceNormal));
     // TODO: why is the reflection direction y sometimes negative? Normals are all pointing in y+.
     reflectedViewDirection.y = abs(reflectedViewDirection.y);
 
     vec3 skyReflectionColor = texture(cubemap, reflectedViewDirection).rgb;
-    float fresnel = pow(1 - max(0, dot(normal, reflectedViewDirection)), 5);
+    float fresnel = pow(1 - max(0, dot(surfaceNormal, reflectedViewDirection)), 5);
 
     color = mix(color, skyReflectionColor, fresnel);
+    color = mix(color, vec3(1.0), foam * 0.8);
 
     float maxFogDistance = fogDistances[underwaterFlag];
     float cameraDistance = min(distance(cameraPosition, fragmentPosition), maxFogDistance);
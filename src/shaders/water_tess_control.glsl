@@ -1,27 +1,116 @@
 #version 410 core
 
 layout (vertices=4) out; // 4 control points per patch
-uniform vec3 cameraPosition;
+// Per-frame data shared by every program, see UniformBuffers::FrameData
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPosition;
+    float time;
+    int underwaterFlag;
+    vec2 viewportSize;
+};
+// See water_tess_eval.glsl, only the displacement bound is used here
+layout (std140) uniform WaveUniforms {
+    float maxWaveDisplacement;
+    vec4 waves[WAVE_COUNT * 2];
+};
+
+uniform bool frustumCulling;
+// See water_tess_eval.glsl, the FFT ocean replaces the waves above and bounds its displacement with this instead
+uniform bool fftOcean;
+uniform float oceanMaxDisplacement;
+// Target length in pixels of the tessellated triangle edges
+uniform float triangleSize;
+
+in float vertexPatchSize[];
+flat in int vertexCoarserEdges[];
+
+// True if the box lies entirely on the outer side of one of the six clip planes
+bool outsideFrustum(vec3 boxMin, vec3 boxMax) {
+    mat4 viewProjection = projection * view;
+    vec3 below = vec3(0);
+    vec3 above = vec3(0);
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = mix(boxMin, boxMax, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+        vec4 clip = viewProjection * vec4(corner, 1.0);
+        below += vec3(lessThan(clip.xyz, vec3(-clip.w)));
+        above += vec3(greaterThan(clip.xyz, vec3(clip.w)));
+    }
+    return any(equal(below, vec3(8))) || any(equal(above, vec3(8)));
+}
+
+/**
+    An even level that depends only on the two end points, so both patches sharing an edge agree on it. The edge is
+    measured as the screen space diameter of the sphere around it rather than by projecting its end points, which
+    would shrink edges seen at grazing angles, where the waves stand up from the flat patch and need the detail most.
+    The level splits that diameter into triangles of about triangleSize pixels.
+*/
+float edgeTessLevel(vec3 a, vec3 b) {
+    const float maxTessLevel = 64;
+
+    vec4 center = view * vec4((a + b) * 0.5, 1.0);
+    // Depth in front of the camera, kept away from zero for edges passing beside or behind it
+    float depth = max(-center.z, distance(a, b) * 0.5);
+    float diameterPixels = distance(a, b) * projection[1][1] / depth * viewportSize.y * 0.5;
+    return 2.0 * ceil(clamp(diameterPixels / triangleSize, 1.0, maxTessLevel) / 2.0);
+}
+
+/**
+    Level of an edge of a patch of the given size, outward points from the patch towards the neighbor across the edge.
+    An edge bordering a patch twice as large gets half the level of the larger patch's edge, which lies on the grid of
+    twice the size, so its vertices are every other vertex of that edge. The larger patch's corners are placed as
+    water_vertex.glsl places them and passed in the order that patch passes them, so both sides get the same level.
+*/
+float edgeTessLevel(vec3 a, vec3 b, vec3 outward, float size, bool coarserNeighbor) {
+    if (!coarserNeighbor) {
+        return edgeTessLevel(a, b);
+    }
+    float coarseSize = 2.0 * size;
+    // Half a patch into the neighbor, far enough from its sides that rounding cannot pick the wrong grid cell
+    vec2 inside = (a.xz + b.xz) * 0.5 + outward.xz * (size * 0.5);
+    vec2 origin = floor(inside / coarseSize) * coarseSize;
+    // Unit corners of the neighbor's side facing this patch, from its lower to its upper end
+    vec2 lower = max(-outward.xz, 0.0);
+    vec2 upper = lower + (1.0 - abs(outward.xz));
+    vec3 coarseA = vec3(origin.x + lower.x * coarseSize, 0.0, origin.y + lower.y * coarseSize);
+    vec3 coarseB = vec3(origin.x + upper.x * coarseSize, 0.0, origin.y + upper.y * coarseSize);
+    return edgeTessLevel(coarseA, coarseB) / 2.0;
+}
 
 void main() {
     gl_out[gl_InvocationID].gl_Position = gl_in[gl_InvocationID].gl_Position;
 
     if (gl_InvocationID == 0) {
-        const float minDistance = 10;
-        const float maxDistance = 2000;
-
-        float distance00 = clamp(distance(gl_in[0].gl_Position.xyz, cameraPosition), minDistance, maxDistance) / (maxDistance - minDistance);
-        float distance01 = clamp(distance(gl_in[1].gl_Position.xyz, cameraPosition), minDistance, maxDistance) / (maxDistance - minDistance);
-        float distance10 = clamp(distance(gl_in[2].gl_Position.xyz, cameraPosition), minDistance, maxDistance) / (maxDistance - minDistance);
-        float distance11 = clamp(distance(gl_in[3].gl_Position.xyz, cameraPosition), minDistance, maxDistance) / (maxDistance - minDistance);
+        // The waves can move the surface by up to maxWaveDisplacement along every axis, so the flat patch is grown by that
+        // much before testing. A patch with zero outer tessellation levels is discarded before the eval shader runs.
+        if (frustumCulling) {
+            float displacement = fftOcean ? oceanMaxDisplacement : maxWaveDisplacement;
+            vec3 patchMin = min(min(gl_in[0].gl_Position.xyz, gl_in[1].gl_Position.xyz), min(gl_in[2].gl_Position.xyz, gl_in[3].gl_Position.xyz));
+            vec3 patchMax = max(max(gl_in[0].gl_Position.xyz, gl_in[1].gl_Position.xyz), max(gl_in[2].gl_Position.xyz, gl_in[3].gl_Position.xyz));
+            if (outsideFrustum(patchMin - displacement, patchMax + displacement)) {
+                gl_TessLevelOuter[0] = 0;
+                gl_TessLevelOuter[1] = 0;
+                gl_TessLevelOuter[2] = 0;
+                gl_TessLevelOuter[3] = 0;
+                gl_TessLevelInner[0] = 0;
+                gl_TessLevelInner[1] = 0;
+                return;
+            }
+        }
 
-        const float minTessLevel = 7;
-        const float maxTessLevel = 75;
+        // Edges in the order of WaterGrid::Patch::coarserEdges
+        vec3 p00 = gl_in[0].gl_Position.xyz;
+        vec3 p01 = gl_in[1].gl_Position.xyz;
+        vec3 p10 = gl_in[2].gl_Position.xyz;
+        vec3 p11 = gl_in[3].gl_Position.xyz;
+        float size = vertexPatchSize[0];
+        int coarserEdges = vertexCoarserEdges[0];
 
-        float tessLevel0 = floor(mix(maxTessLevel, minTessLevel, min(distance00, distance10)) / 2.0) + 1;
-        float tessLevel1 = floor(mix(maxTessLevel, minTessLevel, min(distance00, distance01)) / 2.0) + 1;
-        float tessLevel2 = floor(mix(maxTessLevel, minTessLevel, min(distance01, distance11)) / 2.0) + 1;
-        float tessLevel3 = floor(mix(maxTessLevel, minTessLevel, min(distance10, distance11)) / 2.0) + 1;
+        float tessLevel0 = edgeTessLevel(p00, p10, vec3(-1, 0, 0), size, (coarserEdges & 1) != 0);
+        float tessLevel1 = edgeTessLevel(p00, p01, vec3(0, 0, -1), size, (coarserEdges & 2) != 0);
+        float tessLevel2 = edgeTessLevel(p01, p11, vec3(1, 0, 0), size, (coarserEdges & 4) != 0);
+        float tessLevel3 = edgeTessLevel(p10, p11, vec3(0, 0, 1), size, (coarserEdges & 8) != 0);
 
         gl_TessLevelOuter[0] = tessLevel0;
         gl_TessLevelOuter[1] = tessLevel1;
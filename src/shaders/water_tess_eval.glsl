@@ -1,44 +1,79 @@
 #version 410 core
 
-layout (quads, fractional_odd_spacing, ccw) in;
+// Integer levels with equal spacing, so an edge at half the level of a larger neighbor matches its vertices
+layout (quads, equal_spacing, ccw) in;
 
 out vec3 fragmentPosition;
 out vec3 normal;
-uniform float time;
-uniform mat4 view;
-uniform mat4 projection;
-uniform float waves[20 * 4];
+// Undisplaced location on the water plane, where the fragment shader looks up the FFT ocean derivatives
+out vec2 surfaceLocation;
+// Per-frame data shared by every program, see UniformBuffers::FrameData
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPosition;
+    float time;
+    int underwaterFlag;
+    vec2 viewportSize;
+};
+// Two vec4s per wave, precomputed by Water::setWaveParameters:
+// (direction.x, direction.y, k, angular speed) and (amplitude, steepness, unused, unused)
+// WAVE_COUNT is defined by Water when it compiles the program, so the wave loop below has a constant trip count
+layout (std140) uniform WaveUniforms {
+    float maxWaveDisplacement;
+    vec4 waves[WAVE_COUNT * 2];
+};
+// FFT ocean, see OceanCascades. When set, the displacement is the sum of these periodic tiles of different sizes
+// instead of the waves above, and the normal is looked up per fragment.
+uniform bool fftOcean;
+uniform int oceanCascadeCount;
+uniform sampler2D oceanDisplacements[4];
+uniform float oceanTileSizes[4];
+// Gerstner waves baked around the camera by water_bake_fragment.glsl, see Water::bakeWaves. When set, vertices inside
+// the baked window look the waves up instead of summing them.
+uniform bool bakedWaves;
+uniform sampler2D bakedDisplacement;
+uniform sampler2D bakedNormal;
+uniform float bakeWindowSize;
+// See water_tess_control.glsl
+uniform float triangleSize;
 
 
-vec3 accumulateGerstnerWave(vec3 vertexPosition, vec2 direction, float steepness, float wavelength, inout vec3 tangent, inout vec3 binormal) {
-	direction = normalize(direction);
-    const float PI = 3.1415926535897932384626433832795;
+vec3 accumulateGerstnerWave(vec3 vertexPosition, vec4 waveA, vec4 waveB, inout vec3 tangent, inout vec3 binormal) {
+	vec2 direction = waveA.xy;
+	float amplitude = waveB.x;
+	float steepness = waveB.y;
 
-	float speed = 3;
-	float k = 2 * PI / wavelength;
-	float c = sqrt(9.81 / k);
-	float f = k * (dot(direction, vertexPosition.xz) - c * time * speed);
-	float a = steepness / k;
+	float f = waveA.z * dot(direction, vertexPosition.xz) - waveA.w * time;
+	float sinF = sin(f);
+	float cosF = cos(f);
 
 	tangent += vec3(
-		-direction.x * direction.x * steepness * sin(f),
-		direction.x * steepness * cos(f),
-		-direction.x * direction.y * steepness * sin(f)
+		-direction.x * direction.x * steepness * sinF,
+		direction.x * steepness * cosF,
+		-direction.x * direction.y * steepness * sinF
 	);
 
 	binormal += vec3(
-		-direction.x * direction.y * steepness * sin(f),
-		direction.y * steepness * cos(f),
-		-direction.y * direction.y * steepness * sin(f)
+		-direction.x * direction.y * steepness * sinF,
+		direction.y * steepness * cosF,
+		-direction.y * direction.y * steepness * sinF
 	);
 
 	return vec3(
-		direction.x * (a * cos(f)),
-		a * sin(f),
-		direction.y * (a * cos(f))
+		direction.x * (amplitude * cosF),
+		amplitude * sinF,
+		direction.y * (amplitude * cosF)
 	);
 }
 
+// Texel centers sit on the grid nodes of the tile. The mip level has texels about as wide as the given vertex spacing.
+vec3 sampleOceanCascade(sampler2D displacements, float tileSize, vec2 location, float vertexSpacing) {
+	float resolution = float(textureSize(displacements, 0).x);
+	float lod = max(log2(vertexSpacing * resolution / tileSize), 0.0);
+	return textureLod(displacements, location / tileSize + 0.5 / resolution, lod).xyz;
+}
+
 void main() {
     // Control points of patch
     vec4 p00 = gl_in[0].gl_Position;
@@ -53,18 +88,51 @@ void main() {
 
     // Apply wave function to get position and normal
     vec3 position = vec3(p);
-	vec3 tangent = vec3(1.0, 0.0, 0.0);
-	vec3 binormal = vec3(0.0, 0.0, 1.0);
 
-	const int numWaves = 20;
-	for (int i = 0; i < numWaves * 4; i += 4) {
-		vec2 direction = vec2(waves[i], waves[i + 1]);
-		float steepness = waves[i + 2];
-		float wavelength = waves[i + 3];
-		position += accumulateGerstnerWave(p.xyz, direction, steepness, wavelength, tangent, binormal);
+	surfaceLocation = p.xz;
+	// The vertex spacing is the one the tessellation aims for at this distance. Texture lookups use mip levels with
+	// texels about as wide, so waves shorter than the mesh can show are averaged out instead of aliasing. It depends
+	// only on the location, so patches sharing an edge displace its vertices the same way.
+	float vertexSpacing = triangleSize * 2.0 * distance(p.xyz, cameraPosition) / (projection[1][1] * viewportSize.y);
+	if (fftOcean) {
+		// Small cascades fade out in the distance. The cascades are indexed with constants, which every driver
+		// handles, rather than in a loop.
+		position += sampleOceanCascade(oceanDisplacements[0], oceanTileSizes[0], p.xz, vertexSpacing);
+		if (oceanCascadeCount > 1) {
+			position += sampleOceanCascade(oceanDisplacements[1], oceanTileSizes[1], p.xz, vertexSpacing);
+		}
+		if (oceanCascadeCount > 2) {
+			position += sampleOceanCascade(oceanDisplacements[2], oceanTileSizes[2], p.xz, vertexSpacing);
+		}
+		if (oceanCascadeCount > 3) {
+			position += sampleOceanCascade(oceanDisplacements[3], oceanTileSizes[3], p.xz, vertexSpacing);
+		}
+		normal = vec3(0.0, 1.0, 0.0);
+	} else {
+		bool baked = false;
+		if (bakedWaves) {
+			// The window wraps around at its edges, where texels of coarser levels mix values from both sides, so
+			// vertices closer to an edge than two texels of their level sum the waves instead
+			float texelSize = bakeWindowSize / float(textureSize(bakedDisplacement, 0).x);
+			float lod = max(log2(vertexSpacing / texelSize), 0.0);
+			vec2 offset = abs(p.xz - cameraPosition.xz);
+			baked = max(offset.x, offset.y) < 0.5 * bakeWindowSize - 2.0 * texelSize * exp2(ceil(lod));
+			if (baked) {
+				vec2 coordinate = p.xz / bakeWindowSize;
+				position += textureLod(bakedDisplacement, coordinate, lod).xyz;
+				normal = normalize(textureLod(bakedNormal, coordinate, lod).xyz);
+			}
+		}
+		if (!baked) {
+			vec3 tangent = vec3(1.0, 0.0, 0.0);
+			vec3 binormal = vec3(0.0, 0.0, 1.0);
+			for (int i = 0; i < WAVE_COUNT * 2; i += 2) {
+				position += accumulateGerstnerWave(p.xyz, waves[i], waves[i + 1], tangent, binormal);
+			}
+			normal = normalize(cross(binormal, tangent));
+		}
 	}
 
 	gl_Position = projection * view * vec4(position, 1.0);
-	normal = normalize(cross(binormal, tangent));
 	fragmentPosition = position;
 }
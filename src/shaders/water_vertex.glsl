@@ -1,7 +1,15 @@
 #version 410 core
 
+// Corner of the unit patch
 in vec3 vertexPosition;
+// Per patch, see WaterGrid::Patch: origin.x, origin.z, size and the mask of edges bordering a larger patch
+in vec4 patchInstance;
+
+out float vertexPatchSize;
+flat out int vertexCoarserEdges;
 
 void main() {
-	gl_Position = vec4(vertexPosition, 1.0);
+	gl_Position = vec4(patchInstance.x + vertexPosition.x * patchInstance.z, 0.0, patchInstance.y + vertexPosition.z * patchInstance.z, 1.0);
+	vertexPatchSize = patchInstance.z;
+	vertexCoarserEdges = int(patchInstance.w);
 };
@@ -0,0 +1,36 @@
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "simd.h"
+
+static bool cpuSupportsAvx2() {
+#if defined(_MSC_VER) && defined(_M_X64)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!fma || !osxsave || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+bool SIMD::hasAvx2() {
+#ifdef SIMD_AVX2_AVAILABLE
+    static const bool avx2 = cpuSupportsAvx2();
+    return avx2;
+#else
+    return false;
+#endif
+}
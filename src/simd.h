@@ -0,0 +1,90 @@
+#pragma once
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+#define SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+// Only translation units compiled with AVX2 code generation see the AVX2 lanes, see CMakeLists.txt
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/**
+    Lanes types of the SIMD kernels, shared by the wave sampler (waveKernel.h) and the FFT column butterflies
+    (fftKernel.h). Each instruction set provides the handful of arithmetic operations the kernels use on a register of
+    width floats, so a kernel is written once as a template and instantiated per instruction set.
+*/
+namespace SIMD {
+    struct ScalarLanes {
+        typedef float Type;
+        static const int width = 1;
+        static Type set(float value) { return value; }
+        static Type load(const float* values) { return *values; }
+        static void store(float* values, Type v) { *values = v; }
+        static Type add(Type a, Type b) { return a + b; }
+        static Type sub(Type a, Type b) { return a - b; }
+        static Type mul(Type a, Type b) { return a * b; }
+        static Type mulAdd(Type a, Type b, Type c) { return a * b + c; }
+        static Type floor(Type v) { return std::floor(v); }
+        static Type div(Type a, Type b) { return a / b; }
+        static Type sqrt(Type v) { return std::sqrt(v); }
+        static Type inverseSqrt(Type v) { return 1.0f / std::sqrt(v); }
+        typedef bool Mask;
+        static Mask less(Type a, Type b) { return a < b; }
+        static Type select(Mask mask, Type a, Type b) { return mask ? a : b; }
+        static bool allLess(Type a, Type b) { return a < b; }
+    };
+
+#ifdef SIMD_SSE2
+    struct Sse2Lanes {
+        typedef __m128 Type;
+        static const int width = 4;
+        static Type set(float value) { return _mm_set1_ps(value); }
+        static Type load(const float* values) { return _mm_loadu_ps(values); }
+        static void store(float* values, Type v) { _mm_storeu_ps(values, v); }
+        static Type add(Type a, Type b) { return _mm_add_ps(a, b); }
+        static Type sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+        static Type mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+        static Type mulAdd(Type a, Type b, Type c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+        static Type div(Type a, Type b) { return _mm_div_ps(a, b); }
+        static Type sqrt(Type v) { return _mm_sqrt_ps(v); }
+        static Type inverseSqrt(Type v) { return _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(v)); }
+        typedef __m128 Mask;
+        static Mask less(Type a, Type b) { return _mm_cmplt_ps(a, b); }
+        static Type select(Mask mask, Type a, Type b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+        static bool allLess(Type a, Type b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)) == 0xF; }
+        // SSE2 has no floor instruction, so truncate and correct the lanes that were rounded up
+        static Type floor(Type v) {
+            Type truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+            return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, v), _mm_set1_ps(1.0f)));
+        }
+    };
+#endif
+
+#if defined(__AVX2__)
+    struct Avx2Lanes {
+        typedef __m256 Type;
+        static const int width = 8;
+        static Type set(float value) { return _mm256_set1_ps(value); }
+        static Type load(const float* values) { return _mm256_loadu_ps(values); }
+        static void store(float* values, Type v) { _mm256_storeu_ps(values, v); }
+        static Type add(Type a, Type b) { return _mm256_add_ps(a, b); }
+        static Type sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+        static Type mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+        static Type mulAdd(Type a, Type b, Type c) { return _mm256_fmadd_ps(a, b, c); }
+        static Type floor(Type v) { return _mm256_floor_ps(v); }
+        static Type div(Type a, Type b) { return _mm256_div_ps(a, b); }
+        static Type sqrt(Type v) { return _mm256_sqrt_ps(v); }
+        static Type inverseSqrt(Type v) { return _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(v)); }
+        typedef __m256 Mask;
+        static Mask less(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static Type select(Mask mask, Type a, Type b) { return _mm256_blendv_ps(b, a, mask); }
+        static bool allLess(Type a, Type b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ)) == 0xFF; }
+    };
+#endif
+
+    // Whether the AVX2 kernels were compiled in and this CPU and OS support AVX2 and FMA, checked once
+    bool hasAvx2();
+}
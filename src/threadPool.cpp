@@ -0,0 +1,94 @@
+#include <algorithm>
+
+#include "threadPool.h"
+
+ThreadPool& ThreadPool::getShared() {
+    static ThreadPool pool;
+    static std::once_flag started;
+    std::call_once(started, [] { pool.init(0); });
+    return pool;
+}
+
+ThreadPool::~ThreadPool() {
+    shutdown();
+}
+
+void ThreadPool::init(int threadCount) {
+    shutdown();
+    if (threadCount <= 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    stopping = false;
+    for (int i = 0; i < threadCount - 1; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, generation);
+    }
+}
+
+void ThreadPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void ThreadPool::runTasks(int taskCount, const void* body, Invoke invoke) {
+    // A single task is cheaper to run inline than to wake the pool, and a pool already running a loop is not waited for
+    if (workers.empty() || taskCount <= 1 || busy.exchange(true, std::memory_order_acquire)) {
+        for (int task = 0; task < taskCount; task++) {
+            invoke(body, task);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->taskCount = taskCount;
+        this->body = body;
+        this->invoke = invoke;
+        nextTask.store(0, std::memory_order_relaxed);
+        activeWorkers = static_cast<int>(workers.size());
+        generation++;
+    }
+    workAvailable.notify_all();
+
+    work();
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        workFinished.wait(lock, [this] { return activeWorkers == 0; });
+    }
+    busy.store(false, std::memory_order_release);
+}
+
+void ThreadPool::workerLoop(unsigned long long lastGeneration) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [&] { return stopping || generation != lastGeneration; });
+            if (stopping) {
+                return;
+            }
+            lastGeneration = generation;
+        }
+
+        work();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--activeWorkers == 0) {
+            workFinished.notify_one();
+        }
+    }
+}
+
+void ThreadPool::work() {
+    int task;
+    while ((task = nextTask.fetch_add(1, std::memory_order_relaxed)) < taskCount) {
+        invoke(body, task);
+    }
+}
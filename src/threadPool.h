@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+/**
+    Fixed set of worker threads that runs the tasks of one parallel loop at a time. run() hands out task indices from a
+    shared counter to the workers and the calling thread, which also works on the loop, and returns once every task has
+    finished. The loop body is passed by reference and called through a function pointer, so a call allocates nothing.
+
+    The wave queries, the ocean and the OBJ loader all run on the shared pool, so the process never has more busy
+    threads than hardware threads. A loop started while another is running, from another thread or from inside a task,
+    runs on its calling thread alone instead of waiting for the pool.
+*/
+class ThreadPool {
+private:
+	typedef void (*Invoke)(const void* body, int task);
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable workAvailable;
+	std::condition_variable workFinished;
+	unsigned long long generation = 0;
+	int activeWorkers = 0;
+	bool stopping = false;
+
+	// Set while a loop owns the workers
+	std::atomic<bool> busy = false;
+	std::atomic<int> nextTask = 0;
+	int taskCount = 0;
+	const void* body = nullptr;
+	Invoke invoke = nullptr;
+
+public:
+	// The pool shared by the whole program, with one thread per hardware thread, started on first use
+	static ThreadPool& getShared();
+
+	~ThreadPool();
+	// A thread count of 0 uses every hardware thread, the calling thread counts as one of them
+	void init(int threadCount);
+	void shutdown();
+	int getThreadCount() const { return static_cast<int>(workers.size()) + 1; }
+
+	// Calls function(task) for every task in [0, taskCount), in any order and on any thread of the pool
+	template <typename Function>
+	void run(int taskCount, const Function& function) {
+		runTasks(taskCount, &function, [](const void* body, int task) { (*static_cast<const Function*>(body))(task); });
+	}
+
+private:
+	void runTasks(int taskCount, const void* body, Invoke invoke);
+	void workerLoop(unsigned long long lastGeneration);
+	void work();
+};
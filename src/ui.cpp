@@ -3,8 +3,14 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include <iostream>
+#include <cfloat>
+#include <cmath>
+#include <filesystem>
 
 #include "ui.h"
+#include "glState.h"
+
+extern std::string executableDirectory;
 
 namespace UI {
     static UIState state = {
@@ -17,6 +23,10 @@ namespace UI {
         .waterMeshResolutionSlider = {
             .hasPendingUpdate = false,
             .lastValue = 0
+        },
+        .waveCountSlider = {
+            .hasPendingUpdate = false,
+            .lastValue = 0
         }
     };
 
@@ -65,6 +75,138 @@ namespace UI {
             ImGui::Text(std::format("Frame time average: {0:.3f} ms ({1:.0f} fps)", frameTime, fps).c_str());
         }
 
+        if (ImGui::CollapsingHeader("Renderer")) {
+            // Counts from the previous frame, this frame's draws have not been made yet
+            const GLState::Counters& counters = GLState::getFrameCounters();
+            int total = counters.issued + counters.skipped;
+            ImGui::Text(std::format("GL state changes issued: {0}", counters.issued).c_str());
+            ImGui::Text(std::format("GL state changes skipped: {0} ({1:.0f}%)", counters.skipped,
+                total > 0 ? 100.0f * counters.skipped / total : 0.0f).c_str());
+
+            const FrameGraph::Stats& stats = inputs.frameGraph->getStats();
+            ImGui::Text(std::format("Passes: {0} ({1} culled), skipped clears: {2}, framebuffer binds: {3}",
+                stats.passes, stats.culledPasses, stats.skippedClears, stats.skippedFramebufferBinds).c_str());
+            ImGui::Text(std::format("Render targets: {0} textures for {1} resources ({2:.1f} MB)",
+                stats.textures, stats.transientResources, stats.textureBytes / (1024.0f * 1024.0f)).c_str());
+
+            WaterGrid& grid = inputs.water->getGrid();
+            WaterGridSettings gridSettings = grid.getSettings();
+            ImGui::Text(std::format("Water patches: {0}", grid.getPatches().size()).c_str());
+            if (ImGui::SliderFloat("Water view distance", &gridSettings.viewDistance, 500.0f, 50000.0f, "%.0f m", ImGuiSliderFlags_Logarithmic)) {
+                grid.setSettings(gridSettings);
+            }
+
+            float triangleSize = inputs.water->getTriangleSize();
+            if (ImGui::SliderFloat("Water triangle size", &triangleSize, 2.0f, 64.0f, "%.1f px", ImGuiSliderFlags_Logarithmic)) {
+                inputs.water->setTriangleSize(triangleSize);
+            }
+
+            // Every count rebuilds the water programs, so the count is applied when the slider is released
+            int waveCount = state.waveCountSlider.hasPendingUpdate ? static_cast<int>(state.waveCountSlider.lastValue) : inputs.water->getWaveCount();
+            bool isSpecialized = false;
+            for (int count : WaveSampler::SPECIALIZED_WAVE_COUNTS) {
+                isSpecialized |= count == waveCount;
+            }
+            std::string waveCountLabel = std::format("{0}{1}", waveCount, isSpecialized ? " (unrolled kernel)" : "");
+            if (ImGui::SliderInt("Gerstner waves", &waveCount, 1, WaveSampler::MAX_WAVES, waveCountLabel.c_str(), ImGuiSliderFlags_AlwaysClamp)) {
+                state.waveCountSlider.hasPendingUpdate = true;
+                state.waveCountSlider.lastValue = static_cast<float>(waveCount);
+            }
+            if (ImGui::IsItemDeactivatedAfterEdit() && state.waveCountSlider.hasPendingUpdate) {
+                state.waveCountSlider.hasPendingUpdate = false;
+                state.engine->setWaveCount(static_cast<int>(state.waveCountSlider.lastValue));
+            }
+
+            WaveBakeSettings bakeSettings = inputs.water->getWaveBakeSettings();
+            bool bakeChanged = ImGui::Checkbox("Bake waves into a texture", &bakeSettings.enabled);
+            if (bakeSettings.enabled) {
+                int resolutionLog2 = static_cast<int>(std::log2(bakeSettings.resolution));
+                if (ImGui::SliderInt("Bake resolution", &resolutionLog2, 8, 12, std::format("{0}", bakeSettings.resolution).c_str())) {
+                    bakeSettings.resolution = 1 << resolutionLog2;
+                    bakeChanged = true;
+                }
+                bakeChanged |= ImGui::SliderFloat("Bake window size", &bakeSettings.windowSize, 128.0f, 8192.0f, "%.0f m", ImGuiSliderFlags_Logarithmic);
+            }
+            if (bakeChanged) {
+                inputs.water->setWaveBakeSettings(bakeSettings);
+            }
+
+            bool frustumCulling = inputs.water->getFrustumCulling();
+            if (ImGui::Checkbox("Cull water patches outside the view", &frustumCulling)) {
+                inputs.water->setFrustumCulling(frustumCulling);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Ocean")) {
+            OceanCascades& ocean = inputs.water->getOcean();
+            OceanSettings settings = ocean.getSettings();
+            bool changed = ImGui::Checkbox("FFT ocean", &settings.enabled);
+            const char* spectrumNames[] = { "Phillips", "JONSWAP" };
+            int spectrum = settings.spectrum;
+            if (ImGui::Combo("Spectrum", &spectrum, spectrumNames, IM_ARRAYSIZE(spectrumNames))) {
+                settings.spectrum = static_cast<OceanSpectrumType>(spectrum);
+                changed = true;
+            }
+            changed |= ImGui::SliderFloat("Wind speed", &settings.windSpeed, 1.0f, 30.0f, "%.1f m/s");
+            changed |= ImGui::SliderAngle("Wind direction", &settings.windDirection, -180.0f, 180.0f);
+            if (settings.spectrum == OCEAN_SPECTRUM_JONSWAP) {
+                changed |= ImGui::SliderFloat("Fetch", &settings.fetch, 1.0f, 1000.0f, "%.0f km", ImGuiSliderFlags_Logarithmic);
+            }
+            changed |= ImGui::SliderFloat("Choppiness", &settings.choppiness, 0.0f, 2.0f);
+            changed |= ImGui::SliderInt("Cascades", &settings.cascadeCount, 1, MAX_OCEAN_CASCADES);
+            for (int i = 0; i < settings.cascadeCount; i++) {
+                OceanCascadeSettings& cascade = settings.cascades[i];
+                ImGui::PushID(i);
+                ImGui::Text(std::format("Cascade {0}", i + 1).c_str());
+                // Each tile stays smaller than the one before it, see OceanCascades::setSettings
+                const float maxTileSize = i > 0 ? settings.cascades[i - 1].tileSize * 0.5f : 4096.0f;
+                if (cascade.tileSize > maxTileSize) {
+                    cascade.tileSize = maxTileSize;
+                    changed = true;
+                }
+                changed |= ImGui::SliderFloat("Tile size", &cascade.tileSize, 4.0f, maxTileSize, "%.0f m", ImGuiSliderFlags_Logarithmic);
+                int resolutionLog2 = static_cast<int>(std::log2(cascade.resolution));
+                if (ImGui::SliderInt("Resolution", &resolutionLog2, 6, 9, std::format("{0}", cascade.resolution).c_str())) {
+                    cascade.resolution = 1 << resolutionLog2;
+                    changed = true;
+                }
+                changed |= ImGui::SliderInt("Update interval", &cascade.updateInterval, 1, 8, "%d frames");
+                ImGui::PopID();
+            }
+            if (changed) {
+                ocean.setSettings(settings);
+            }
+            ImGui::Text(std::format("Ocean memory: {0:.1f} MB", ocean.getMemoryUsage() / (1024.0f * 1024.0f)).c_str());
+        }
+
+        if (ImGui::CollapsingHeader("Profiler")) {
+            Profiler& profiler = *inputs.profiler;
+            const int offset = profiler.getHistoryOffset();
+            for (const Profiler::Scope& scope : profiler.getScopes()) {
+                std::string label = std::format("{0} CPU {1:.3f} ms", scope.name, scope.cpuMilliseconds);
+                ImGui::PlotLines(("##cpu" + scope.name).c_str(), scope.cpuHistory.data(), Profiler::HISTORY_LENGTH, offset,
+                    label.c_str(), 0.0f, FLT_MAX, ImVec2(0, 40));
+                if (scope.gpu) {
+                    label = std::format("{0} GPU {1:.3f} ms", scope.name, scope.gpuMilliseconds);
+                    ImGui::PlotLines(("##gpu" + scope.name).c_str(), scope.gpuHistory.data(), Profiler::HISTORY_LENGTH, offset,
+                        label.c_str(), 0.0f, FLT_MAX, ImVec2(0, 40));
+                }
+            }
+            ImGui::Text(std::format("GPU results dropped: {0}", profiler.getDroppedQueries()).c_str());
+
+            if (!profiler.isTracing()) {
+                if (ImGui::Button("Start trace")) {
+                    profiler.startTrace();
+                }
+            } else if (ImGui::Button(std::format("Stop and save trace ({0} events)", profiler.getTraceEventCount()).c_str())) {
+                profiler.stopTrace();
+                std::filesystem::path path = std::filesystem::path(executableDirectory) / "trace.json";
+                if (profiler.writeTrace(path)) {
+                    std::cout << "Saved trace to " << path << std::endl;
+                }
+            }
+        }
+
         ImGui::End();
     }
 
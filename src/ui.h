@@ -11,6 +11,9 @@ typedef struct {
 	const glm::vec3* cameraPosition;
 	const glm::vec3* cameraForward;
 	const float* frameTime;
+	const FrameGraph* frameGraph;
+	Profiler* profiler;
+	Water* water;
 } UIInputs;
 
 namespace UI {
@@ -25,6 +28,7 @@ namespace UI {
 
 		SliderState waterMeshSizeSlider;
 		SliderState waterMeshResolutionSlider;
+		SliderState waveCountSlider;
 	} UIState;
 
 	void init(GLFWwindow* window, Engine* engine);
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <cmath>
+#include <cstddef>
+
+#include "uniformBuffers.h"
+#include "glState.h"
+
+static_assert(sizeof(UniformBuffers::FrameData) == 160, "FrameData must match the std140 layout of FrameUniforms");
+static_assert(sizeof(WaveSampler::WaveConstants) == 2 * sizeof(glm::vec4), "Each wave must be two vec4s of WaveUniforms");
+static_assert(offsetof(UniformBuffers::WaveData, waves) == 16, "WaveData must match the std140 layout of WaveUniforms");
+static_assert(sizeof(UniformBuffers::WaveData) == 16 + WaveSampler::MAX_WAVES * sizeof(WaveSampler::WaveConstants), "WaveData must match the std140 layout of WaveUniforms");
+
+void UniformBuffers::init() {
+    glGenBuffers(1, &frameBuffer);
+    GLState::bindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_STREAM_DRAW);
+    // Also binds the generic binding point, to the buffer the state cache already holds
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BINDING, frameBuffer);
+
+    glGenBuffers(1, &waveBuffer);
+    GLState::bindBuffer(GL_UNIFORM_BUFFER, waveBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(WaveData), nullptr, GL_STATIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, WAVE_BINDING, waveBuffer);
+}
+
+/**
+    Respecifies the whole buffer rather than updating it in place, so the driver can hand out new storage instead of
+    waiting for draws from the previous frame that still read the old data.
+*/
+void UniformBuffers::updateFrame(const FrameData& frame) {
+    GLState::bindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), &frame, GL_STREAM_DRAW);
+}
+
+/**
+    Uploads the wave table. Waves past waveCount are zeroed, which gives them no amplitude or steepness.
+*/
+void UniformBuffers::updateWaves(const WaveSampler::WaveConstants* waveTable, int waveCount) {
+    WaveData data = {};
+    for (int wave = 0; wave < waveCount && wave < WaveSampler::MAX_WAVES; wave++) {
+        data.waves[wave] = waveTable[wave];
+        data.maxDisplacement += std::abs(waveTable[wave].amplitude);
+    }
+    GLState::bindBuffer(GL_UNIFORM_BUFFER, waveBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(WaveData), &data);
+}
+
+/**
+    Connects the blocks the linked program declares to their binding points. GLSL 4.10 has no binding layout qualifier,
+    so this is done from the CPU once per program. Blocks the program does not declare are skipped.
+*/
+void UniformBuffers::bindBlocks(GLuint program) {
+    GLuint frameBlock = glGetUniformBlockIndex(program, "FrameUniforms");
+    if (frameBlock != GL_INVALID_INDEX) {
+        GLint size = 0;
+        glGetActiveUniformBlockiv(program, frameBlock, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+        if (size != sizeof(FrameData)) {
+            std::cerr << "FrameUniforms block is " << size << " bytes, expected " << sizeof(FrameData) << "." << std::endl;
+        }
+        glUniformBlockBinding(program, frameBlock, FRAME_BINDING);
+    }
+
+    GLuint waveBlock = glGetUniformBlockIndex(program, "WaveUniforms");
+    if (waveBlock != GL_INVALID_INDEX) {
+        GLint size = 0;
+        glGetActiveUniformBlockiv(program, waveBlock, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+        // The wave array is sized by the program's wave count, so only the fixed part and the largest size are known
+        if (size < static_cast<GLint>(offsetof(WaveData, waves)) || size > static_cast<GLint>(sizeof(WaveData))) {
+            std::cerr << "WaveUniforms block is " << size << " bytes, expected at most " << sizeof(WaveData) << "." << std::endl;
+        }
+        glUniformBlockBinding(program, waveBlock, WAVE_BINDING);
+    }
+}
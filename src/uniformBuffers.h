@@ -0,0 +1,50 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include "glCommon.h"
+#include "waveSampler.h"
+
+/**
+	Uniform blocks shared by every program, each bound to a fixed binding point. The frame block holds the camera and time
+	and is written once per frame by Engine::renderFrame; the wave block holds the wave table and is only written when the
+	wave parameters change. A program that declares either block gets its data once bindBlocks has been called after it
+	is linked, so adding a program adds no per-frame uploads. The structs below mirror the std140 layout of the blocks
+	declared in the shaders and must be kept in sync with them.
+*/
+class UniformBuffers {
+public:
+	static const GLuint FRAME_BINDING = 0;
+	static const GLuint WAVE_BINDING = 1;
+
+	// layout (std140) uniform FrameUniforms
+	typedef struct {
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 cameraPosition;
+		float time;
+		int underwaterFlag;
+		int padding;
+		// Size in pixels of the framebuffer being drawn to
+		glm::vec2 viewportSize;
+	} FrameData;
+
+	// layout (std140) uniform WaveUniforms. The programs declare "vec4 waves[WAVE_COUNT * 2]" for the wave count they
+	// were compiled for, see Water::setWaveCount. The array comes last, so the block of a program with fewer waves is a
+	// prefix of this one and the buffer fits every program.
+	typedef struct {
+		// Sum of the wave amplitudes, which bounds the displacement of the surface along each axis
+		float maxDisplacement;
+		float padding[3];
+		WaveSampler::WaveConstants waves[WaveSampler::MAX_WAVES];
+	} WaveData;
+
+private:
+	GLuint frameBuffer = 0;
+	GLuint waveBuffer = 0;
+
+public:
+	void init();
+	void updateFrame(const FrameData& frame);
+	void updateWaves(const WaveSampler::WaveConstants* waveTable, int waveCount);
+	static void bindBlocks(GLuint program);
+};
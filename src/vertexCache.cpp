@@ -0,0 +1,113 @@
+#include "vertexCache.h"
+
+/**
+    Reorders triangles with Tipsify (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced
+    Overdraw", 2007). Triangles are emitted in fans around a current vertex, and the next fanning vertex is picked among
+    the vertices just emitted, preferring the one that has been in the cache longest and will still be in it after its
+    remaining triangles are emitted. Runs in time linear in the number of triangles.
+*/
+void VertexCache::optimize(std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Triangles using each vertex, as offsets into one shared array
+    std::vector<int> liveTriangles(vertexCount, 0);
+    for (uint32_t index : indices) {
+        liveTriangles[index]++;
+    }
+    std::vector<size_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+        adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<size_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+        adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<int> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    int time = cacheSize + 1;
+    size_t cursor = 0;
+
+    int fanningVertex = 0;
+    while (fanningVertex >= 0) {
+        candidates.clear();
+        for (size_t i = adjacencyOffsets[fanningVertex]; i < adjacencyOffsets[fanningVertex + 1]; i++) {
+            const uint32_t triangle = adjacency[i];
+            if (emitted[triangle]) {
+                continue;
+            }
+
+            for (int corner = 0; corner < 3; corner++) {
+                const uint32_t vertex = indices[triangle * 3 + corner];
+                output.push_back(vertex);
+                deadEnd.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                if (time - cacheTime[vertex] > cacheSize) {
+                    cacheTime[vertex] = time;
+                    time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // Pick the candidate that has been in the cache longest and will stay in it while its triangles are emitted
+        fanningVertex = -1;
+        int bestPriority = -1;
+        for (uint32_t vertex : candidates) {
+            if (liveTriangles[vertex] <= 0) {
+                continue;
+            }
+            int priority = 0;
+            if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+                priority = time - cacheTime[vertex];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fanningVertex = static_cast<int>(vertex);
+            }
+        }
+
+        // Dead end, continue from the most recently used vertex with triangles left, or else the next in input order
+        while (fanningVertex < 0 && !deadEnd.empty()) {
+            const uint32_t vertex = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveTriangles[vertex] > 0) {
+                fanningVertex = static_cast<int>(vertex);
+            }
+        }
+        while (fanningVertex < 0 && cursor < vertexCount) {
+            if (liveTriangles[cursor] > 0) {
+                fanningVertex = static_cast<int>(cursor);
+            }
+            cursor++;
+        }
+    }
+
+    indices = std::move(output);
+}
+
+float VertexCache::averageCacheMissRatio(std::span<const uint32_t> indices, size_t vertexCount, int cacheSize) {
+    if (indices.size() < 3) {
+        return 0.0f;
+    }
+
+    // A vertex is still in the FIFO if fewer than cacheSize misses happened since it was inserted
+    std::vector<int64_t> insertedAt(vertexCount, -1);
+    int64_t misses = 0;
+    for (uint32_t index : indices) {
+        if (insertedAt[index] < 0 || misses - insertedAt[index] >= cacheSize) {
+            misses++;
+            insertedAt[index] = misses;
+        }
+    }
+    return static_cast<float>(misses) / (indices.size() / 3);
+}
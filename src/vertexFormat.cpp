@@ -0,0 +1,112 @@
+#include <glm/gtc/packing.hpp>
+
+#include "vertexFormat.h"
+#include "meshCache.h"
+
+static_assert(sizeof(VertexFormat::QuantizedVertex) == 16);
+
+static glm::vec2 signNotZero(glm::vec2 v) {
+    return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+/**
+    Maps a unit vector onto the octahedron |x| + |y| + |z| = 1 and unfolds the lower half over the upper one, giving a
+    point in [-1, 1]^2. See Cigolle et al., "A Survey of Efficient Representations for Independent Unit Vectors", 2014.
+*/
+glm::vec2 VertexFormat::encodeOctahedral(glm::vec3 normal) {
+    normal /= std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    glm::vec2 encoded = glm::vec2(normal.x, normal.y);
+    if (normal.z < 0.0f) {
+        encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * signNotZero(encoded);
+    }
+    return encoded;
+}
+
+glm::vec3 VertexFormat::decodeOctahedral(glm::vec2 encoded) {
+    glm::vec3 normal = glm::vec3(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+    if (normal.z < 0.0f) {
+        glm::vec2 unfolded = (1.0f - glm::abs(glm::vec2(normal.y, normal.x))) * signNotZero(glm::vec2(normal.x, normal.y));
+        normal.x = unfolded.x;
+        normal.y = unfolded.y;
+    }
+    return glm::normalize(normal);
+}
+
+void VertexFormat::quantize(std::span<const float> vertices, QuantizedMesh& mesh) {
+    const size_t vertexCount = vertices.size() / MeshCache::VERTEX_STRIDE;
+    glm::vec3 boundsMin = glm::vec3(0);
+    glm::vec3 boundsMax = glm::vec3(0);
+    for (size_t i = 0; i < vertexCount; i++) {
+        glm::vec3 position = glm::vec3(vertices[i * MeshCache::VERTEX_STRIDE], vertices[i * MeshCache::VERTEX_STRIDE + 1], vertices[i * MeshCache::VERTEX_STRIDE + 2]);
+        boundsMin = i == 0 ? position : glm::min(boundsMin, position);
+        boundsMax = i == 0 ? position : glm::max(boundsMax, position);
+    }
+    mesh.positionOffset = boundsMin;
+    mesh.positionScale = boundsMax - boundsMin;
+
+    // A flat axis has no extent to divide by, every vertex sits at the offset
+    glm::vec3 inverseScale = glm::vec3(
+        mesh.positionScale.x > 0.0f ? 1.0f / mesh.positionScale.x : 0.0f,
+        mesh.positionScale.y > 0.0f ? 1.0f / mesh.positionScale.y : 0.0f,
+        mesh.positionScale.z > 0.0f ? 1.0f / mesh.positionScale.z : 0.0f
+    );
+
+    mesh.vertices.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        const float* vertex = &vertices[i * MeshCache::VERTEX_STRIDE];
+        QuantizedVertex& quantized = mesh.vertices[i];
+        glm::vec3 position = (glm::vec3(vertex[0], vertex[1], vertex[2]) - boundsMin) * inverseScale;
+        quantized.position[0] = glm::packUnorm1x16(position.x);
+        quantized.position[1] = glm::packUnorm1x16(position.y);
+        quantized.position[2] = glm::packUnorm1x16(position.z);
+        quantized.position[3] = 0;
+        quantized.textureCoordinate[0] = glm::packHalf1x16(vertex[3]);
+        quantized.textureCoordinate[1] = glm::packHalf1x16(vertex[4]);
+
+        glm::vec3 normal = glm::vec3(vertex[5], vertex[6], vertex[7]);
+        glm::vec2 encoded = glm::length(normal) > 0.0f ? encodeOctahedral(normal) : glm::vec2(0);
+        quantized.normal[0] = static_cast<int16_t>(glm::packSnorm1x16(encoded.x));
+        quantized.normal[1] = static_cast<int16_t>(glm::packSnorm1x16(encoded.y));
+    }
+}
+
+// The same decoding the vertex shaders do, used to measure the quantization error
+void VertexFormat::dequantize(const QuantizedVertex& vertex, const QuantizedMesh& mesh, glm::vec3& position, glm::vec2& textureCoordinate, glm::vec3& normal) {
+    position = mesh.positionOffset + mesh.positionScale * glm::vec3(
+        glm::unpackUnorm1x16(vertex.position[0]),
+        glm::unpackUnorm1x16(vertex.position[1]),
+        glm::unpackUnorm1x16(vertex.position[2])
+    );
+    textureCoordinate = glm::vec2(glm::unpackHalf1x16(vertex.textureCoordinate[0]), glm::unpackHalf1x16(vertex.textureCoordinate[1]));
+    normal = decodeOctahedral(glm::vec2(
+        glm::unpackSnorm1x16(static_cast<uint16_t>(vertex.normal[0])),
+        glm::unpackSnorm1x16(static_cast<uint16_t>(vertex.normal[1]))
+    ));
+}
+
+size_t VertexFormat::getVertexSize(Format format) {
+    return format == FORMAT_QUANTIZED ? sizeof(QuantizedVertex) : MeshCache::VERTEX_STRIDE * sizeof(float);
+}
+
+// Points the position, texture coordinate and normal attributes of the bound VAO at the bound vertex buffer
+void VertexFormat::setupAttributes(GLuint program, Format format) {
+    GLuint vertexPositionLocation = glGetAttribLocation(program, "vertexPosition");
+    GLuint textureCoordinateLocation = glGetAttribLocation(program, "textureCoordinate");
+    GLuint vertexNormalLocation = glGetAttribLocation(program, "vertexNormal");
+    glEnableVertexAttribArray(vertexPositionLocation);
+    glEnableVertexAttribArray(textureCoordinateLocation);
+    glEnableVertexAttribArray(vertexNormalLocation);
+
+    if (format == FORMAT_QUANTIZED) {
+        const GLsizei stride = sizeof(QuantizedVertex);
+        glVertexAttribPointer(vertexPositionLocation, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(QuantizedVertex, position));
+        glVertexAttribPointer(textureCoordinateLocation, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(QuantizedVertex, textureCoordinate));
+        glVertexAttribPointer(vertexNormalLocation, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(QuantizedVertex, normal));
+        return;
+    }
+
+    const GLsizei stride = MeshCache::VERTEX_STRIDE * sizeof(float);
+    glVertexAttribPointer(vertexPositionLocation, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    glVertexAttribPointer(textureCoordinateLocation, 2, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+    glVertexAttribPointer(vertexNormalLocation, 3, GL_FLOAT, GL_FALSE, stride, (void*)(5 * sizeof(float)));
+}
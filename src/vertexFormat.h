@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "glCommon.h"
+
+/**
+	Vertex layouts for object meshes. FORMAT_FLOAT is the layout MeshCache builds, 8 floats (32 bytes) per vertex.
+	FORMAT_QUANTIZED packs the same data into 16 bytes: positions as 16 bit unsigned normalized values within the mesh
+	bounds, texture coordinates as half floats and normals as octahedral encoded 16 bit signed normalized pairs.
+	The object vertex shaders undo the packing with the positionOffset, positionScale and octahedralNormals uniforms.
+*/
+namespace VertexFormat {
+	enum Format {
+		FORMAT_FLOAT = 0,
+		FORMAT_QUANTIZED = 1
+	};
+
+	typedef struct {
+		// Fraction of the mesh bounds on each axis, the fourth value only pads the position to 8 bytes
+		uint16_t position[4];
+		uint16_t textureCoordinate[2];
+		int16_t normal[2];
+	} QuantizedVertex;
+
+	typedef struct {
+		std::vector<QuantizedVertex> vertices;
+		// Minimum corner and size of the mesh bounds, position = positionOffset + positionScale * quantized position
+		glm::vec3 positionOffset;
+		glm::vec3 positionScale;
+	} QuantizedMesh;
+
+	void quantize(std::span<const float> vertices, QuantizedMesh& mesh);
+	void dequantize(const QuantizedVertex& vertex, const QuantizedMesh& mesh, glm::vec3& position, glm::vec2& textureCoordinate, glm::vec3& normal);
+	glm::vec2 encodeOctahedral(glm::vec3 normal);
+	glm::vec3 decodeOctahedral(glm::vec2 encoded);
+	size_t getVertexSize(Format format);
+	void setupAttributes(GLuint program, Format format);
+}
@@ -1,9 +1,16 @@
 #include <iostream>
 #include <vector>
 #include <format>
+#include <algorithm>
 
 #include "water.h"
 #include "engine.h"
+#include "uniformBuffers.h"
+#include "glState.h"
+
+// Bound before linking, so every build of the program reads the vertex array set up by init
+static const GLuint VERTEX_POSITION_LOCATION = 0;
+static const GLuint PATCH_INSTANCE_LOCATION = 1;
 
 void Water::init(Engine* engine, GLuint skyboxTexture) {
     this->engine = engine;
@@ -11,81 +18,296 @@ void Water::init(Engine* engine, GLuint skyboxTexture) {
 
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    GLState::bindVertexArray(vao);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, vbo);
 
-    // 4 vertices per patch to form quads
+    // 4 vertices per patch to form quads. Every patch is this unit square, moved and scaled by its instance data.
     glPatchParameteri(GL_PATCH_VERTICES, 4);
-    std::vector<float> vertices;
-    const glm::vec2 centerOffset = patchSize * patchTileSize / 2.0f;
-
-    for (int x = 0; x < patchTileSize.x; x++) {
-        for (int y = 0; y < patchTileSize.y; y++) {
-            vertices.push_back(patchSize.x * x - centerOffset.x);
-            vertices.push_back(0);
-            vertices.push_back(patchSize.y * y - centerOffset.y);
-
-            vertices.push_back(patchSize.x * (x + 1) - centerOffset.x);
-            vertices.push_back(0);
-            vertices.push_back(patchSize.y * y - centerOffset.y);
-
-            vertices.push_back(patchSize.x * x - centerOffset.x);
-            vertices.push_back(0);
-            vertices.push_back(patchSize.y * (y + 1) - centerOffset.y);
-
-            vertices.push_back(patchSize.x * (x + 1) - centerOffset.x);
-            vertices.push_back(0);
-            vertices.push_back(patchSize.y * (y + 1) - centerOffset.y);
+    const float vertices[] = {
+        0, 0, 0,
+        1, 0, 0,
+        0, 0, 1,
+        1, 0, 1
+    };
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    // The wave table is uploaded by the engine into the wave uniform block
+    setWaveParameters();
+    buildPrograms();
+
+    glEnableVertexAttribArray(VERTEX_POSITION_LOCATION);
+    glVertexAttribPointer(VERTEX_POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+
+    glGenBuffers(1, &instanceBuffer);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glEnableVertexAttribArray(PATCH_INSTANCE_LOCATION);
+    glVertexAttribPointer(PATCH_INSTANCE_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(WaterGrid::Patch), (void*)0);
+    glVertexAttribDivisor(PATCH_INSTANCE_LOCATION, 1);
+
+    // The bake pass draws one triangle from gl_VertexID, its vertex array has no attributes
+    glGenVertexArrays(1, &bakeVao);
+    glGenFramebuffers(1, &bakeFramebuffer);
+}
+
+/**
+    Compiles and links the water and bake programs for the current wave count, which the shaders get as WAVE_COUNT so
+    their wave loops have a constant trip count. Called again when the wave count changes, replacing the previous
+    programs, after which every uniform of the water program is set again on the next render.
+*/
+void Water::buildPrograms() {
+    GLState::useProgram(0);
+    if (program != 0) {
+        for (Shader* shader : { &vertexShader, &tessControlShader, &tessEvalShader, &fragmentShader, &bakeVertexShader, &bakeFragmentShader }) {
+            glDeleteShader(shader->id);
+            *shader = Shader();
         }
+        glDeleteProgram(program);
+        glDeleteProgram(bakeProgram);
     }
-
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    const std::vector<std::string> defines = { std::format("WAVE_COUNT {0}", waveCount) };
 
     program = glCreateProgram();
-    vertexShader.compileAndAttach(program, GL_VERTEX_SHADER, "water_vertex.glsl");
-    tessControlShader.compileAndAttach(program, GL_TESS_CONTROL_SHADER, "water_tess_control.glsl");
-    tessEvalShader.compileAndAttach(program, GL_TESS_EVALUATION_SHADER, "water_tess_eval.glsl");
-    fragmentShader.compileAndAttach(program, GL_FRAGMENT_SHADER, "water_fragment.glsl");
+    vertexShader.compileAndAttach(program, GL_VERTEX_SHADER, "water_vertex.glsl", defines);
+    tessControlShader.compileAndAttach(program, GL_TESS_CONTROL_SHADER, "water_tess_control.glsl", defines);
+    tessEvalShader.compileAndAttach(program, GL_TESS_EVALUATION_SHADER, "water_tess_eval.glsl", defines);
+    fragmentShader.compileAndAttach(program, GL_FRAGMENT_SHADER, "water_fragment.glsl", defines);
+    glBindAttribLocation(program, VERTEX_POSITION_LOCATION, "vertexPosition");
+    glBindAttribLocation(program, PATCH_INSTANCE_LOCATION, "patchInstance");
     glLinkProgram(program);
-    glUseProgram(program);
-
-    setWaveParameters();
-    vertexShader.setUniformFloatv("waves", 80, waveParameters);
-    tessEvalShader.setUniformFloatv("waves", 80, waveParameters);
-
-    GLuint vertexPositionLocation = glGetAttribLocation(program, "vertexPosition");
-    glEnableVertexAttribArray(vertexPositionLocation);
-    glVertexAttribPointer(vertexPositionLocation, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    UniformBuffers::bindBlocks(program);
+    frustumCullingUniform = tessControlShader.getUniform("frustumCulling");
+    triangleSizeUniform = tessControlShader.getUniform("triangleSize");
+    fftOceanUniform = tessEvalShader.getUniform("fftOcean");
+    oceanCascadeCountUniform = tessEvalShader.getUniform("oceanCascadeCount");
+    oceanTileSizesUniform = tessEvalShader.getUniform("oceanTileSizes");
+    oceanMaxDisplacementUniform = tessControlShader.getUniform("oceanMaxDisplacement");
+    GLState::useProgram(program);
+    int oceanTextureUnits[2][MAX_OCEAN_CASCADES];
+    for (int cascade = 0; cascade < MAX_OCEAN_CASCADES; cascade++) {
+        oceanTextureUnits[0][cascade] = 1 + cascade;
+        oceanTextureUnits[1][cascade] = 1 + MAX_OCEAN_CASCADES + cascade;
+    }
+    tessEvalShader.setUniformIntv("oceanDisplacements", MAX_OCEAN_CASCADES, oceanTextureUnits[0]);
+    fragmentShader.setUniformIntv("oceanDerivatives", MAX_OCEAN_CASCADES, oceanTextureUnits[1]);
+    bakedWavesUniform = tessEvalShader.getUniform("bakedWaves");
+    bakeWindowSizeUniform = tessEvalShader.getUniform("bakeWindowSize");
+    tessEvalShader.setUniformInt("bakedDisplacement", 9);
+    tessEvalShader.setUniformInt("bakedNormal", 10);
+
+    bakeProgram = glCreateProgram();
+    bakeVertexShader.compileAndAttach(bakeProgram, GL_VERTEX_SHADER, "water_bake_vertex.glsl", defines);
+    bakeFragmentShader.compileAndAttach(bakeProgram, GL_FRAGMENT_SHADER, "water_bake_fragment.glsl", defines);
+    glLinkProgram(bakeProgram);
+    UniformBuffers::bindBlocks(bakeProgram);
+    bakePassWindowSizeUniform = bakeFragmentShader.getUniform("bakeWindowSize");
+    bakePassResolutionUniform = bakeFragmentShader.getUniform("bakeResolution");
+
+    // A new program starts with every uniform at zero
+    hasFrustumCullingUpdate = true;
+    hasTriangleSizeUpdate = true;
+    hasWaveBakeUpdate = true;
+    fftOcean = false;
+    bakedWaves = false;
+    for (int cascade = 0; cascade < MAX_OCEAN_CASCADES; cascade++) {
+        hasOceanUpdate[cascade] = true;
+    }
 }
 
-void Water::render(float time, bool cameraUnderwater) {
-    glBindVertexArray(vao);
-    glUseProgram(program);
+void Water::updateGrid(glm::vec3 cameraPosition) {
+    grid.update(cameraPosition);
+    hasGridUpdate = true;
+}
 
-    vertexShader.setUniformFloat("time", time);
-    tessEvalShader.setUniformFloat("time", time);
-    fragmentShader.setUniformVec3("cameraPosition", engine->camera.position);
-    fragmentShader.setUniformInt("underwaterFlag", static_cast<int>(cameraUnderwater));
+void Water::render() {
+    GLState::bindVertexArray(vao);
+    GLState::useProgram(program);
+    if (hasFrustumCullingUpdate) {
+        tessControlShader.setUniformInt(frustumCullingUniform, frustumCulling);
+        hasFrustumCullingUpdate = false;
+    }
+    if (hasTriangleSizeUpdate) {
+        tessControlShader.setUniformFloat(triangleSizeUniform, triangleSize);
+        hasTriangleSizeUpdate = false;
+    }
+    if (ocean.isValid() != fftOcean) {
+        fftOcean = ocean.isValid();
+        tessEvalShader.setUniformInt(fftOceanUniform, fftOcean);
+    }
+    // Until the first bake at the current resolution the waves are summed as usual
+    const bool baked = waveBakeSettings.enabled && !fftOcean && bakeTextureResolution == waveBakeSettings.resolution;
+    if (baked != bakedWaves) {
+        bakedWaves = baked;
+        tessEvalShader.setUniformInt(bakedWavesUniform, bakedWaves);
+    }
+    if (hasWaveBakeUpdate) {
+        tessEvalShader.setUniformFloat(bakeWindowSizeUniform, waveBakeSettings.windowSize);
+        hasWaveBakeUpdate = false;
+    }
+    if (bakedWaves) {
+        for (int texture = 0; texture < 2; texture++) {
+            GLState::activeTexture(GL_TEXTURE9 + texture);
+            GLState::bindTexture(GL_TEXTURE_2D, bakeTextures[texture]);
+        }
+        GLState::activeTexture(GL_TEXTURE0);
+    }
+    if (fftOcean) {
+        uploadOceanTextures();
+        for (int cascade = 0; cascade < ocean.getCascadeCount(); cascade++) {
+            for (int texture = 0; texture < 2; texture++) {
+                GLState::activeTexture(GL_TEXTURE1 + texture * MAX_OCEAN_CASCADES + cascade);
+                GLState::bindTexture(GL_TEXTURE_2D, oceanTextures[cascade][texture]);
+            }
+        }
+        GLState::activeTexture(GL_TEXTURE0);
+    }
 
-    glBindVertexArray(vao);
-    glDrawArrays(GL_PATCHES, 0, 4 * patchTileSize.x * patchTileSize.y);
+    const std::vector<WaterGrid::Patch>& patches = grid.getPatches();
+    if (hasGridUpdate) {
+        // Respecified rather than updated in place, like the per frame uniform buffer
+        GLState::bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, patches.size() * sizeof(WaterGrid::Patch), patches.data(), GL_STREAM_DRAW);
+        hasGridUpdate = false;
+    }
+    glDrawArraysInstanced(GL_PATCHES, 0, 4, static_cast<GLsizei>(patches.size()));
 
     // Renders wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    //glDrawArrays(GL_PATCHES, 0, 4 * patchTileSize.x * patchTileSize.y);
+    //glDrawArraysInstanced(GL_PATCHES, 0, 4, static_cast<GLsizei>(patches.size()));
     //glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 }
 
-void Water::setViewMatrix(glm::mat4 view) {
-    glUseProgram(program);
-    vertexShader.setUniformMat4("view", view);
-    tessEvalShader.setUniformMat4("view", view);
+/**
+    Copies the cascades updated since the last upload into their textures and rebuilds their mipmaps, which the eval
+    shader picks from by vertex spacing. The textures of a cascade are reallocated when its resolution changes.
+*/
+void Water::uploadOceanTextures() {
+    const GLenum internalFormats[2] = { GL_RGBA32F, GL_RGBA16F };
+    bool uploaded = false;
+    for (int cascade = 0; cascade < ocean.getCascadeCount(); cascade++) {
+        if (!hasOceanUpdate[cascade]) {
+            continue;
+        }
+        const OceanSpectrum& spectrum = ocean.getCascade(cascade);
+        const int resolution = spectrum.getSettings().resolution;
+        const void* data[2] = { spectrum.getDisplacements().data(), spectrum.getDerivatives().data() };
+
+        if (oceanTextures[cascade][0] == 0) {
+            glGenTextures(2, oceanTextures[cascade]);
+        }
+        for (int texture = 0; texture < 2; texture++) {
+            GLState::activeTexture(GL_TEXTURE1 + texture * MAX_OCEAN_CASCADES + cascade);
+            GLState::bindTexture(GL_TEXTURE_2D, oceanTextures[cascade][texture]);
+            if (resolution != oceanTextureResolutions[cascade]) {
+                glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[texture], resolution, resolution, 0, GL_RGBA, GL_FLOAT, data[texture]);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            } else {
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, resolution, resolution, GL_RGBA, GL_FLOAT, data[texture]);
+            }
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+        oceanTextureResolutions[cascade] = resolution;
+        hasOceanUpdate[cascade] = false;
+        uploaded = true;
+    }
+    GLState::activeTexture(GL_TEXTURE0);
+    if (!uploaded) {
+        return;
+    }
+
+    float tileSizes[MAX_OCEAN_CASCADES];
+    for (int cascade = 0; cascade < ocean.getCascadeCount(); cascade++) {
+        tileSizes[cascade] = ocean.getSettings().cascades[cascade].tileSize;
+    }
+    tessEvalShader.setUniformInt(oceanCascadeCountUniform, ocean.getCascadeCount());
+    tessEvalShader.setUniformFloatv(oceanTileSizesUniform, ocean.getCascadeCount(), tileSizes);
+    tessControlShader.setUniformFloat(oceanMaxDisplacementUniform, ocean.getMaxDisplacement());
+}
+
+/**
+    Evaluates the waves once per texel of a window around the camera, so the eval shader can look them up instead of
+    summing every wave for every vertex. The textures wrap around and each texel holds the copy of its location
+    nearest the camera, which keeps texels fixed in world space as the camera moves, see water_bake_fragment.glsl.
+    The mipmaps are rebuilt after every bake for the eval shader's lookups by vertex spacing.
+
+    Leaves the bake framebuffer bound with a viewport of its size, the frame graph binds its own for each pass.
+*/
+void Water::bakeWaves() {
+    if (!waveBakeSettings.enabled || ocean.isValid()) {
+        return;
+    }
+    const int resolution = waveBakeSettings.resolution;
+    GLState::bindFramebuffer(bakeFramebuffer);
+    if (resolution != bakeTextureResolution) {
+        const GLenum internalFormats[2] = { GL_RGBA32F, GL_RGBA16F };
+        if (bakeTextures[0] == 0) {
+            glGenTextures(2, bakeTextures);
+        }
+        for (int texture = 0; texture < 2; texture++) {
+            GLState::activeTexture(GL_TEXTURE9 + texture);
+            GLState::bindTexture(GL_TEXTURE_2D, bakeTextures[texture]);
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[texture], resolution, resolution, 0, GL_RGBA, GL_FLOAT, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + texture, GL_TEXTURE_2D, bakeTextures[texture], 0);
+        }
+        const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, drawBuffers);
+        bakeTextureResolution = resolution;
+    }
+
+    glViewport(0, 0, resolution, resolution);
+    GLState::bindVertexArray(bakeVao);
+    GLState::useProgram(bakeProgram);
+    bakeFragmentShader.setUniformFloat(bakePassWindowSizeUniform, waveBakeSettings.windowSize);
+    bakeFragmentShader.setUniformFloat(bakePassResolutionUniform, static_cast<float>(resolution));
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    for (int texture = 0; texture < 2; texture++) {
+        GLState::activeTexture(GL_TEXTURE9 + texture);
+        GLState::bindTexture(GL_TEXTURE_2D, bakeTextures[texture]);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    GLState::activeTexture(GL_TEXTURE0);
+}
+
+void Water::setWaveBakeSettings(const WaveBakeSettings& settings) {
+    if (settings.resolution < 1 || settings.windowSize <= 0.0f) {
+        std::cerr << "Wave bake resolution " << settings.resolution << " and window size " << settings.windowSize << " must be positive." << std::endl;
+        return;
+    }
+    waveBakeSettings = settings;
+    hasWaveBakeUpdate = true;
+}
+
+void Water::setFrustumCulling(bool enabled) {
+    hasFrustumCullingUpdate = hasFrustumCullingUpdate || enabled != frustumCulling;
+    frustumCulling = enabled;
 }
 
-void Water::setProjectionMatrix(glm::mat4 projection) {
-    glUseProgram(program);
-    vertexShader.setUniformMat4("projection", projection);
-    tessEvalShader.setUniformMat4("projection", projection);
+void Water::setTriangleSize(float pixels) {
+    hasTriangleSizeUpdate = hasTriangleSizeUpdate || pixels != triangleSize;
+    triangleSize = std::max(pixels, 1.0f);
+}
+
+void Water::setWaveCount(int count) {
+    if (count < 1 || count > WaveSampler::MAX_WAVES) {
+        std::cerr << "Wave count " << count << " is not between 1 and " << WaveSampler::MAX_WAVES << "." << std::endl;
+        return;
+    }
+    if (count == waveCount) {
+        return;
+    }
+    waveCount = count;
+    setWaveParameters();
+    // Before init there are no programs yet, init builds them for this count
+    if (program != 0) {
+        buildPrograms();
+    }
 }
 
 void Water::setWaveParameters() {
@@ -94,6 +316,10 @@ void Water::setWaveParameters() {
     srand(100);
 
     const float PI = 3.1415926535897932384626433832795;
+    const float speed = 3;
+    // The steepness of each wave is scaled so the summed steepness, and with it how sharp the crests get, stays that of
+    // the original 20 waves for any wave count
+    const float steepnessScale = 20.0f / waveCount;
 
     for (int wave = 0; wave < waveCount; wave++) {
         float p = wave / (float)waveCount;
@@ -102,87 +328,172 @@ void Water::setWaveParameters() {
 
         float xDirection = (r * 2) - 1;
         float wavelength = (maxWavelength - minWavelength) * wavelengthP + minWavelength;
-        float steepness = 0.1;
+        float steepness = 0.1 * steepnessScale;
         
         if (wavelength < 10) {
-            steepness = 0.025;
+            steepness = 0.025 * steepnessScale;
         }
 
         r = rand() / (float)RAND_MAX;
         float yDirection = 0.5 + ((r * 2) - 1) * 0.5;
 
-        waveParameters[wave * 4 + 0] = xDirection;
-        waveParameters[wave * 4 + 1] = yDirection;
-        waveParameters[wave * 4 + 2] = steepness;
-        waveParameters[wave * 4 + 3] = wavelength;
+        // Everything that does not depend on the location or time is computed once here rather than per vertex and per query
+        glm::vec2 direction = glm::normalize(glm::vec2(xDirection, yDirection));
+        float k = 2 * PI / wavelength;
+        float c = sqrt(9.81 / k);
+        waveTable[wave] = {
+            .directionX = direction.x,
+            .directionZ = direction.y,
+            .k = k,
+            .angularSpeed = k * c * speed,
+            .amplitude = steepness / k,
+            .steepness = steepness
+        };
     }
 }
 
-static glm::vec3 accumulateGerstnerWave(glm::vec3 vertexPosition, glm::vec2 direction, float steepness, float wavelength, float time, glm::vec3& tangent, glm::vec3& binormal) {
-    direction = normalize(direction);
-    const float PI = 3.1415926535897932384626433832795;
-
-    float speed = 3;
-    float k = 2 * PI / wavelength;
-    float c = sqrt(9.81 / k);
-    float f = k * (glm::dot(direction, glm::vec2(vertexPosition.x, vertexPosition.z)) - c * time * speed);
-    float a = steepness / k;
+static glm::vec3 accumulateGerstnerWave(glm::vec3 vertexPosition, const WaveSampler::WaveConstants& wave, float time, glm::vec3& tangent, glm::vec3& binormal) {
+    glm::vec2 direction = glm::vec2(wave.directionX, wave.directionZ);
+    float f = wave.k * glm::dot(direction, glm::vec2(vertexPosition.x, vertexPosition.z)) - wave.angularSpeed * time;
+    float sinF = sin(f);
+    float cosF = cos(f);
 
     tangent += glm::vec3(
-        -direction.x * direction.x * steepness * sin(f),
-        direction.x * steepness * cos(f),
-        -direction.x * direction.y * steepness * sin(f)
+        -direction.x * direction.x * wave.steepness * sinF,
+        direction.x * wave.steepness * cosF,
+        -direction.x * direction.y * wave.steepness * sinF
     );
 
     binormal += glm::vec3(
-        -direction.x * direction.y * steepness * sin(f),
-        direction.y * steepness * cos(f),
-        -direction.y * direction.y * steepness * sin(f)
+        -direction.x * direction.y * wave.steepness * sinF,
+        direction.y * wave.steepness * cosF,
+        -direction.y * direction.y * wave.steepness * sinF
     );
 
     return glm::vec3(
-        direction.x * (a * cos(f)),
-        a * sin(f),
-        direction.y * (a * cos(f))
+        direction.x * (wave.amplitude * cosF),
+        wave.amplitude * sinF,
+        direction.y * (wave.amplitude * cosF)
     );
 }
 
-static void getSingleWaveGeometry(glm::vec3 location, float time, float* waveParameters, glm::vec3& wavePosition, glm::vec3& waveNormal) {
+static void getSingleWaveGeometry(glm::vec3 location, float time, const WaveSampler::WaveConstants* waveTable, int waveCount, glm::vec3& wavePosition, glm::vec3& tangent, glm::vec3& binormal) {
     glm::vec3 position = glm::vec3(location.x, 0, location.z);
-    glm::vec3 tangent = glm::vec3(1.0, 0.0, 0.0);
-    glm::vec3 binormal = glm::vec3(0.0, 0.0, 1.0);
+    tangent = glm::vec3(1.0, 0.0, 0.0);
+    binormal = glm::vec3(0.0, 0.0, 1.0);
 
-    const int numWaves = 20;
-    for (int i = 0; i < numWaves * 4; i += 4) {
-        glm::vec2 direction = glm::vec2(waveParameters[i], waveParameters[i + 1]);
-        float steepness = waveParameters[i + 2];
-        float wavelength = waveParameters[i + 3];
-        position += accumulateGerstnerWave(location, direction, steepness, wavelength, time, tangent, binormal);
+    for (int i = 0; i < waveCount; i++) {
+        position += accumulateGerstnerWave(location, waveTable[i], time, tangent, binormal);
     }
 
     wavePosition = position;
-    waveNormal = normalize(cross(binormal, tangent));
 }
 
 /**
     The displacement for each vertex in the water surface mesh is computed in the tesselation eval and vertex shaders, so it is not
     quickly accessible on the CPU. This function uses the same wave function calculation to approximate the wave height at a given
     point. This is an approximation because the wave function modifies all components of the input vector, not just the height, and is
-    not an invertable function. The more iterations used, the more accurate this approximation will be.
+    not an invertable function.
+
+    The measurement location is moved until its horizontally displaced position is within the solver tolerance of the desired
+    position, or the iteration limit is reached. Newton steps use the xz components of the tangent and binormal as the Jacobian of the
+    horizontal displacement and usually converge in 2-3 iterations, where the plain step needs closer to 10. With the default 1 mm
+    tolerance the reported height stays within 5 mm of a fully converged solution. See WaveSampler::SolverSettings.
+
+    When the height field cache is enabled and was built for this time, queries inside it are answered by grid lookups instead.
+    When the ocean is enabled, every query is answered from its cascades.
 */
-void Water::approximateWaveGeometry(glm::vec3 desiredPosition, float time, glm::vec3& wavePosition, glm::vec3& waveNormal) {
-    const int iterations = 10;
+void Water::approximateWaveGeometry(glm::vec3 desiredPosition, float time, glm::vec3& wavePosition, glm::vec3& waveNormal, WaveSampler::SolverStats* stats) {
+    if (ocean.sample(glm::vec2(desiredPosition.x, desiredPosition.z), time, solverSettings, wavePosition, waveNormal, stats)) {
+        return;
+    }
+    if (heightFieldCache.sample(glm::vec2(desiredPosition.x, desiredPosition.z), time, solverSettings, wavePosition, waveNormal, stats)) {
+        return;
+    }
 
+    const glm::vec2 desiredLocation = glm::vec2(desiredPosition.x, desiredPosition.z);
     glm::vec3 measurementLocation = glm::vec3(desiredPosition);
     glm::vec3 measuredPosition;
-    glm::vec3 measuredNormal;
+    glm::vec3 tangent;
+    glm::vec3 binormal;
+    float residual;
+
+    int iteration = 0;
+    while (true) {
+        getSingleWaveGeometry(measurementLocation, time, waveTable, waveCount, measuredPosition, tangent, binormal);
+        iteration++;
+
+        glm::vec2 offset = glm::vec2(measuredPosition.x, measuredPosition.z) - desiredLocation;
+        residual = glm::length(offset);
+        if (iteration >= solverSettings.maxIterations || residual < solverSettings.tolerance) {
+            break;
+        }
 
-    for (int i = 0; i < iterations; i++) {
-        getSingleWaveGeometry(measurementLocation, time, waveParameters, measuredPosition, measuredNormal);
-        glm::vec3 offset = measuredPosition - desiredPosition;
-        measurementLocation = measurementLocation - offset;
+        glm::vec2 step = offset;
+        float determinant = tangent.x * binormal.z - binormal.x * tangent.z;
+        if (solverSettings.newton && determinant > WaveSampler::MIN_NEWTON_DETERMINANT) {
+            step = glm::vec2(binormal.z * offset.x - binormal.x * offset.y, tangent.x * offset.y - tangent.z * offset.x) / determinant;
+        }
+        measurementLocation.x -= step.x;
+        measurementLocation.z -= step.y;
     }
 
     wavePosition = measuredPosition;
-    waveNormal = measuredNormal;
+    waveNormal = normalize(cross(binormal, tangent));
+
+    if (stats) {
+        stats->iterations = iteration;
+        stats->residual = residual;
+    }
+}
+
+/**
+    Rebuilds the height field cache around the given center for this frame's time. Does nothing unless the cache has been
+    enabled through getHeightFieldCache().setSettings(), which the app does not do, see HeightFieldCache.
+*/
+void Water::updateHeightFieldCache(glm::vec3 center, float time) {
+    if (heightFieldCache.getSettings().enabled) {
+        heightFieldCache.build(waveTable, waveCount, center, time);
+    }
+}
+
+/**
+    Advances the ocean cascades due this frame to its time and marks their textures for upload. Does nothing unless
+    the ocean has been enabled through getOcean().setSettings().
+*/
+void Water::updateOcean(float time) {
+    ocean.update(time);
+    if (ocean.isValid()) {
+        for (int cascade = 0; cascade < ocean.getCascadeCount(); cascade++) {
+            hasOceanUpdate[cascade] = hasOceanUpdate[cascade] || ocean.wasCascadeUpdated(cascade);
+        }
+    }
+}
+
+void Water::sampleRange(const WaveSampler::Waves& waves, float time, WaveSampler::Batch& batch, size_t begin, size_t end, WaveSampler::InstructionSet instructionSet) const {
+    if (!ocean.sampleRange(time, solverSettings, batch, begin, end)) {
+        WaveSampler::sample(waves, solverSettings, batch, begin, end, instructionSet);
+    }
+}
+
+/**
+    Batched version of approximateWaveGeometry for many query points at the same time. The xz locations are copied into
+    the structure of arrays layout used by WaveSampler, which evaluates several queries per instruction using the widest
+    instruction set available on this CPU. Heights and normals are written in the same order as the locations.
+*/
+void Water::approximateWaveGeometryBatch(std::span<const glm::vec2> locations, float time, std::span<float> heights, std::span<glm::vec3> normals) {
+    WaveSampler::resize(sampleBatch, locations.size());
+    for (size_t i = 0; i < locations.size(); i++) {
+        sampleBatch.x[i] = locations[i].x;
+        sampleBatch.z[i] = locations[i].y;
+    }
+
+    WaveSampler::Waves waves;
+    WaveSampler::prepareWaves(waveTable, waveCount, time, waves);
+    sampleRange(waves, time, sampleBatch, 0, sampleBatch.x.size(), WaveSampler::getInstructionSet());
+
+    for (size_t i = 0; i < locations.size(); i++) {
+        heights[i] = sampleBatch.height[i];
+        normals[i] = glm::vec3(sampleBatch.normalX[i], sampleBatch.normalY[i], sampleBatch.normalZ[i]);
+    }
 }
@@ -1,6 +1,12 @@
 #pragma once
+#include <span>
+
 #include "glCommon.h"
 #include "shader.h"
+#include "waveSampler.h"
+#include "heightFieldCache.h"
+#include "waterGrid.h"
+#include "oceanCascades.h"
 
 static const int VERTICES_PER_QUAD = 6;
 static const float QUAD_VERTEX_POSITIONS[] = {
@@ -12,6 +18,14 @@ static const float QUAD_VERTEX_POSITIONS[] = {
 	0.5, 0.0, -0.5,
 };
 
+typedef struct {
+	bool enabled;
+	// Texels along each side of the baked window
+	int resolution;
+	// World space size, in meters, of each side of the window around the camera
+	float windowSize;
+} WaveBakeSettings;
+
 class Engine;
 
 class Water {
@@ -20,26 +34,110 @@ private:
 
 	GLuint vao;
 	GLuint vbo;
+	// One WaterGrid::Patch per instance
+	GLuint instanceBuffer;
+	bool hasGridUpdate = false;
 	GLuint skyboxTexture;
-	GLuint program;
+	GLuint program = 0;
 
 	Shader vertexShader;
 	Shader tessControlShader;
 	Shader tessEvalShader;
 	Shader fragmentShader;
 
-	glm::vec2 patchTileSize = glm::vec2(100, 100);
-	glm::vec2 patchSize = glm::vec2(100, 100);
+	WaterGrid grid;
+
+	// Patches outside the view frustum are discarded by the tessellation control shader
+	bool frustumCulling = true;
+	bool hasFrustumCullingUpdate = true;
+	Shader::UniformHandle frustumCullingUniform;
+	// Target edge length in pixels of the tessellated triangles
+	float triangleSize = 8.0f;
+	bool hasTriangleSizeUpdate = true;
+	Shader::UniformHandle triangleSizeUniform;
+
+	// Gerstner waves evaluated once per texel around the camera each frame, see bakeWaves
+	WaveBakeSettings waveBakeSettings = {
+		.enabled = false,
+		.resolution = 1024,
+		.windowSize = 1024.0f
+	};
+	bool hasWaveBakeUpdate = true;
+	GLuint bakeProgram = 0;
+	GLuint bakeVao;
+	GLuint bakeFramebuffer;
+	Shader bakeVertexShader;
+	Shader bakeFragmentShader;
+	// Displacement and normal, on texture units 9 and 10
+	GLuint bakeTextures[2] = {};
+	int bakeTextureResolution = 0;
+	bool bakedWaves = false;
+	Shader::UniformHandle bakedWavesUniform;
+	Shader::UniformHandle bakeWindowSizeUniform;
+	Shader::UniformHandle bakePassWindowSizeUniform;
+	Shader::UniformHandle bakePassResolutionUniform;
+
+	// Replaces the Gerstner waves when enabled through getOcean().setSettings()
+	OceanCascades ocean;
+	// Displacement and derivatives of each ocean cascade, on texture units 1 to 4 and 5 to 8
+	GLuint oceanTextures[MAX_OCEAN_CASCADES][2] = {};
+	int oceanTextureResolutions[MAX_OCEAN_CASCADES] = {};
+	// Cascades updated since their textures were last uploaded
+	bool hasOceanUpdate[MAX_OCEAN_CASCADES] = {};
+	bool fftOcean = false;
+	Shader::UniformHandle fftOceanUniform;
+	Shader::UniformHandle oceanCascadeCountUniform;
+	Shader::UniformHandle oceanTileSizesUniform;
+	Shader::UniformHandle oceanMaxDisplacementUniform;
 
-	const int waveCount = 20;
-	float waveParameters[4 * 20];
+	// Up to WaveSampler::MAX_WAVES, the programs are compiled for this count, see setWaveCount
+	int waveCount = 20;
+	WaveSampler::WaveConstants waveTable[WaveSampler::MAX_WAVES];
+
+	WaveSampler::Batch sampleBatch;
+	HeightFieldCache heightFieldCache;
+	WaveSampler::SolverSettings solverSettings = {
+		.tolerance = 0.001f,
+		.maxIterations = 10,
+		.newton = true
+	};
 
 public:
 	void init(Engine* engine, GLuint skyboxTexture);
-	void render(float time, bool cameraUnderwater);
-	void setViewMatrix(glm::mat4 view);
-	void setProjectionMatrix(glm::mat4 projection);
-	void approximateWaveGeometry(glm::vec3 location, float time, glm::vec3& wavePosition, glm::vec3& waveNormal);
-private:
+	void render();
+	// Renders the waves into the baked textures when baking is enabled, after the frame uniforms are updated and before render
+	void bakeWaves();
+	// Chooses the patches to draw around the camera
+	void updateGrid(glm::vec3 cameraPosition);
+	WaterGrid& getGrid() { return grid; }
+	const WaterGrid& getGrid() const { return grid; }
+	void setFrustumCulling(bool enabled);
+	bool getFrustumCulling() const { return frustumCulling; }
+	void setTriangleSize(float pixels);
+	float getTriangleSize() const { return triangleSize; }
+	void setWaveBakeSettings(const WaveBakeSettings& settings);
+	const WaveBakeSettings& getWaveBakeSettings() const { return waveBakeSettings; }
+	// Texture holding the baked displacement, for reading it back
+	GLuint getBakedDisplacementTexture() const { return bakeTextures[0]; }
+	void approximateWaveGeometry(glm::vec3 location, float time, glm::vec3& wavePosition, glm::vec3& waveNormal, WaveSampler::SolverStats* stats = nullptr);
+	void approximateWaveGeometryBatch(std::span<const glm::vec2> locations, float time, std::span<float> heights, std::span<glm::vec3> normals);
+	void updateHeightFieldCache(glm::vec3 center, float time);
+	void updateOcean(float time);
+	// Answers a range of batched wave queries from the ocean when it is enabled, otherwise from the waves
+	void sampleRange(const WaveSampler::Waves& waves, float time, WaveSampler::Batch& batch, size_t begin, size_t end, WaveSampler::InstructionSet instructionSet) const;
 	void setWaveParameters();
+	// Regenerates the waves with the given count and rebuilds the programs for it, the wave table must then be uploaded again
+	void setWaveCount(int count);
+	const WaveSampler::WaveConstants* getWaveTable() const { return waveTable; }
+	int getWaveCount() const { return waveCount; }
+	const WaveSampler::SolverSettings& getSolverSettings() const { return solverSettings; }
+	void setSolverSettings(const WaveSampler::SolverSettings& settings) { solverSettings = settings; }
+	HeightFieldCache& getHeightFieldCache() { return heightFieldCache; }
+	const HeightFieldCache& getHeightFieldCache() const { return heightFieldCache; }
+	OceanCascades& getOcean() { return ocean; }
+	const OceanCascades& getOcean() const { return ocean; }
+
+private:
+	void buildPrograms();
+	void uploadOceanTextures();
 };
\ No newline at end of file
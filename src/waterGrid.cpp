@@ -0,0 +1,81 @@
+#include <cmath>
+#include <algorithm>
+
+#include "waterGrid.h"
+
+void WaterGrid::setSettings(const WaterGridSettings& settings) {
+    this->settings = settings;
+    this->settings.lodLevels = std::max(settings.lodLevels, 1);
+}
+
+float WaterGrid::getSize(int level) const {
+    return std::ldexp(settings.patchSize, level);
+}
+
+// Distance from the camera to the closest point of the node, which lies in the y = 0 plane
+float WaterGrid::getDistance(int level, long long x, long long z) const {
+    const float size = getSize(level);
+    const glm::vec2 minimum = glm::vec2(x, z) * size;
+    const glm::vec2 maximum = minimum + size;
+    const glm::vec2 location = glm::vec2(camera.x, camera.z);
+    const glm::vec2 outside = glm::max(glm::max(minimum - location, location - maximum), glm::vec2(0));
+    return glm::length(glm::vec3(outside.x, camera.y, outside.y));
+}
+
+bool WaterGrid::subdivides(int level, long long x, long long z) const {
+    return level > 0 && getDistance(level, x, z) < settings.lodDistanceRatio * getSize(level);
+}
+
+/**
+    Nodes are identified by their level and their position on the grid of that level, so whether a node is split is a
+    function of the node alone. A neighbor is larger exactly when the parent of the same sized node next to it is not
+    split, which is checked without building the tree.
+*/
+void WaterGrid::select(int level, long long x, long long z) {
+    if (getDistance(level, x, z) > settings.viewDistance) {
+        return;
+    }
+
+    if (subdivides(level, x, z)) {
+        for (int child = 0; child < 4; child++) {
+            select(level - 1, 2 * x + (child & 1), 2 * z + (child >> 1));
+        }
+        return;
+    }
+
+    int coarserEdges = 0;
+    if (level < settings.lodLevels - 1) {
+        // Floor division, so negative grid positions find their parent too
+        auto parent = [](long long position) { return position >= 0 ? position / 2 : (position - 1) / 2; };
+        const long long neighbors[4][2] = { { x - 1, z }, { x, z - 1 }, { x + 1, z }, { x, z + 1 } };
+        for (int edge = 0; edge < 4; edge++) {
+            if (!subdivides(level + 1, parent(neighbors[edge][0]), parent(neighbors[edge][1]))) {
+                coarserEdges |= 1 << edge;
+            }
+        }
+    }
+
+    const float size = getSize(level);
+    patches.push_back({
+        .origin = glm::vec2(x, z) * size,
+        .size = size,
+        .coarserEdges = static_cast<float>(coarserEdges)
+    });
+}
+
+void WaterGrid::update(glm::vec3 cameraPosition) {
+    camera = cameraPosition;
+    patches.clear();
+
+    const int rootLevel = settings.lodLevels - 1;
+    const float rootSize = getSize(rootLevel);
+    const long long minimumX = static_cast<long long>(std::floor((camera.x - settings.viewDistance) / rootSize));
+    const long long maximumX = static_cast<long long>(std::floor((camera.x + settings.viewDistance) / rootSize));
+    const long long minimumZ = static_cast<long long>(std::floor((camera.z - settings.viewDistance) / rootSize));
+    const long long maximumZ = static_cast<long long>(std::floor((camera.z + settings.viewDistance) / rootSize));
+    for (long long z = minimumZ; z <= maximumZ; z++) {
+        for (long long x = minimumX; x <= maximumX; x++) {
+            select(rootLevel, x, z);
+        }
+    }
+}
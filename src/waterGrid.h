@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+typedef struct {
+	// Side, in meters, of the smallest patches, used closest to the camera
+	float patchSize;
+	// Number of patch sizes, each twice the previous one. The largest patches are patchSize * 2^(lodLevels - 1).
+	int lodLevels;
+	// A patch is split into four while the camera is closer to it than this many times its size. At least 1.5 keeps
+	// neighboring patches within one level of each other, which the crack free tessellation relies on.
+	float lodDistanceRatio;
+	// Water is drawn up to this distance from the camera
+	float viewDistance;
+} WaterGridSettings;
+
+/**
+    The patches of the water surface, chosen each frame from a quadtree that follows the camera. The largest patches
+    tile the plane on a grid aligned to their size, and a patch is split into four smaller ones while the camera is
+    close to it, so patches are dense near the camera and coarse far away. Every patch lies on a grid of its own size,
+    so the patches only change where the camera crosses a grid line, and the surface does not swim as the camera moves.
+    The number of patches depends on the settings and the camera height, and only varies a little with where the camera
+    is relative to the grid, so the ocean has no edge while the cost stays constant.
+
+    Each patch records which of its edges border a patch twice its size. The tessellation control shader halves the
+    level of those edges, so the vertices along them line up with the larger neighbor and no cracks open.
+*/
+class WaterGrid {
+public:
+	// Instance data of one patch, read by water_vertex.glsl
+	typedef struct {
+		glm::vec2 origin;
+		float size;
+		// Bit mask of the edges bordering a larger patch, in the order of gl_TessLevelOuter: -x, -z, +x, +z
+		float coarserEdges;
+	} Patch;
+
+	static const int EDGE_NEGATIVE_X = 1;
+	static const int EDGE_NEGATIVE_Z = 2;
+	static const int EDGE_POSITIVE_X = 4;
+	static const int EDGE_POSITIVE_Z = 8;
+
+private:
+	WaterGridSettings settings = {
+		.patchSize = 25.0f,
+		.lodLevels = 10,
+		.lodDistanceRatio = 2.0f,
+		.viewDistance = 10000.0f
+	};
+	std::vector<Patch> patches;
+	glm::vec3 camera = glm::vec3(0);
+
+public:
+	void setSettings(const WaterGridSettings& settings);
+	const WaterGridSettings& getSettings() const { return settings; }
+	void update(glm::vec3 cameraPosition);
+	const std::vector<Patch>& getPatches() const { return patches; }
+
+private:
+	float getSize(int level) const;
+	float getDistance(int level, long long x, long long z) const;
+	bool subdivides(int level, long long x, long long z) const;
+	void select(int level, long long x, long long z);
+};
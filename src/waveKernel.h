@@ -0,0 +1,223 @@
+#pragma once
+#include <cmath>
+#include <utility>
+
+#include "simd.h"
+#include "waveSampler.h"
+
+// The wave body is expanded once per wave in the kernels for fixed wave counts, which is past the size compilers
+// inline on their own, and a call per wave would keep the surface in memory instead of registers
+#if defined(_MSC_VER)
+#define WAVE_KERNEL_INLINE __forceinline
+#else
+#define WAVE_KERNEL_INLINE inline __attribute__((always_inline))
+#endif
+
+/**
+    Lane generic implementation of the wave sampler, written against the lanes types of simd.h. This header is included
+    by one translation unit per instruction set so that the AVX2 kernel can be compiled with its own flags while the
+    rest of the program stays on the baseline target.
+*/
+namespace WaveKernel {
+    /**
+        Computes sine and cosine together. The argument is reduced to [-pi/4, pi/4] with a three part Cody-Waite
+        reduction, both minimax polynomials are evaluated, and the quadrant is applied arithmetically so that no lane
+        masks or branches are needed. Accurate to a few ulp for the phase magnitudes produced by the wave sum.
+    */
+    template <typename L>
+    WAVE_KERNEL_INLINE void sincos(typename L::Type x, typename L::Type& sinOut, typename L::Type& cosOut) {
+        typedef typename L::Type V;
+        const V half = L::set(0.5f);
+        const V one = L::set(1.0f);
+        const V two = L::set(2.0f);
+
+        V q = L::floor(L::mulAdd(x, L::set(0.636619772367581343f), half));
+        V r = L::sub(x, L::mul(q, L::set(1.5703125f)));
+        r = L::sub(r, L::mul(q, L::set(4.837512969970703125e-4f)));
+        r = L::sub(r, L::mul(q, L::set(7.54978995489188216e-8f)));
+        V r2 = L::mul(r, r);
+
+        V s = L::mulAdd(r2, L::set(-1.9515295891e-4f), L::set(8.3321608736e-3f));
+        s = L::mulAdd(s, r2, L::set(-1.6666654611e-1f));
+        s = L::mulAdd(L::mul(s, r2), r, r);
+
+        V c = L::mulAdd(r2, L::set(2.443315711809948e-5f), L::set(-1.388731625493765e-3f));
+        c = L::mulAdd(c, r2, L::set(4.166664568298827e-2f));
+        c = L::mulAdd(L::mul(c, r2), r2, L::sub(one, L::mul(half, r2)));
+
+        // Quadrant in [0, 3]. Odd quadrants swap sine and cosine, then each result is negated in two of the quadrants.
+        V quadrant = L::sub(q, L::mul(L::set(4.0f), L::floor(L::mul(q, L::set(0.25f)))));
+        V upperHalf = L::floor(L::mul(quadrant, half));
+        V odd = L::sub(quadrant, L::mul(two, upperHalf));
+        V cosHalf = L::floor(L::mul(L::add(quadrant, one), half));
+        V cosNegative = L::sub(cosHalf, L::mul(two, L::floor(L::mul(cosHalf, half))));
+
+        V swappedSin = L::mulAdd(odd, L::sub(c, s), s);
+        V swappedCos = L::mulAdd(odd, L::sub(s, c), c);
+        sinOut = L::mul(swappedSin, L::sub(one, L::mul(two, upperHalf)));
+        cosOut = L::mul(swappedCos, L::sub(one, L::mul(two, cosNegative)));
+    }
+
+    template <typename L>
+    struct Surface {
+        typename L::Type positionX, positionZ, height;
+        typename L::Type tangentX, tangentY, tangentZ;
+        typename L::Type binormalX, binormalY, binormalZ;
+    };
+
+    // Adds one wave to the displaced position and tangent frame of the surface
+    template <typename L>
+    WAVE_KERNEL_INLINE void accumulateWave(const WaveSampler::Waves& waves, int wave, typename L::Type locationX, typename L::Type locationZ, Surface<L>& surface) {
+        typedef typename L::Type V;
+        const V directionX = L::set(waves.directionX[wave]);
+        const V directionZ = L::set(waves.directionZ[wave]);
+        const V amplitude = L::set(waves.amplitude[wave]);
+        const V steepness = L::set(waves.steepness[wave]);
+
+        V f = L::mulAdd(directionX, locationX, L::mul(directionZ, locationZ));
+        f = L::sub(L::mul(L::set(waves.k[wave]), f), L::set(waves.phase[wave]));
+        V sinF, cosF;
+        sincos<L>(f, sinF, cosF);
+
+        const V amplitudeCos = L::mul(amplitude, cosF);
+        surface.positionX = L::mulAdd(directionX, amplitudeCos, surface.positionX);
+        surface.positionZ = L::mulAdd(directionZ, amplitudeCos, surface.positionZ);
+        surface.height = L::mulAdd(amplitude, sinF, surface.height);
+
+        const V steepSin = L::mul(steepness, sinF);
+        const V steepCos = L::mul(steepness, cosF);
+        const V crossTerm = L::mul(L::mul(directionX, directionZ), steepSin);
+        surface.tangentX = L::sub(surface.tangentX, L::mul(L::mul(directionX, directionX), steepSin));
+        surface.tangentY = L::mulAdd(directionX, steepCos, surface.tangentY);
+        surface.tangentZ = L::sub(surface.tangentZ, crossTerm);
+        surface.binormalX = L::sub(surface.binormalX, crossTerm);
+        surface.binormalY = L::mulAdd(directionZ, steepCos, surface.binormalY);
+        surface.binormalZ = L::sub(surface.binormalZ, L::mul(L::mul(directionZ, directionZ), steepSin));
+    }
+
+    /**
+        Displaced position and tangent frame of the wave surface above the given undisplaced location. A WaveCount
+        above 0 must equal waves.count and expands the sum into one copy of the wave body per wave, so there is no loop
+        counter or branch and the wave constants are loaded from fixed offsets. A WaveCount of 0 loops over waves.count.
+    */
+    template <typename L, int WaveCount>
+    inline void evaluate(const WaveSampler::Waves& waves, typename L::Type locationX, typename L::Type locationZ, Surface<L>& surface) {
+        const typename L::Type zero = L::set(0.0f);
+        const typename L::Type one = L::set(1.0f);
+        surface = { locationX, locationZ, zero, one, zero, zero, zero, zero, one };
+
+        if constexpr (WaveCount > 0) {
+            [&]<int... Wave>(std::integer_sequence<int, Wave...>) {
+                (accumulateWave<L>(waves, Wave, locationX, locationZ, surface), ...);
+            }(std::make_integer_sequence<int, WaveCount>());
+        } else {
+            for (int wave = 0; wave < waves.count; wave++) {
+                accumulateWave<L>(waves, wave, locationX, locationZ, surface);
+            }
+        }
+    }
+
+    /**
+        Inverts the horizontal wave displacement: finds the undisplaced location whose displaced position lands on the
+        desired location, then reports the height and normal there. Each iteration measures the residual between the
+        displaced and desired locations. Lanes within the tolerance stop moving and stop counting iterations, so each
+        query reports the same iteration count as the scalar path, and the group stops once every lane has converged.
+
+        The plain step subtracts the residual from the location, which converges linearly. The Newton step solves with
+        the horizontal part of the surface Jacobian instead, whose columns are the xz components of the tangent and
+        binormal. Where steep waves fold the surface the Jacobian determinant approaches zero, so those lanes fall back
+        to the plain step.
+    */
+    template <typename L, int WaveCount>
+    void sampleWaves(const WaveSampler::Waves& waves, const WaveSampler::SolverSettings& settings, WaveSampler::Batch& batch, size_t begin, size_t end) {
+        typedef typename L::Type V;
+        const V toleranceSquared = L::set(settings.tolerance * settings.tolerance);
+        const V minimumDeterminant = L::set(WaveSampler::MIN_NEWTON_DETERMINANT);
+        const V zero = L::set(0.0f);
+        const V one = L::set(1.0f);
+
+        for (size_t i = begin; i < end; i += L::width) {
+            const V desiredX = L::load(&batch.x[i]);
+            const V desiredZ = L::load(&batch.z[i]);
+            V locationX = desiredX;
+            V locationZ = desiredZ;
+            V residualSquared;
+            Surface<L> surface;
+            // Per lane iteration counts, incremented by 1 in the lanes that have not converged yet and by 0 in the others
+            V iterations = zero;
+            V increment = one;
+
+            int iteration = 0;
+            while (true) {
+                evaluate<L, WaveCount>(waves, locationX, locationZ, surface);
+                iteration++;
+                iterations = L::add(iterations, increment);
+
+                const V residualX = L::sub(surface.positionX, desiredX);
+                const V residualZ = L::sub(surface.positionZ, desiredZ);
+                residualSquared = L::mulAdd(residualX, residualX, L::mul(residualZ, residualZ));
+                if (iteration >= settings.maxIterations || L::allLess(residualSquared, toleranceSquared)) {
+                    break;
+                }
+                // Converged lanes keep their location, so evaluating them again gives the same surface and residual
+                const typename L::Mask converged = L::less(residualSquared, toleranceSquared);
+                increment = L::select(converged, zero, one);
+
+                V stepX = residualX;
+                V stepZ = residualZ;
+                if (settings.newton) {
+                    const V determinant = L::sub(L::mul(surface.tangentX, surface.binormalZ), L::mul(surface.binormalX, surface.tangentZ));
+                    const V inverseDeterminant = L::div(L::set(1.0f), determinant);
+                    const V newtonX = L::mul(L::sub(L::mul(surface.binormalZ, residualX), L::mul(surface.binormalX, residualZ)), inverseDeterminant);
+                    const V newtonZ = L::mul(L::sub(L::mul(surface.tangentX, residualZ), L::mul(surface.tangentZ, residualX)), inverseDeterminant);
+                    const typename L::Mask invertible = L::less(minimumDeterminant, determinant);
+                    stepX = L::select(invertible, newtonX, residualX);
+                    stepZ = L::select(invertible, newtonZ, residualZ);
+                }
+                locationX = L::sub(locationX, L::select(converged, zero, stepX));
+                locationZ = L::sub(locationZ, L::select(converged, zero, stepZ));
+            }
+
+            // normalize(cross(binormal, tangent))
+            V normalX = L::sub(L::mul(surface.binormalY, surface.tangentZ), L::mul(surface.binormalZ, surface.tangentY));
+            V normalY = L::sub(L::mul(surface.binormalZ, surface.tangentX), L::mul(surface.binormalX, surface.tangentZ));
+            V normalZ = L::sub(L::mul(surface.binormalX, surface.tangentY), L::mul(surface.binormalY, surface.tangentX));
+            V inverseLength = L::inverseSqrt(L::mulAdd(normalX, normalX, L::mulAdd(normalY, normalY, L::mul(normalZ, normalZ))));
+
+            L::store(&batch.positionX[i], surface.positionX);
+            L::store(&batch.positionZ[i], surface.positionZ);
+            L::store(&batch.height[i], surface.height);
+            L::store(&batch.normalX[i], L::mul(normalX, inverseLength));
+            L::store(&batch.normalY[i], L::mul(normalY, inverseLength));
+            L::store(&batch.normalZ[i], L::mul(normalZ, inverseLength));
+            L::store(&batch.residual[i], L::sqrt(residualSquared));
+            float laneIterations[L::width];
+            L::store(laneIterations, iterations);
+            for (int lane = 0; lane < L::width; lane++) {
+                batch.iterations[i + lane] = static_cast<int>(laneIterations[lane]);
+            }
+        }
+    }
+
+    // Runs the kernel compiled for waves.count waves, see WaveSampler::SPECIALIZED_WAVE_COUNTS, or the generic one
+    template <typename L>
+    void sampleRange(const WaveSampler::Waves& waves, const WaveSampler::SolverSettings& settings, WaveSampler::Batch& batch, size_t begin, size_t end) {
+        switch (waves.count) {
+        case 8:
+            sampleWaves<L, 8>(waves, settings, batch, begin, end);
+            break;
+        case 16:
+            sampleWaves<L, 16>(waves, settings, batch, begin, end);
+            break;
+        case 32:
+            sampleWaves<L, 32>(waves, settings, batch, begin, end);
+            break;
+        case 64:
+            sampleWaves<L, 64>(waves, settings, batch, begin, end);
+            break;
+        default:
+            sampleWaves<L, 0>(waves, settings, batch, begin, end);
+            break;
+        }
+    }
+}
@@ -0,0 +1,108 @@
+#include <algorithm>
+
+#include "waveQueryService.h"
+#include "water.h"
+
+void WaveQueryService::init(Water* water, ThreadPool* threadPool) {
+    this->water = water;
+    this->threadPool = threadPool ? threadPool : &ThreadPool::getShared();
+    instructionSet = WaveSampler::getInstructionSet();
+
+    queues.clear();
+    for (int i = 0; i < this->threadPool->getThreadCount(); i++) {
+        queues.push_back(std::make_unique<WorkQueue>());
+        queues.back()->nextChunk = 0;
+        queues.back()->endChunk = 0;
+    }
+}
+
+void WaveQueryService::clear() {
+    locations.clear();
+}
+
+WaveQueryService::Handle WaveQueryService::submit(glm::vec3 location) {
+    locations.push_back(glm::vec2(location.x, location.z));
+    return static_cast<Handle>(locations.size() - 1);
+}
+
+void WaveQueryService::execute(float time) {
+    WaveSampler::resize(batch, locations.size());
+    for (size_t i = 0; i < locations.size(); i++) {
+        batch.x[i] = locations[i].x;
+        batch.z[i] = locations[i].y;
+    }
+    WaveSampler::prepareWaves(water->getWaveTable(), water->getWaveCount(), time, waves);
+    this->time = time;
+
+    const size_t chunkCount = (batch.x.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+    // Small batches, such as the camera query alone, are cheaper to run inline than to wake the pool
+    if (chunkCount <= 1 || queues.size() == 1) {
+        water->sampleRange(waves, time, batch, 0, batch.x.size(), instructionSet);
+        return;
+    }
+
+    // Deal out contiguous runs of chunks so that each thread starts on its own region of the batch
+    const size_t threadCount = queues.size();
+    for (size_t i = 0; i < threadCount; i++) {
+        std::lock_guard<std::mutex> lock(queues[i]->mutex);
+        queues[i]->nextChunk = chunkCount * i / threadCount;
+        queues[i]->endChunk = chunkCount * (i + 1) / threadCount;
+    }
+
+    threadPool->run(static_cast<int>(threadCount), [this](int queueIndex) { runChunks(queueIndex); });
+}
+
+void WaveQueryService::getResult(Handle handle, glm::vec3& wavePosition, glm::vec3& waveNormal) const {
+    wavePosition = glm::vec3(locations[handle].x, batch.height[handle], locations[handle].y);
+    waveNormal = glm::vec3(batch.normalX[handle], batch.normalY[handle], batch.normalZ[handle]);
+}
+
+void WaveQueryService::runChunks(int queueIndex) {
+    size_t chunk;
+    while (popChunk(queueIndex, chunk) || stealChunk(queueIndex, chunk)) {
+        size_t begin = chunk * CHUNK_SIZE;
+        size_t end = std::min(begin + CHUNK_SIZE, batch.x.size());
+        water->sampleRange(waves, time, batch, begin, end, instructionSet);
+    }
+}
+
+bool WaveQueryService::popChunk(int queueIndex, size_t& chunk) {
+    WorkQueue& queue = *queues[queueIndex];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.nextChunk >= queue.endChunk) {
+        return false;
+    }
+    chunk = queue.nextChunk++;
+    return true;
+}
+
+/**
+    Takes the back half of the first non-empty queue found after the thief's own. The first stolen chunk is returned,
+    and the rest are moved into the thief's queue so that later pops do not need to touch the victim's lock.
+*/
+bool WaveQueryService::stealChunk(int thiefIndex, size_t& chunk) {
+    const int queueCount = static_cast<int>(queues.size());
+    for (int offset = 1; offset < queueCount; offset++) {
+        WorkQueue& victim = *queues[(thiefIndex + offset) % queueCount];
+        size_t stolenBegin, stolenEnd;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.nextChunk >= victim.endChunk) {
+                continue;
+            }
+            size_t remaining = victim.endChunk - victim.nextChunk;
+            stolenBegin = victim.endChunk - (remaining + 1) / 2;
+            stolenEnd = victim.endChunk;
+            victim.endChunk = stolenBegin;
+        }
+
+        WorkQueue& thief = *queues[thiefIndex];
+        std::lock_guard<std::mutex> lock(thief.mutex);
+        thief.nextChunk = stolenBegin + 1;
+        thief.endChunk = stolenEnd;
+        chunk = stolenBegin;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "waveSampler.h"
+#include "threadPool.h"
+
+class Water;
+
+/**
+    Collects every CPU wave query made during a frame and evaluates them together on a ThreadPool. Queries are
+    submitted before rendering, executed once with execute(), and the results are read back while drawing. The batch
+    is divided into fixed size chunks that are dealt out to one queue per pool thread; a thread that empties its own
+    queue steals chunks from the back of the other queues, so uneven progress between cores does not leave threads idle.
+*/
+class WaveQueryService {
+public:
+	typedef int Handle;
+	static const size_t CHUNK_SIZE = 128;
+
+private:
+	typedef struct {
+		std::mutex mutex;
+		size_t nextChunk;
+		size_t endChunk;
+	} WorkQueue;
+
+	Water* water = nullptr;
+	ThreadPool* threadPool = nullptr;
+	// One queue per thread of the pool, each pool task works through one queue and then steals from the others
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+
+	std::vector<glm::vec2> locations;
+	WaveSampler::Batch batch;
+	WaveSampler::Waves waves;
+	float time = 0.0f;
+	WaveSampler::InstructionSet instructionSet;
+
+public:
+	// Runs on the shared pool unless another one is given
+	void init(Water* water, ThreadPool* threadPool = nullptr);
+	void clear();
+	Handle submit(glm::vec3 location);
+	void execute(float time);
+	void getResult(Handle handle, glm::vec3& wavePosition, glm::vec3& waveNormal) const;
+	size_t getQueryCount() const { return locations.size(); }
+	int getThreadCount() const { return static_cast<int>(queues.size()); }
+
+private:
+	void runChunks(int queueIndex);
+	bool popChunk(int queueIndex, size_t& chunk);
+	bool stealChunk(int thiefIndex, size_t& chunk);
+};
@@ -0,0 +1,83 @@
+#include <cmath>
+
+#include "waveSampler.h"
+#include "waveKernel.h"
+
+void WaveSampler::resize(Batch& batch, size_t count) {
+    size_t paddedCount = (count + BATCH_ALIGNMENT - 1) / BATCH_ALIGNMENT * BATCH_ALIGNMENT;
+    batch.count = count;
+    batch.x.resize(paddedCount, 0.0f);
+    batch.z.resize(paddedCount, 0.0f);
+    batch.positionX.resize(paddedCount);
+    batch.positionZ.resize(paddedCount);
+    batch.height.resize(paddedCount);
+    batch.normalX.resize(paddedCount);
+    batch.normalY.resize(paddedCount);
+    batch.normalZ.resize(paddedCount);
+    batch.residual.resize(paddedCount);
+    batch.iterations.resize(paddedCount);
+}
+
+void WaveSampler::prepareWaves(const WaveConstants* waveTable, int waveCount, float time, Waves& waves) {
+    waves.count = waveCount < MAX_WAVES ? waveCount : MAX_WAVES;
+    for (int wave = 0; wave < waves.count; wave++) {
+        waves.directionX[wave] = waveTable[wave].directionX;
+        waves.directionZ[wave] = waveTable[wave].directionZ;
+        waves.k[wave] = waveTable[wave].k;
+        waves.phase[wave] = waveTable[wave].angularSpeed * time;
+        waves.amplitude[wave] = waveTable[wave].amplitude;
+        waves.steepness[wave] = waveTable[wave].steepness;
+    }
+}
+
+void WaveSampler::sample(const Waves& waves, const SolverSettings& settings, Batch& batch) {
+    sample(waves, settings, batch, 0, batch.x.size(), getInstructionSet());
+}
+
+void WaveSampler::sample(const Waves& waves, const SolverSettings& settings, Batch& batch, size_t begin, size_t end, InstructionSet instructionSet) {
+    switch (instructionSet) {
+    case INSTRUCTION_SET_AVX2:
+        sampleAvx2(waves, settings, batch, begin, end);
+        break;
+    case INSTRUCTION_SET_SSE2:
+        sampleSse2(waves, settings, batch, begin, end);
+        break;
+    default:
+        sampleScalar(waves, settings, batch, begin, end);
+        break;
+    }
+}
+
+WaveSampler::InstructionSet WaveSampler::getInstructionSet() {
+    if (SIMD::hasAvx2()) {
+        return INSTRUCTION_SET_AVX2;
+    }
+#ifdef SIMD_SSE2
+    return INSTRUCTION_SET_SSE2;
+#else
+    return INSTRUCTION_SET_SCALAR;
+#endif
+}
+
+const char* WaveSampler::getInstructionSetName(InstructionSet instructionSet) {
+    switch (instructionSet) {
+    case INSTRUCTION_SET_AVX2:
+        return "AVX2";
+    case INSTRUCTION_SET_SSE2:
+        return "SSE2";
+    default:
+        return "scalar";
+    }
+}
+
+void WaveSampler::sampleScalar(const Waves& waves, const SolverSettings& settings, Batch& batch, size_t begin, size_t end) {
+    WaveKernel::sampleRange<SIMD::ScalarLanes>(waves, settings, batch, begin, end);
+}
+
+void WaveSampler::sampleSse2(const Waves& waves, const SolverSettings& settings, Batch& batch, size_t begin, size_t end) {
+#ifdef SIMD_SSE2
+    WaveKernel::sampleRange<SIMD::Sse2Lanes>(waves, settings, batch, begin, end);
+#else
+    sampleScalar(waves, settings, batch, begin, end);
+#endif
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+/**
+    Batched evaluation of the Gerstner wave sum for many query points at once. Queries are stored in a structure of
+    arrays layout so that the kernels can load 4 (SSE2) or 8 (AVX2) consecutive points into a single register. Batches
+    are padded to a multiple of BATCH_ALIGNMENT, so kernels never have to handle a partial tail.
+*/
+namespace WaveSampler {
+	static const int MAX_WAVES = 64;
+	// Wave counts with a kernel of their own, with the wave sum fully unrolled. Other counts use a generic kernel.
+	static const int SPECIALIZED_WAVE_COUNTS[] = { 8, 16, 32, 64 };
+	static const size_t BATCH_ALIGNMENT = 8;
+	// Below this Jacobian determinant the surface is close to folding over and Newton steps are not taken
+	static const float MIN_NEWTON_DETERMINANT = 0.1f;
+
+	enum InstructionSet {
+		INSTRUCTION_SET_SCALAR = 0,
+		INSTRUCTION_SET_SSE2 = 1,
+		INSTRUCTION_SET_AVX2 = 2
+	};
+
+	/**
+		Precomputed constants for one Gerstner wave, built once by Water::setWaveParameters. The layout is two vec4s so the
+		same table is uploaded to the shaders as "uniform vec4 waves[2 * count]". The phase of a wave at a location is
+		k * dot(direction, xz) - angularSpeed * time, where angularSpeed = k * c * speed.
+	*/
+	typedef struct {
+		float directionX;
+		float directionZ;
+		float k;
+		float angularSpeed;
+		float amplitude;
+		float steepness;
+		float padding[2];
+	} WaveConstants;
+
+	// Per-wave constants for a single point in time, shared by every query in a batch.
+	typedef struct {
+		int count;
+		float directionX[MAX_WAVES];
+		float directionZ[MAX_WAVES];
+		float k[MAX_WAVES];
+		float phase[MAX_WAVES];
+		float amplitude[MAX_WAVES];
+		float steepness[MAX_WAVES];
+	} Waves;
+
+	// Controls the inversion of the horizontal wave displacement, see Water::approximateWaveGeometry.
+	typedef struct {
+		// Largest accepted horizontal distance, in meters, between the displaced and the desired location
+		float tolerance;
+		int maxIterations;
+		bool newton;
+	} SolverSettings;
+
+	typedef struct {
+		int iterations;
+		// Horizontal distance, in meters, between the displaced and the desired location when the solver stopped
+		float residual;
+	} SolverStats;
+
+	typedef struct {
+		size_t count;
+		// Inputs, the desired xz location of each query
+		std::vector<float> x;
+		std::vector<float> z;
+		// Outputs. positionX and positionZ are the displaced location of the surface point that was found.
+		std::vector<float> positionX;
+		std::vector<float> positionZ;
+		std::vector<float> height;
+		std::vector<float> normalX;
+		std::vector<float> normalY;
+		std::vector<float> normalZ;
+		std::vector<float> residual;
+		std::vector<int> iterations;
+	} Batch;
+
+	void resize(Batch& batch, size_t count);
+	void prepareWaves(const WaveConstants* waveTable, int waveCount, float time, Waves& waves);
+	void sample(const Waves& waves, const SolverSettings& settings, Batch& batch);
+	void sample(const Waves& waves, const SolverSettings& settings, Batch& batch, size_t begin, size_t end, InstructionSet instructionSet);
+	InstructionSet getInstructionSet();
+	const char* getInstructionSetName(InstructionSet instructionSet);
+
+	// Kernels for each instruction set. Ranges must be multiples of BATCH_ALIGNMENT.
+	void sampleScalar(const Waves& waves, const SolverSettings& settings, Batch& batch, size_t begin, size_t end);
+	void sampleSse2(const Waves& waves, const SolverSettings& settings, Batch& batch, size_t begin, size_t end);
+	void sampleAvx2(const Waves& waves, const SolverSettings& settings, Batch& batch, size_t begin, size_t end);
+}
@@ -0,0 +1,14 @@
+/**
+    AVX2 variant of the wave sampler. This file is compiled with AVX2 and FMA code generation enabled (see
+    CMakeLists.txt) and is only called after WaveSampler::getInstructionSet has checked for support at runtime.
+*/
+#include "waveSampler.h"
+#include "waveKernel.h"
+
+void WaveSampler::sampleAvx2(const Waves& waves, const SolverSettings& settings, Batch& batch, size_t begin, size_t end) {
+#if defined(__AVX2__)
+    WaveKernel::sampleRange<SIMD::Avx2Lanes>(waves, settings, batch, begin, end);
+#else
+    sampleSse2(waves, settings, batch, begin, end);
+#endif
+}